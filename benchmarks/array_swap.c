@@ -0,0 +1,43 @@
+//
+//  array_swap.c
+//
+//  Array of fixed-size elements. Reads read an element, and writes
+//  swap two elements, as in the array swap benchmark of persistent
+//  memory studies.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 0, 0);
+  const uint64_t num_elements = args.size / args.value_size;
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, num_elements, args.theta);
+
+  char* array = bench_alloc(num_elements * args.value_size);
+  char* tmp = bench_alloc(args.value_size);
+  for (uint64_t i = 0; i < num_elements; ++i) {
+    bench_fill(array + i * args.value_size, args.value_size, i, 0);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    char* a = array + zipf_next(&keys, &rng) * args.value_size;
+    if (bench_is_read(&rng, args.read_pct)) {
+      checksum += bench_read(a, args.value_size);
+      ++reads;
+    } else {
+      char* b = array + zipf_next(&keys, &rng) * args.value_size;
+      memcpy(tmp, a, args.value_size);
+      memcpy(a, b, args.value_size);
+      memcpy(b, tmp, args.value_size);
+      ++writes;
+    }
+  }
+  bench_end("array_swap", &args, reads, writes, checksum);
+  return 0;
+}
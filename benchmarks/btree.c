@@ -0,0 +1,159 @@
+//
+//  btree.c
+//
+//  B+tree of 64-bit keys and fixed-size values. Reads look up a key,
+//  and writes update the value of a key or insert it if absent.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+#define ORDER 32
+
+// A leaf holds keys and values and links to the next leaf in
+// ptrs[ORDER]. An inner node holds n keys and n + 1 children. Both
+// take one more key than they keep before splitting.
+struct node {
+  int leaf;
+  int n;
+  uint64_t keys[ORDER];
+  void* ptrs[ORDER + 1];
+};
+
+static struct node* new_node(int leaf) {
+  struct node* x = bench_alloc(sizeof(struct node));
+  x->leaf = leaf;
+  x->n = 0;
+  x->ptrs[ORDER] = NULL;
+  return x;
+}
+
+// First index with a key not less than the key
+static int lower_bound(const struct node* x, uint64_t key) {
+  int lo = 0, hi = x->n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (x->keys[mid] < key) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+// First index with a key greater than the key
+static int upper_bound(const struct node* x, uint64_t key) {
+  int lo = 0, hi = x->n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (x->keys[mid] <= key) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+static char* find(struct node* x, uint64_t key) {
+  while (!x->leaf) {
+    x = x->ptrs[upper_bound(x, key)];
+  }
+  int i = lower_bound(x, key);
+  return i < x->n && x->keys[i] == key ? x->ptrs[i] : NULL;
+}
+
+// Inserts an absent key below x, and returns the new right sibling of
+// x and its first key if x splits
+static struct node* insert(struct node* x, uint64_t key, char* value,
+                           uint64_t* split_key) {
+  struct node* r;
+  if (x->leaf) {
+    int i = lower_bound(x, key);
+    memmove(&x->keys[i + 1], &x->keys[i], (x->n - i) * sizeof(uint64_t));
+    memmove(&x->ptrs[i + 1], &x->ptrs[i], (x->n - i) * sizeof(void*));
+    x->keys[i] = key;
+    x->ptrs[i] = value;
+    if (++x->n < ORDER) return NULL;
+
+    int h = x->n / 2;
+    r = new_node(1);
+    r->n = x->n - h;
+    memcpy(r->keys, &x->keys[h], r->n * sizeof(uint64_t));
+    memcpy(r->ptrs, &x->ptrs[h], r->n * sizeof(void*));
+    r->ptrs[ORDER] = x->ptrs[ORDER];
+    x->ptrs[ORDER] = r;
+    x->n = h;
+    *split_key = r->keys[0];
+    return r;
+  }
+
+  int i = upper_bound(x, key);
+  uint64_t child_key;
+  struct node* c = insert(x->ptrs[i], key, value, &child_key);
+  if (!c) return NULL;
+
+  memmove(&x->keys[i + 1], &x->keys[i], (x->n - i) * sizeof(uint64_t));
+  memmove(&x->ptrs[i + 2], &x->ptrs[i + 1], (x->n - i) * sizeof(void*));
+  x->keys[i] = child_key;
+  x->ptrs[i + 1] = c;
+  if (++x->n < ORDER) return NULL;
+
+  // the middle key moves up
+  int h = x->n / 2;
+  r = new_node(0);
+  r->n = x->n - h - 1;
+  memcpy(r->keys, &x->keys[h + 1], r->n * sizeof(uint64_t));
+  memcpy(r->ptrs, &x->ptrs[h + 1], (r->n + 1) * sizeof(void*));
+  x->n = h;
+  *split_key = x->keys[h];
+  return r;
+}
+
+static struct node* put(struct node* root, uint64_t key, int value_size,
+                        uint64_t version) {
+  char* value = find(root, key);
+  if (value) {
+    bench_fill(value, value_size, key, version);
+    return root;
+  }
+
+  value = bench_alloc(value_size);
+  bench_fill(value, value_size, key, version);
+  uint64_t split_key;
+  struct node* r = insert(root, key, value, &split_key);
+  if (r) {
+    struct node* new_root = new_node(0);
+    new_root->n = 1;
+    new_root->keys[0] = split_key;
+    new_root->ptrs[0] = root;
+    new_root->ptrs[1] = r;
+    root = new_root;
+  }
+  return root;
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0);
+  // leaves are about three quarters full
+  const uint64_t num_keys = args.size /
+      (args.value_size + 4 * (sizeof(uint64_t) + sizeof(void*)) / 3);
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, 2 * num_keys, args.theta);
+
+  struct node* root = new_node(1);
+  for (uint64_t i = 0; i < num_keys; ++i) {
+    root = put(root, bench_rand(&rng) % (2 * num_keys), args.value_size, 0);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    uint64_t key = zipf_next(&keys, &rng);
+    if (bench_is_read(&rng, args.read_pct)) {
+      char* value = find(root, key);
+      if (value) checksum += bench_read(value, args.value_size);
+      ++reads;
+    } else {
+      root = put(root, key, args.value_size, i);
+      ++writes;
+    }
+  }
+  bench_end("btree", &args, reads, writes, checksum);
+  return 0;
+}
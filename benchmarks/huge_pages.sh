@@ -0,0 +1,38 @@
+#!/bin/bash
+#
+# Compare the host time of simulating the hash table benchmark on
+# ThyNVM with the simulated memory backed by small pages and by huge
+# pages of the host.
+#
+# Usage: huge_pages.sh [GEM5] [SIZE in MBs] [VALUE SIZE] [MEM SIZE]
+#
+# Hugetlb pages have to be reserved beforehand, e.g. by
+#   echo 2048 > /proc/sys/vm/nr_hugepages
+# for 4 GB of 2 MB pages, or the run falls back to transparent ones.
+
+cd "$(dirname "$0")"
+
+GEM5=${1:-../build/X86/gem5.opt}
+SIZE=${2:-256}
+VALUE_SIZE=${3:-64}
+MEM_SIZE=${4:-4GB}
+
+make -s hash_table.o || exit 1
+
+# stats that are zero may be left out
+stat() {
+  awk -v name="$1" '$1 == name { v = $2 } END { print v ? v : 0 }' "$2"
+}
+
+printf "%-12s %12s %14s %16s\n" huge_pages host_seconds host_inst_rate \
+    huge_page_bytes
+for mode in none transparent hugetlb; do
+  outdir=m5out.huge_pages.$mode
+  "$GEM5" -re --outdir=$outdir ../configs/thnvm/thnvm_se.py \
+      --mem-size=$MEM_SIZE --huge-pages=$mode \
+      --cmd=hash_table.o --options="$SIZE $VALUE_SIZE" || exit 1
+  printf "%-12s %12s %14s %16s\n" $mode \
+      "$(stat host_seconds $outdir/stats.txt)" \
+      "$(stat host_inst_rate $outdir/stats.txt)" \
+      "$(stat system.huge_page_bytes $outdir/stats.txt)"
+done
@@ -0,0 +1,204 @@
+//
+//  lsm_memtable.c
+//
+//  Log-structured merge store: puts go to a memtable, a skiplist in
+//  an arena as in LevelDB, which is flushed to a sorted run when
+//  full. Runs are merged into one when there are too many. Reads look
+//  in the memtable and then in the runs from the newest.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+#define MAX_LEVEL 16
+#define MAX_RUNS 4
+
+struct node {
+  uint64_t key;
+  char* value;
+  struct node* next[];
+};
+
+struct memtable {
+  char* arena;
+  uint64_t used, capacity;
+  uint64_t count;
+  struct node* head;
+};
+
+struct run {
+  uint64_t count;
+  uint64_t* keys;
+  char* values;
+};
+
+static int value_size;
+static struct memtable mem;
+static struct run runs[MAX_RUNS + 1];  // newest first
+static int num_runs;
+
+static void* arena_alloc(uint64_t bytes) {
+  bytes = (bytes + 7) & ~7ULL;
+  void* p = mem.arena + mem.used;
+  mem.used += bytes;
+  return p;
+}
+
+static struct node* new_node(uint64_t key, int level) {
+  struct node* x = arena_alloc(sizeof(struct node) +
+                               level * sizeof(struct node*));
+  x->key = key;
+  for (int l = 0; l < level; ++l) x->next[l] = NULL;
+  return x;
+}
+
+static void mem_reset(void) {
+  mem.used = 0;
+  mem.count = 0;
+  mem.head = new_node(0, MAX_LEVEL);
+}
+
+static struct node* mem_find(uint64_t key, struct node** prev) {
+  struct node* x = mem.head;
+  for (int l = MAX_LEVEL - 1; l >= 0; --l) {
+    while (x->next[l] && x->next[l]->key < key) x = x->next[l];
+    if (prev) prev[l] = x;
+  }
+  x = x->next[0];
+  return x && x->key == key ? x : NULL;
+}
+
+static char* run_find(const struct run* r, uint64_t key) {
+  uint64_t lo = 0, hi = r->count;
+  while (lo < hi) {
+    uint64_t mid = (lo + hi) / 2;
+    if (r->keys[mid] < key) lo = mid + 1; else hi = mid;
+  }
+  return lo < r->count && r->keys[lo] == key ?
+      r->values + lo * value_size : NULL;
+}
+
+// Merges all runs into one, the newest value of a key winning
+static void compact(void) {
+  uint64_t total = 0;
+  uint64_t pos[MAX_RUNS + 1];
+  for (int i = 0; i < num_runs; ++i) {
+    total += runs[i].count;
+    pos[i] = 0;
+  }
+  struct run out;
+  out.keys = bench_alloc(total * sizeof(uint64_t));
+  out.values = bench_alloc(total * value_size);
+  out.count = 0;
+  while (1) {
+    int min = -1;
+    for (int i = 0; i < num_runs; ++i) {
+      if (pos[i] < runs[i].count &&
+          (min < 0 || runs[i].keys[pos[i]] < runs[min].keys[pos[min]])) {
+        min = i;
+      }
+    }
+    if (min < 0) break;
+    uint64_t key = runs[min].keys[pos[min]];
+    out.keys[out.count] = key;
+    memcpy(out.values + out.count * value_size,
+           runs[min].values + pos[min] * value_size, value_size);
+    ++out.count;
+    for (int i = 0; i < num_runs; ++i) {
+      if (pos[i] < runs[i].count && runs[i].keys[pos[i]] == key) ++pos[i];
+    }
+  }
+  for (int i = 0; i < num_runs; ++i) {
+    free(runs[i].keys);
+    free(runs[i].values);
+  }
+  runs[0] = out;
+  num_runs = 1;
+}
+
+static void flush(void) {
+  memmove(&runs[1], &runs[0], num_runs * sizeof(struct run));
+  struct run* r = &runs[0];
+  r->keys = bench_alloc(mem.count * sizeof(uint64_t));
+  r->values = bench_alloc(mem.count * value_size);
+  r->count = 0;
+  for (struct node* x = mem.head->next[0]; x; x = x->next[0]) {
+    r->keys[r->count] = x->key;
+    memcpy(r->values + r->count * value_size, x->value, value_size);
+    ++r->count;
+  }
+  if (++num_runs > MAX_RUNS) compact();
+  mem_reset();
+}
+
+static void put(uint64_t key, uint64_t version, uint64_t* rng) {
+  struct node* prev[MAX_LEVEL];
+  struct node* x = mem_find(key, prev);
+  if (!x) {
+    if (mem.used + sizeof(struct node) + MAX_LEVEL * sizeof(struct node*) +
+        value_size + 8 > mem.capacity) {
+      flush();
+      mem_find(key, prev);
+    }
+    int level = 1;
+    uint64_t r = bench_rand(rng);
+    while (level < MAX_LEVEL && (r & 3) == 0) {
+      ++level;
+      r >>= 2;
+    }
+    x = new_node(key, level);
+    x->value = arena_alloc(value_size);
+    for (int l = 0; l < level; ++l) {
+      x->next[l] = prev[l]->next[l];
+      prev[l]->next[l] = x;
+    }
+    ++mem.count;
+  }
+  bench_fill(x->value, value_size, key, version);
+}
+
+static char* get(uint64_t key) {
+  struct node* x = mem_find(key, NULL);
+  if (x) return x->value;
+  for (int i = 0; i < num_runs; ++i) {
+    char* value = run_find(&runs[i], key);
+    if (value) return value;
+  }
+  return NULL;
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0);
+  value_size = args.value_size;
+  const uint64_t num_keys = args.size / (args.value_size + 16);
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, num_keys, args.theta);
+
+  // the memtable takes an eighth of the working set
+  mem.capacity = args.size / 8;
+  if (mem.capacity < M) mem.capacity = M;
+  mem.arena = bench_alloc(mem.capacity);
+  mem_reset();
+
+  for (uint64_t i = 0; i < num_keys; ++i) {
+    put(bench_rand(&rng) % num_keys, 0, &rng);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    uint64_t key = zipf_next(&keys, &rng);
+    if (bench_is_read(&rng, args.read_pct)) {
+      char* value = get(key);
+      if (value) checksum += bench_read(value, args.value_size);
+      ++reads;
+    } else {
+      put(key, i, &rng);
+      ++writes;
+    }
+  }
+  bench_end("lsm_memtable", &args, reads, writes, checksum);
+  return 0;
+}
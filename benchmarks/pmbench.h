@@ -0,0 +1,196 @@
+//
+//  pmbench.h
+//
+//  Shared setup of the persistent-memory workloads: arguments, random
+//  and Zipfian keys, and the work item markers around the measured
+//  operations.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#ifndef PMBENCH_H_
+#define PMBENCH_H_
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef M5
+#include "m5op.h"
+#endif
+
+#define K (1024)
+#define M (1024 * K)
+
+struct bench_args {
+  uint64_t size;      // working set in bytes
+  int read_pct;       // percentage of operations that only read
+  uint64_t ops;       // measured operations
+  int value_size;     // bytes per value
+  double theta;       // Zipfian skew of keys, 0 for uniform keys
+  uint64_t seed;
+};
+
+static void bench_usage(const char* prog) {
+  printf("Usage: %s [-s SIZE in MBs] [-r READ %%] [-n OPS] [-v VALUE SIZE]"
+         " [-z ZIPF THETA] [-S SEED]\n", prog);
+  exit(-1);
+}
+
+static struct bench_args bench_parse(int argc, char* argv[],
+                                     int read_pct, double theta) {
+  struct bench_args args = { 64 * M, read_pct, 1000000, 64, theta, 1 };
+  int c;
+  while ((c = getopt(argc, argv, "s:r:n:v:z:S:")) != -1) {
+    switch (c) {
+    case 's': args.size = atol(optarg) * M; break;
+    case 'r': args.read_pct = atoi(optarg); break;
+    case 'n': args.ops = atol(optarg); break;
+    case 'v': args.value_size = atoi(optarg); break;
+    case 'z': args.theta = atof(optarg); break;
+    case 'S': args.seed = atol(optarg); break;
+    default: bench_usage(argv[0]);
+    }
+  }
+  if (optind != argc || args.size == 0 || args.value_size <= 0 ||
+      args.read_pct < 0 || args.read_pct > 100 ||
+      args.theta < 0 || args.theta >= 1) {
+    bench_usage(argv[0]);
+  }
+  return args;
+}
+
+// xorshift64*, which is fast and good enough for picking keys
+static inline uint64_t bench_rand(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545f4914f6cdd1dULL;
+}
+
+static inline int bench_is_read(uint64_t* state, int read_pct) {
+  return (int)(bench_rand(state) % 100) < read_pct;
+}
+
+// Zipfian keys in [0, n) as generated by YCSB (Gray et al., "Quickly
+// generating billion-record synthetic databases"), with the ranks
+// scrambled so that the popular keys are spread over the key space
+struct zipf {
+  uint64_t n;
+  double theta, alpha, zetan, eta;
+};
+
+static void zipf_init(struct zipf* z, uint64_t n, double theta) {
+  double zeta2 = 1 + pow(0.5, theta);
+  z->n = n;
+  z->theta = theta;
+  z->zetan = 0;
+  if (theta == 0) return;
+  for (uint64_t i = 1; i <= n; ++i) {
+    z->zetan += 1 / pow((double)i, theta);
+  }
+  z->alpha = 1 / (1 - theta);
+  z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / z->zetan);
+}
+
+static inline uint64_t zipf_next(struct zipf* z, uint64_t* state) {
+  uint64_t rank;
+  if (z->theta == 0) {
+    rank = bench_rand(state) % z->n;
+  } else {
+    double u = (bench_rand(state) >> 11) * (1.0 / (1ULL << 53));
+    double uz = u * z->zetan;
+    if (uz < 1) {
+      rank = 0;
+    } else if (uz < 1 + pow(0.5, z->theta)) {
+      rank = 1;
+    } else {
+      rank = (uint64_t)(z->n * pow(z->eta * u - z->eta + 1, z->alpha));
+      if (rank >= z->n) rank = z->n - 1;
+    }
+  }
+  // FNV-1a of the rank
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < 8; ++i) {
+    h = (h ^ ((rank >> (i * 8)) & 0xff)) * 0x100000001b3ULL;
+  }
+  return z->theta == 0 ? rank : h % z->n;
+}
+
+#ifndef M5
+static struct timespec bench_start_time;
+#endif
+
+// Marks the start of the measured operations, as work item 0
+static void bench_begin(void) {
+#ifdef M5
+  m5_work_begin(0, 0);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &bench_start_time);
+#endif
+}
+
+// Marks the end of the measured operations and reports them. The
+// runner takes the operations from here and the time from the work
+// item stats of the simulation.
+static void bench_end(const char* name, const struct bench_args* args,
+                      uint64_t reads, uint64_t writes, uint64_t checksum) {
+#ifdef M5
+  m5_work_end(0, 0);
+  double seconds = 0;
+#else
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (end.tv_sec - bench_start_time.tv_sec) +
+      (end.tv_nsec - bench_start_time.tv_nsec) * 1e-9;
+#endif
+  printf("%s: size %lu MB, read %d%%, value %d B, theta %.2f\n", name,
+         (unsigned long)(args->size / M), args->read_pct, args->value_size,
+         args->theta);
+  printf("ops %lu reads %lu writes %lu checksum %lx", (unsigned long)
+         (reads + writes), (unsigned long)reads, (unsigned long)writes,
+         (unsigned long)checksum);
+  if (seconds > 0) {
+    printf(" host_seconds %.3f ops_per_second %.0f", seconds,
+           (reads + writes) / seconds);
+  }
+  printf("\n");
+}
+
+static void* bench_alloc(size_t size) {
+  void* p = malloc(size);
+  if (!p) {
+    fprintf(stderr, "Out of memory allocating %lu bytes\n",
+            (unsigned long)size);
+    exit(-1);
+  }
+  return p;
+}
+
+// Writes a value that depends on the key and a version, so that reads
+// can check what they get
+static inline void bench_fill(char* value, int size, uint64_t key,
+                              uint64_t version) {
+  memset(value, (int)((key + version) & 0xff), size);
+  if (size >= (int)sizeof(uint64_t)) {
+    memcpy(value, &key, sizeof(uint64_t));
+  }
+}
+
+static inline uint64_t bench_read(const char* value, int size) {
+  uint64_t sum = 0;
+  for (int i = 0; i < size; i += 8) {
+    sum += (unsigned char)value[i];
+  }
+  return sum;
+}
+
+#endif // PMBENCH_H_
@@ -0,0 +1,66 @@
+//
+//  queue.c
+//
+//  Linked FIFO queue of fixed-size entries. Reads read the entry at
+//  the head, and writes dequeue the head and enqueue a new entry, so
+//  that the queue keeps its length and moves through memory.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+struct entry {
+  struct entry* next;
+  uint64_t seq;
+  char value[];
+};
+
+struct queue {
+  struct entry* head;
+  struct entry* tail;
+};
+
+static void enqueue(struct queue* q, uint64_t seq, int value_size) {
+  struct entry* e = bench_alloc(sizeof(struct entry) + value_size);
+  e->next = NULL;
+  e->seq = seq;
+  bench_fill(e->value, value_size, seq, 0);
+  if (q->tail) q->tail->next = e; else q->head = e;
+  q->tail = e;
+}
+
+static void dequeue(struct queue* q) {
+  struct entry* e = q->head;
+  q->head = e->next;
+  if (!q->head) q->tail = NULL;
+  free(e);
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0);
+  const uint64_t num_entries = args.size /
+      (args.value_size + sizeof(struct entry));
+  uint64_t rng = args.seed;
+
+  struct queue q = { NULL, NULL };
+  uint64_t seq = 0;
+  for (; seq < num_entries; ++seq) {
+    enqueue(&q, seq, args.value_size);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    if (bench_is_read(&rng, args.read_pct)) {
+      checksum += q.head->seq + bench_read(q.head->value, args.value_size);
+      ++reads;
+    } else {
+      dequeue(&q);
+      enqueue(&q, seq++, args.value_size);
+      ++writes;
+    }
+  }
+  bench_end("queue", &args, reads, writes, checksum);
+  return 0;
+}
@@ -0,0 +1,247 @@
+//
+//  rbtree.c
+//
+//  Red-black tree of 64-bit keys and fixed-size values, after
+//  Cormen et al. Reads look up a key, and writes delete a key if
+//  present or insert it otherwise, so that the tree keeps rebalancing.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+enum color { RED, BLACK };
+
+struct node {
+  uint64_t key;
+  enum color color;
+  struct node* left;
+  struct node* right;
+  struct node* parent;
+  char value[];
+};
+
+// The sentinel leaf, whose parent is set by deletion
+static struct node nil_node = { 0, BLACK, &nil_node, &nil_node, &nil_node };
+#define NIL (&nil_node)
+
+static struct node* root = NIL;
+
+static void rotate_left(struct node* x) {
+  struct node* y = x->right;
+  x->right = y->left;
+  if (y->left != NIL) y->left->parent = x;
+  y->parent = x->parent;
+  if (x->parent == NIL) root = y;
+  else if (x == x->parent->left) x->parent->left = y;
+  else x->parent->right = y;
+  y->left = x;
+  x->parent = y;
+}
+
+static void rotate_right(struct node* x) {
+  struct node* y = x->left;
+  x->left = y->right;
+  if (y->right != NIL) y->right->parent = x;
+  y->parent = x->parent;
+  if (x->parent == NIL) root = y;
+  else if (x == x->parent->right) x->parent->right = y;
+  else x->parent->left = y;
+  y->right = x;
+  x->parent = y;
+}
+
+static struct node* find(uint64_t key) {
+  struct node* x = root;
+  while (x != NIL && x->key != key) {
+    x = key < x->key ? x->left : x->right;
+  }
+  return x;
+}
+
+static void insert(struct node* z) {
+  struct node* y = NIL;
+  struct node* x = root;
+  while (x != NIL) {
+    y = x;
+    x = z->key < x->key ? x->left : x->right;
+  }
+  z->parent = y;
+  if (y == NIL) root = z;
+  else if (z->key < y->key) y->left = z;
+  else y->right = z;
+  z->left = z->right = NIL;
+  z->color = RED;
+
+  while (z->parent->color == RED) {
+    struct node* g = z->parent->parent;
+    if (z->parent == g->left) {
+      y = g->right;
+      if (y->color == RED) {
+        z->parent->color = y->color = BLACK;
+        g->color = RED;
+        z = g;
+      } else {
+        if (z == z->parent->right) {
+          z = z->parent;
+          rotate_left(z);
+        }
+        z->parent->color = BLACK;
+        g->color = RED;
+        rotate_right(g);
+      }
+    } else {
+      y = g->left;
+      if (y->color == RED) {
+        z->parent->color = y->color = BLACK;
+        g->color = RED;
+        z = g;
+      } else {
+        if (z == z->parent->left) {
+          z = z->parent;
+          rotate_right(z);
+        }
+        z->parent->color = BLACK;
+        g->color = RED;
+        rotate_left(g);
+      }
+    }
+  }
+  root->color = BLACK;
+}
+
+static void transplant(struct node* u, struct node* v) {
+  if (u->parent == NIL) root = v;
+  else if (u == u->parent->left) u->parent->left = v;
+  else u->parent->right = v;
+  v->parent = u->parent;
+}
+
+static void delete_fixup(struct node* x) {
+  while (x != root && x->color == BLACK) {
+    struct node* w;
+    if (x == x->parent->left) {
+      w = x->parent->right;
+      if (w->color == RED) {
+        w->color = BLACK;
+        x->parent->color = RED;
+        rotate_left(x->parent);
+        w = x->parent->right;
+      }
+      if (w->left->color == BLACK && w->right->color == BLACK) {
+        w->color = RED;
+        x = x->parent;
+      } else {
+        if (w->right->color == BLACK) {
+          w->left->color = BLACK;
+          w->color = RED;
+          rotate_right(w);
+          w = x->parent->right;
+        }
+        w->color = x->parent->color;
+        x->parent->color = BLACK;
+        w->right->color = BLACK;
+        rotate_left(x->parent);
+        x = root;
+      }
+    } else {
+      w = x->parent->left;
+      if (w->color == RED) {
+        w->color = BLACK;
+        x->parent->color = RED;
+        rotate_right(x->parent);
+        w = x->parent->left;
+      }
+      if (w->right->color == BLACK && w->left->color == BLACK) {
+        w->color = RED;
+        x = x->parent;
+      } else {
+        if (w->left->color == BLACK) {
+          w->right->color = BLACK;
+          w->color = RED;
+          rotate_left(w);
+          w = x->parent->left;
+        }
+        w->color = x->parent->color;
+        x->parent->color = BLACK;
+        w->left->color = BLACK;
+        rotate_right(x->parent);
+        x = root;
+      }
+    }
+  }
+  x->color = BLACK;
+}
+
+static void delete(struct node* z) {
+  struct node* y = z;
+  struct node* x;
+  enum color y_color = y->color;
+  if (z->left == NIL) {
+    x = z->right;
+    transplant(z, z->right);
+  } else if (z->right == NIL) {
+    x = z->left;
+    transplant(z, z->left);
+  } else {
+    y = z->right;
+    while (y->left != NIL) y = y->left;
+    y_color = y->color;
+    x = y->right;
+    if (y->parent == z) {
+      x->parent = y;
+    } else {
+      transplant(y, y->right);
+      y->right = z->right;
+      y->right->parent = y;
+    }
+    transplant(z, y);
+    y->left = z->left;
+    y->left->parent = y;
+    y->color = z->color;
+  }
+  if (y_color == BLACK) delete_fixup(x);
+  free(z);
+}
+
+static void toggle(uint64_t key, int value_size, uint64_t version) {
+  struct node* x = find(key);
+  if (x != NIL) {
+    delete(x);
+    return;
+  }
+  x = bench_alloc(sizeof(struct node) + value_size);
+  x->key = key;
+  bench_fill(x->value, value_size, key, version);
+  insert(x);
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0);
+  const uint64_t num_keys = args.size /
+      (args.value_size + sizeof(struct node));
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, 2 * num_keys, args.theta);
+
+  for (uint64_t i = 0; i < num_keys; ++i) {
+    uint64_t key = bench_rand(&rng) % (2 * num_keys);
+    if (find(key) == NIL) toggle(key, args.value_size, 0);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    uint64_t key = zipf_next(&keys, &rng);
+    if (bench_is_read(&rng, args.read_pct)) {
+      struct node* x = find(key);
+      if (x != NIL) checksum += bench_read(x->value, args.value_size);
+      ++reads;
+    } else {
+      toggle(key, args.value_size, i);
+      ++writes;
+    }
+  }
+  bench_end("rbtree", &args, reads, writes, checksum);
+  return 0;
+}
@@ -0,0 +1,108 @@
+//
+//  redis_log.c
+//
+//  Redis-like store with an append-only log: sets append a record of
+//  the key and value to the log and point a hash index at it, and
+//  gets follow the index. When the log is full, it is rewritten with
+//  only the latest record of each key, like a Redis AOF rewrite.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+struct record {
+  uint64_t key;
+  uint32_t size;
+  uint32_t crc;  // a cheap checksum of the value, as logs carry
+  char value[];
+};
+
+static int value_size;
+static uint64_t record_size;
+
+static char* log_buf;
+static char* spare_buf;
+static uint64_t log_used, log_capacity;
+
+static uint64_t* index_offsets;  // offset + 1 of the latest record, 0 if none
+static uint64_t num_keys;
+
+static uint32_t value_crc(const char* value) {
+  uint32_t crc = 0;
+  for (int i = 0; i < value_size; ++i) {
+    crc = (crc << 5) + crc + (unsigned char)value[i];
+  }
+  return crc;
+}
+
+static void rewrite(void) {
+  uint64_t used = 0;
+  for (uint64_t key = 0; key < num_keys; ++key) {
+    if (index_offsets[key]) {
+      memcpy(spare_buf + used, log_buf + index_offsets[key] - 1, record_size);
+      index_offsets[key] = used + 1;
+      used += record_size;
+    }
+  }
+  char* tmp = log_buf;
+  log_buf = spare_buf;
+  spare_buf = tmp;
+  log_used = used;
+}
+
+static void set(uint64_t key, uint64_t version) {
+  if (log_used + record_size > log_capacity) rewrite();
+  struct record* r = (struct record*)(log_buf + log_used);
+  r->key = key;
+  r->size = value_size;
+  bench_fill(r->value, value_size, key, version);
+  r->crc = value_crc(r->value);
+  index_offsets[key] = log_used + 1;
+  log_used += record_size;
+}
+
+static struct record* get(uint64_t key) {
+  return index_offsets[key] ?
+      (struct record*)(log_buf + index_offsets[key] - 1) : NULL;
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0);
+  value_size = args.value_size;
+  record_size = (sizeof(struct record) + value_size + 7) & ~7ULL;
+  // the log takes half of the working set, and is at most half live
+  // after a rewrite
+  log_capacity = args.size / 2;
+  num_keys = log_capacity / 2 / record_size;
+  if (num_keys == 0) bench_usage(argv[0]);
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, num_keys, args.theta);
+
+  log_buf = bench_alloc(log_capacity);
+  spare_buf = bench_alloc(log_capacity);
+  index_offsets = bench_alloc(num_keys * sizeof(uint64_t));
+  memset(index_offsets, 0, num_keys * sizeof(uint64_t));
+  log_used = 0;
+
+  for (uint64_t key = 0; key < num_keys; ++key) {
+    set(key, 0);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    uint64_t key = zipf_next(&keys, &rng);
+    if (bench_is_read(&rng, args.read_pct)) {
+      struct record* r = get(key);
+      if (r) checksum += r->crc + bench_read(r->value, r->size);
+      ++reads;
+    } else {
+      set(key, i);
+      ++writes;
+    }
+  }
+  bench_end("redis_log", &args, reads, writes, checksum);
+  return 0;
+}
@@ -0,0 +1,161 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This script sweeps the persistent-memory workloads of this directory
+# over working set sizes and read ratios on configs/thnvm/thnvm_se.py,
+# and reports the throughput of each run as CSV. The workloads mark
+# their measured operations as work item 0, so the throughput is the
+# number of operations they report over the simulated time of the
+# work item. Options after -- are passed on to thnvm_se.py, e.g.:
+#
+# ./run_suite.py -b btree,ycsb_kv -s 16,64 -r 50,95 -- --caches --l2cache
+
+import optparse
+import os
+import re
+import subprocess
+import sys
+from multiprocessing import Pool
+
+benchmarks = ['array_swap', 'btree', 'lsm_memtable', 'queue', 'rbtree',
+              'redis_log', 'skiplist', 'ycsb_kv']
+
+columns = ['benchmark', 'size_mb', 'read_pct', 'ops', 'work_seconds',
+           'ops_per_second', 'host_seconds']
+
+bench_dir = os.path.dirname(os.path.abspath(__file__))
+config = os.path.join(bench_dir, '..', 'configs', 'thnvm', 'thnvm_se.py')
+
+def read_stats(path):
+    """Read the first dump of a text stats file into a dict"""
+    stats = {}
+    with open(path) as f:
+        for line in f:
+            if line.startswith('---------- End'):
+                break
+            fields = line.split()
+            if len(fields) >= 2:
+                try:
+                    stats[fields[0]] = float(fields[1])
+                except ValueError:
+                    pass
+    return stats
+
+def run(job):
+    (options, gem5_args, bench, size, read_pct) = job
+    outdir = os.path.join(options.outdir, '%s.%dMB.r%s' %
+                          (bench, size, read_pct))
+    bench_args = '-s %d -n %d -v %d' % (size, options.ops,
+                                        options.value_size)
+    if read_pct != 'default':
+        bench_args += ' -r %s' % read_pct
+
+    cmd = [options.gem5, '-re', '--outdir=%s' % outdir, config,
+           '--mem-size=%s' % options.mem_size,
+           '--cmd=%s' % os.path.join(bench_dir, bench + '.o'),
+           '--options=%s' % bench_args] + gem5_args
+    with open(os.devnull, 'w') as null:
+        error = subprocess.call(cmd, stdout=null, stderr=null)
+    if error:
+        print >> sys.stderr, "Failed to run %s, see %s" % (bench, outdir)
+        return None
+
+    ops = None
+    with open(os.path.join(outdir, 'simout')) as f:
+        for line in f:
+            m = re.match(r'ops (\d+) reads', line)
+            if m:
+                ops = int(m.group(1))
+    stats = read_stats(os.path.join(outdir, 'stats.txt'))
+    samples = stats.get('system.work_item_type0::samples', 0)
+    if ops is None or samples == 0:
+        print >> sys.stderr, "No work item in %s" % outdir
+        return None
+
+    work_seconds = samples * stats['system.work_item_type0::mean'] / \
+        stats['sim_freq']
+    return [bench, size, read_pct, ops, '%.6f' % work_seconds,
+            '%.0f' % (ops / work_seconds), stats.get('host_seconds', 0)]
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] [-- thnvm_se.py "
+                                   "options]")
+    parser.add_option("--gem5", default=os.path.join(bench_dir, '..',
+                      'build', 'X86', 'gem5.opt'), help="gem5 binary")
+    parser.add_option("-b", "--benchmarks", default=','.join(benchmarks),
+                      help="comma-separated workloads [default: all]")
+    parser.add_option("-s", "--sizes", default="64",
+                      help="comma-separated working sets in MB")
+    parser.add_option("-r", "--read-pcts", default="default",
+                      help="comma-separated read percentages, or default "
+                      "for the default of each workload")
+    parser.add_option("-n", "--ops", type="int", default=100000,
+                      help="measured operations per run")
+    parser.add_option("-v", "--value-size", type="int", default=64,
+                      help="bytes per value")
+    parser.add_option("--mem-size", default="2GB",
+                      help="simulated memory size")
+    parser.add_option("-j", "--jobs", type="int", default=1,
+                      help="runs in parallel")
+    parser.add_option("-o", "--outdir", default="m5out.suite",
+                      help="directory of the output of the runs")
+    parser.add_option("--csv", help="write the results to a file rather "
+                      "than to stdout")
+
+    argv = sys.argv[1:]
+    gem5_args = []
+    if '--' in argv:
+        gem5_args = argv[argv.index('--') + 1:]
+        argv = argv[:argv.index('--')]
+    (options, args) = parser.parse_args(argv)
+    if args:
+        parser.error("unexpected arguments %s" % args)
+
+    for bench in options.benchmarks.split(','):
+        if bench not in benchmarks:
+            parser.error("unknown workload %s" % bench)
+
+    if subprocess.call(['make', '-s', '-C', bench_dir]):
+        sys.exit(1)
+
+    jobs = [(options, gem5_args, bench, int(size), read_pct)
+            for bench in options.benchmarks.split(',')
+            for size in options.sizes.split(',')
+            for read_pct in options.read_pcts.split(',')]
+
+    pool = Pool(options.jobs)
+    results = pool.map(run, jobs)
+
+    out = open(options.csv, 'w') if options.csv else sys.stdout
+    print >> out, ','.join(columns)
+    for result in results:
+        if result:
+            print >> out, ','.join(str(x) for x in result)
+
+if __name__ == "__main__":
+    main()
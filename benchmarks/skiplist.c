@@ -0,0 +1,112 @@
+//
+//  skiplist.c
+//
+//  Skiplist of 64-bit keys and fixed-size values. Reads look up a
+//  key, and writes delete a key if present or insert it otherwise.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+#define MAX_LEVEL 24
+
+struct node {
+  uint64_t key;
+  char* value;
+  int level;
+  struct node* next[];
+};
+
+static struct node* new_node(uint64_t key, int level) {
+  struct node* x = bench_alloc(sizeof(struct node) +
+                               level * sizeof(struct node*));
+  x->key = key;
+  x->value = NULL;
+  x->level = level;
+  return x;
+}
+
+// Levels with probability 1/4 of going up
+static int random_level(uint64_t* rng) {
+  uint64_t r = bench_rand(rng);
+  int level = 1;
+  while (level < MAX_LEVEL && (r & 3) == 0) {
+    ++level;
+    r >>= 2;
+  }
+  return level;
+}
+
+// Finds the last node before the key on every level
+static struct node* find(struct node* head, uint64_t key,
+                         struct node** prev) {
+  struct node* x = head;
+  for (int l = MAX_LEVEL - 1; l >= 0; --l) {
+    while (x->next[l] && x->next[l]->key < key) {
+      x = x->next[l];
+    }
+    if (prev) prev[l] = x;
+  }
+  x = x->next[0];
+  return x && x->key == key ? x : NULL;
+}
+
+static void toggle(struct node* head, uint64_t key, int value_size,
+                   uint64_t version, uint64_t* rng) {
+  struct node* prev[MAX_LEVEL];
+  struct node* x = find(head, key, prev);
+  if (x) {
+    for (int l = 0; l < x->level; ++l) {
+      prev[l]->next[l] = x->next[l];
+    }
+    free(x->value);
+    free(x);
+    return;
+  }
+
+  x = new_node(key, random_level(rng));
+  x->value = bench_alloc(value_size);
+  bench_fill(x->value, value_size, key, version);
+  for (int l = 0; l < x->level; ++l) {
+    x->next[l] = prev[l]->next[l];
+    prev[l]->next[l] = x;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0);
+  // nodes have 4/3 links on average
+  const uint64_t num_keys = args.size / (args.value_size +
+      sizeof(struct node) + 4 * sizeof(struct node*) / 3);
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, 2 * num_keys, args.theta);
+
+  struct node* head = new_node(0, MAX_LEVEL);
+  for (int l = 0; l < MAX_LEVEL; ++l) {
+    head->next[l] = NULL;
+  }
+  for (uint64_t i = 0; i < num_keys; ++i) {
+    uint64_t key = bench_rand(&rng) % (2 * num_keys);
+    if (!find(head, key, NULL)) {
+      toggle(head, key, args.value_size, 0, &rng);
+    }
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    uint64_t key = zipf_next(&keys, &rng);
+    if (bench_is_read(&rng, args.read_pct)) {
+      struct node* x = find(head, key, NULL);
+      if (x) checksum += bench_read(x->value, args.value_size);
+      ++reads;
+    } else {
+      toggle(head, key, args.value_size, i, &rng);
+      ++writes;
+    }
+  }
+  bench_end("skiplist", &args, reads, writes, checksum);
+  return 0;
+}
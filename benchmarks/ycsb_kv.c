@@ -0,0 +1,78 @@
+//
+//  ycsb_kv.c
+//
+//  Key-value store under a YCSB-style load: a hash table of records
+//  whose keys are drawn from a scrambled Zipfian distribution. Reads
+//  get a record, and writes update it, as in YCSB workload A by
+//  default.
+//
+//  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+//
+
+#include "pmbench.h"
+
+struct slot {
+  uint64_t key;  // key + 1, 0 if the slot is free
+  char* value;
+};
+
+struct table {
+  struct slot* slots;
+  uint64_t mask;
+};
+
+static inline uint64_t hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return key;
+}
+
+// Finds the slot of the key, or the free slot to insert it into
+static struct slot* lookup(struct table* t, uint64_t key) {
+  uint64_t i = hash(key) & t->mask;
+  while (t->slots[i].key && t->slots[i].key != key + 1) {
+    i = (i + 1) & t->mask;
+  }
+  return &t->slots[i];
+}
+
+int main(int argc, char* argv[]) {
+  struct bench_args args = bench_parse(argc, argv, 50, 0.99);
+  const uint64_t num_records = args.size /
+      (args.value_size + 2 * sizeof(struct slot));
+  uint64_t rng = args.seed;
+  struct zipf keys;
+  zipf_init(&keys, num_records, args.theta);
+
+  // at most half full
+  struct table t;
+  uint64_t num_slots = 1;
+  while (num_slots < 2 * num_records) num_slots <<= 1;
+  t.slots = bench_alloc(num_slots * sizeof(struct slot));
+  memset(t.slots, 0, num_slots * sizeof(struct slot));
+  t.mask = num_slots - 1;
+
+  for (uint64_t key = 0; key < num_records; ++key) {
+    struct slot* s = lookup(&t, key);
+    s->key = key + 1;
+    s->value = bench_alloc(args.value_size);
+    bench_fill(s->value, args.value_size, key, 0);
+  }
+
+  uint64_t reads = 0, writes = 0, checksum = 0;
+  bench_begin();
+  for (uint64_t i = 0; i < args.ops; ++i) {
+    uint64_t key = zipf_next(&keys, &rng);
+    struct slot* s = lookup(&t, key);
+    if (bench_is_read(&rng, args.read_pct)) {
+      checksum += bench_read(s->value, args.value_size);
+      ++reads;
+    } else {
+      bench_fill(s->value, args.value_size, key, i);
+      ++writes;
+    }
+  }
+  bench_end("ycsb_kv", &args, reads, writes, checksum);
+  return 0;
+}
@@ -313,3 +313,38 @@ def addTHNVMOptions(parser):
                       help="number of BTT entries")
     parser.add_option("--ptt-length", type="int", default=0,
                       help="number of PTT entries")
+    parser.add_option("--eager-writeback-row-size", type="string",
+                      default="0B",
+                      help="write back the dirty blocks of the same memory "
+                      "row along with an L2 victim (0B to disable); the "
+                      "row is the aligned range of this size, so channels "
+                      "must not interleave below it and the address "
+                      "mapping must keep the row above the column bits")
+    parser.add_option("--parallel-mem-channels", action="store_true",
+                      help="simulate each memory channel on its own event "
+                      "queue and thread, behind a bridge whose delay is "
+                      "--mem-channel-quantum")
+    parser.add_option("--mem-channel-quantum", type="string",
+                      default="100ns",
+                      help="simulation quantum of --parallel-mem-channels, "
+                      "which is also the delay of the bridges to the "
+                      "channels: a longer quantum lets the threads run "
+                      "longer between synchronizations, but adds its "
+                      "delay to every memory access, skewing the memory "
+                      "latency against serial runs")
+    parser.add_option("--checkpoint-memory-raw", action="store_true",
+                      help="checkpoint memory as uncompressed images that "
+                      "restores map lazily")
+    parser.add_option("--memory-image-dir", type="string", default="",
+                      help="directory, e.g. /dev/shm, where restored "
+                      "memory checkpoints are expanded once and shared")
+    parser.add_option("--huge-pages", type="choice", default="none",
+                      choices=["none", "transparent", "hugetlb"],
+                      help="back the simulated memory by host huge pages, "
+                      "hugetlb ones falling back to transparent ones")
+    parser.add_option("--footprint-sampling", type="float", default=0.01,
+                      help="fraction of pages sampled to measure the "
+                      "per-epoch footprint that sizes the BTT and PTT "
+                      "(0 to disable)")
+    parser.add_option("--footprint-epoch", type="string", default="10ms",
+                      help="epoch length of the footprint measurement")
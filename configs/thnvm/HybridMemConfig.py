@@ -5,8 +5,11 @@
 #  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
 #
 
-from m5.objects import Addr, AddrRange, DRAMCtrl, VirtualXBar
+import m5.ticks
+from m5.objects import Addr, AddrRange, CommMonitor, DRAMCtrl, \
+    FootprintCalc, SyncBridge, VirtualXBar
 from m5.util import addToPath
+from m5.util.convert import toLatency
 
 addToPath('../common')
 import MemConfig
@@ -55,8 +58,46 @@ def config_hybrid_mem(options, system):
     system.mem_ctrls = mem_ctrls
 
     # Connect the controllers to the THNVM bus
-    for i in xrange(len(system.mem_ctrls)):
-        system.mem_ctrls[i].port = system.thnvm_bus.master
+    if options.parallel_mem_channels:
+        # Each controller gets its own event queue, and thus thread,
+        # behind a bridge whose delay is the simulation quantum
+        delay = mem_channel_quantum(options)
+        system.mem_bridges = [SyncBridge(master_eventq_index = i + 1,
+                                         delay = '%dt' % delay)
+                              for i in xrange(len(system.mem_ctrls))]
+        for i in xrange(len(system.mem_ctrls)):
+            system.mem_ctrls[i].eventq_index = i + 1
+            system.mem_bridges[i].slave = system.thnvm_bus.master
+            system.mem_bridges[i].master = system.mem_ctrls[i].port
+    else:
+        for i in xrange(len(system.mem_ctrls)):
+            system.mem_ctrls[i].port = system.thnvm_bus.master
 
-    system.thnvm_bus.slave = system.membus.master
+    if options.footprint_sampling > 0:
+        # Measure the per-epoch footprint of the accesses to the hybrid
+        # memory, with the monitor's own histograms off to keep it cheap
+        footprint = FootprintCalc(epoch_length = options.footprint_epoch,
+                                  block_bits = options.block_bits,
+                                  page_bits = options.page_bits,
+                                  sampling_rate = options.footprint_sampling)
+        system.thnvm_monitor = CommMonitor(footprint_calc = footprint,
+                                           disable_burst_length_hists = True,
+                                           disable_bandwidth_hists = True,
+                                           disable_latency_hists = True,
+                                           disable_itt_dists = True,
+                                           disable_outstanding_hists = True,
+                                           disable_transaction_hists = True)
+        system.thnvm_monitor.slave = system.membus.master
+        system.thnvm_monitor.master = system.thnvm_bus.slave
+    else:
+        system.thnvm_bus.slave = system.membus.master
 
+def mem_channel_quantum(options):
+    """
+    Ticks of the lookahead when memory channels are simulated in
+    parallel. This is both the delay of the bridges to the channels and
+    the simulation quantum, so every memory access gets that much
+    slower, while the threads synchronize once per quantum.
+    """
+    m5.ticks.fixGlobalFrequency()
+    return m5.ticks.fromSeconds(toLatency(options.mem_channel_quantum))
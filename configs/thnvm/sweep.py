@@ -0,0 +1,161 @@
+#
+#  sweep.py
+#
+#  Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+#
+
+# This script measures the loaded latency of the hybrid memory, i.e.,
+# the read latency seen at increasing injection rates, for a number of
+# read/write mixes. A traffic generator in front of the memory bus
+# goes through one state per combination of read percent and
+# inter-transaction time, and the stats are dumped and reset at the
+# end of each state. By default the generator is elastic, so that
+# once the memory saturates, back-pressure rather than an ever
+# growing queue bounds the injection rate. The states are written to
+# sweep.cfg in the output directory, where util/thnvm_sweep_plot.py
+# picks them up to tabulate and plot latency against bandwidth, e.g.:
+#
+# build/X86/gem5.opt -d m5out.sweep configs/thnvm/sweep.py \
+#     --read-pcts 100,70,50 --ptt-length 4096
+# util/thnvm_sweep_plot.py m5out.sweep --csv sweep.csv --plot sweep.pdf
+
+import optparse
+import os
+import sys
+
+import m5
+from m5.objects import *
+from m5.util import addToPath, fatal
+from m5.util.convert import toLatency
+from m5.internal.stats import periodicStatDump
+
+addToPath('../common')
+
+import Options
+import HybridMemConfig
+
+parser = optparse.OptionParser()
+Options.addCommonOptions(parser)
+Options.addTHNVMOptions(parser)
+
+parser.add_option("--mode", type="choice", default="RANDOM",
+                  choices=["RANDOM", "ZIPF", "PAGE_LOCALITY"],
+                  help="address pattern of the traffic generator")
+parser.add_option("--read-pcts", type="string", default="100,70,50",
+                  help="comma-separated read percentages to sweep")
+parser.add_option("--min-itt", type="float", default=2.0,
+                  help="shortest inter-transaction time in ns")
+parser.add_option("--max-itt", type="float", default=200.0,
+                  help="longest inter-transaction time in ns")
+parser.add_option("--steps", type="int", default=12,
+                  help="injection rates per read percentage, spaced "
+                  "geometrically from the longest to the shortest "
+                  "inter-transaction time")
+parser.add_option("--period", type="string", default="100us",
+                  help="time spent at each injection rate")
+parser.add_option("--open-loop", action="store_true",
+                  help="keep injecting at the set rate regardless of "
+                  "back-pressure")
+parser.add_option("--theta", type="float", default=0.99,
+                  help="page skew of the ZIPF mode")
+parser.add_option("--blocks-per-page", type="int", default=1,
+                  help="blocks written per page in the PAGE_LOCALITY mode")
+parser.add_option("--latency-bins", type="int", default=1000,
+                  help="bins of the read latency histogram, from which "
+                  "the percentiles are estimated")
+
+(options, args) = parser.parse_args()
+
+if args:
+    print "Error: script doesn't take any positional arguments"
+    sys.exit(1)
+
+if options.steps < 1 or options.min_itt <= 0 or \
+        options.min_itt > options.max_itt:
+    fatal("Invalid range of inter-transaction times")
+
+read_pcts = [int(r) for r in options.read_pcts.split(',')]
+for r in read_pcts:
+    if r < 0 or r > 100:
+        fatal("Invalid read percentage %d" % r)
+
+system = System(membus = SystemXBar(),
+                mem_ranges = [AddrRange(options.mem_size)],
+                cache_line_size = options.cacheline_size,
+                mmap_using_noreserve = True)
+system.voltage_domain = VoltageDomain(voltage = options.sys_voltage)
+system.clk_domain = SrcClockDomain(clock = options.sys_clock,
+                                   voltage_domain = system.voltage_domain)
+system.system_port = system.membus.slave
+
+HybridMemConfig.config_hybrid_mem(options, system)
+
+# there is no point slowing things down by keeping any data
+for ctrl in system.mem_ctrls:
+    ctrl.null = True
+
+m5.ticks.fixGlobalFrequency()
+period = m5.ticks.fromSeconds(toLatency(options.period))
+
+# inter-transaction times in ticks, from the lightest load to the
+# heaviest one
+itts = []
+for i in xrange(options.steps):
+    ratio = float(i) / max(options.steps - 1, 1)
+    itt = options.max_itt * (options.min_itt / options.max_itt) ** ratio
+    itts.append(int(round(itt * 1000)))
+
+block_size = options.cacheline_size
+page_size = 2 ** options.page_bits
+max_addr = Addr(options.mem_size).value
+
+# the states go through the injection rates for each read percent, in
+# the order of the stats dumps
+cfg_file_name = os.path.join(m5.options.outdir, 'sweep.cfg')
+cfg_file = open(cfg_file_name, 'w')
+
+nxt_state = 0
+for read_pct in read_pcts:
+    for itt in itts:
+        state = "STATE %d %d %s %d 0 %d %d %d %d 0" % \
+            (nxt_state, period, options.mode, read_pct, max_addr,
+             block_size, itt, itt)
+        if options.mode == "ZIPF":
+            state += " %d %f" % (page_size, options.theta)
+        elif options.mode == "PAGE_LOCALITY":
+            state += " %d %d" % (page_size, options.blocks_per_page)
+        cfg_file.write(state + "\n")
+        nxt_state += 1
+
+cfg_file.write("INIT 0\n")
+
+for state in xrange(1, nxt_state):
+    cfg_file.write("TRANSITION %d %d 1\n" % (state - 1, state))
+
+cfg_file.write("TRANSITION %d %d 1\n" % (nxt_state - 1, nxt_state - 1))
+
+cfg_file.close()
+
+system.tgen = TrafficGen(config_file = cfg_file_name,
+                         elastic_req = not options.open_loop)
+
+# the monitor measures the latency from the generator to the memory,
+# with fine enough bins for the tail percentiles
+system.monitor = CommMonitor(latency_bins = options.latency_bins)
+
+system.tgen.port = system.monitor.slave
+system.monitor.master = system.membus.slave
+
+# every period, dump and reset all stats
+periodicStatDump(period)
+
+root = Root(full_system = False, system = system)
+root.system.mem_mode = 'timing'
+
+m5.instantiate()
+
+# run one tick past the last period for its stats dump to happen
+event = m5.simulate(nxt_state * period + 1)
+
+print "THNVM sweep with %d read mixes and %d injection rates: %s" % \
+    (len(read_pcts), len(itts), event.getCause())
@@ -178,7 +178,10 @@ np = options.num_cpus
 system = System(cpu = [CPUClass(cpu_id=i) for i in xrange(np)],
                 mem_mode = test_mem_mode,
                 mem_ranges = [AddrRange(options.mem_size)],
-                cache_line_size = options.cacheline_size)
+                cache_line_size = options.cacheline_size,
+                checkpoint_memory_raw = options.checkpoint_memory_raw,
+                memory_image_dir = options.memory_image_dir,
+                huge_pages = options.huge_pages)
 
 # Create a top-level voltage domain
 system.voltage_domain = VoltageDomain(voltage = options.sys_voltage)
@@ -273,7 +276,11 @@ else:
     system.membus = SystemXBar()
     system.system_port = system.membus.slave
     CacheConfig.config_cache(options, system)
+    if options.l2cache:
+        system.l2.eager_writeback_row_size = options.eager_writeback_row_size
     HybridMemConfig.config_hybrid_mem(options, system)
 
 root = Root(full_system = False, system = system)
+if options.parallel_mem_channels and not options.ruby:
+    root.sim_quantum = HybridMemConfig.mem_channel_quantum(options)
 Simulation.run(options, root, system, FutureClass)
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BASE_FLAT_ADDR_MAP_HH__
+#define __BASE_FLAT_ADDR_MAP_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "base/intmath.hh"
+#include "base/types.hh"
+
+/**
+ * A fixed-capacity hash map from addresses to small values, for lookup
+ * structures on simulator hot paths. All entries live in one flat array
+ * that is probed linearly, and erasure shifts the following entries back
+ * rather than leaving tombstones, so a lookup touches a few adjacent
+ * slots and the map never allocates after construction.
+ */
+template <class Value>
+class FlatAddrMap
+{
+  public:
+    /**
+     * @param max_entries The maximum number of entries held at a time.
+     * The table is sized to keep the load factor at or below one half.
+     */
+    FlatAddrMap(size_t max_entries);
+
+    /**
+     * @return Pointer to the value mapped to the key, or NULL if none.
+     */
+    Value *find(Addr key);
+    const Value *find(Addr key) const;
+
+    /**
+     * Map the key to the value, replacing any previous mapping.
+     */
+    void insert(Addr key, const Value &value);
+
+    /**
+     * Remove the mapping of the key.
+     * @return True if the key was mapped.
+     */
+    bool erase(Addr key);
+
+    void clear();
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return maxEntries; }
+
+  private:
+    struct Slot
+    {
+        Addr key;
+        Value value;
+        bool used;
+
+        Slot() : key(0), value(), used(false) { }
+    };
+
+    /** Home slot of a key, from the top bits of a Fibonacci hash. */
+    size_t home(Addr key) const
+    {
+        return (key * 0x9e3779b97f4a7c15ULL) >> shift;
+    }
+
+    /** @return The slot holding the key, or an unused slot if none. */
+    size_t probe(Addr key) const;
+
+    const size_t maxEntries;
+    std::vector<Slot> slots;
+    const size_t mask;
+    const int shift;
+    size_t count;
+};
+
+template <class Value>
+FlatAddrMap<Value>::FlatAddrMap(size_t max_entries)
+    : maxEntries(max_entries),
+      slots(size_t(2) << ceilLog2(max_entries ? max_entries : 1)),
+      mask(slots.size() - 1), shift(64 - floorLog2(slots.size())),
+      count(0)
+{
+}
+
+template <class Value>
+size_t
+FlatAddrMap<Value>::probe(Addr key) const
+{
+    size_t i = home(key);
+    while (slots[i].used && slots[i].key != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+template <class Value>
+Value *
+FlatAddrMap<Value>::find(Addr key)
+{
+    Slot &slot = slots[probe(key)];
+    return slot.used ? &slot.value : NULL;
+}
+
+template <class Value>
+const Value *
+FlatAddrMap<Value>::find(Addr key) const
+{
+    const Slot &slot = slots[probe(key)];
+    return slot.used ? &slot.value : NULL;
+}
+
+template <class Value>
+void
+FlatAddrMap<Value>::insert(Addr key, const Value &value)
+{
+    Slot &slot = slots[probe(key)];
+    if (!slot.used) {
+        assert(count < maxEntries);
+        slot.used = true;
+        slot.key = key;
+        ++count;
+    }
+    slot.value = value;
+}
+
+template <class Value>
+bool
+FlatAddrMap<Value>::erase(Addr key)
+{
+    size_t hole = probe(key);
+    if (!slots[hole].used)
+        return false;
+
+    // Move back every following entry of the run that could not be found
+    // anymore once the hole breaks the run, i.e., whose home slot is not
+    // cyclically in (hole, i].
+    for (size_t i = (hole + 1) & mask; slots[i].used; i = (i + 1) & mask) {
+        size_t h = home(slots[i].key);
+        bool stays = hole < i ? (hole < h && h <= i) : (hole < h || h <= i);
+        if (!stays) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    slots[hole].used = false;
+    --count;
+    return true;
+}
+
+template <class Value>
+void
+FlatAddrMap<Value>::clear()
+{
+    for (typename std::vector<Slot>::iterator it = slots.begin();
+         it != slots.end(); ++it) {
+        it->used = false;
+    }
+    count = 0;
+}
+
+#endif // __BASE_FLAT_ADDR_MAP_HH__
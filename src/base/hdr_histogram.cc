@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "base/hdr_histogram.hh"
+#include "base/misc.hh"
+
+HdrHistogram::HdrHistogram(unsigned precision_bits, uint64_t max_value)
+    : precisionBits(precision_bits),
+      halfCount(uint64_t(1) << (precision_bits - 1)),
+      maxValue(max_value), total(0), sum(0),
+      minSeen(std::numeric_limits<uint64_t>::max()), maxSeen(0)
+{
+    if (precisionBits < 2 || precisionBits > 20)
+        fatal("Histogram precision of %d bits is not in [2, 20]\n",
+              precisionBits);
+
+    counts.resize(index(maxValue) + 1, 0);
+}
+
+void
+HdrHistogram::add(const HdrHistogram& other)
+{
+    assert(other.counts.size() == counts.size());
+
+    for (size_t i = 0; i < counts.size(); ++i)
+        counts[i] += other.counts[i];
+    total += other.total;
+    sum += other.sum;
+    if (other.total && other.minSeen < minSeen)
+        minSeen = other.minSeen;
+    if (other.maxSeen > maxSeen)
+        maxSeen = other.maxSeen;
+}
+
+void
+HdrHistogram::reset()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    sum = 0;
+    minSeen = std::numeric_limits<uint64_t>::max();
+    maxSeen = 0;
+}
+
+uint64_t
+HdrHistogram::lowestValue(size_t idx) const
+{
+    if (idx < (halfCount << 1))
+        return idx;
+
+    // bucket idx holds the values with sub-bucket idx % halfCount +
+    // halfCount, shifted up by the magnitude
+    unsigned magnitude = idx / halfCount - 1;
+    return (idx - magnitude * halfCount) << magnitude;
+}
+
+uint64_t
+HdrHistogram::highestValue(size_t idx) const
+{
+    if (idx < (halfCount << 1))
+        return idx;
+
+    unsigned magnitude = idx / halfCount - 1;
+    return lowestValue(idx) + (uint64_t(1) << magnitude) - 1;
+}
+
+uint64_t
+HdrHistogram::percentile(double p) const
+{
+    if (total == 0)
+        return 0;
+
+    // the rank of the sample at the percentile, counting from one
+    uint64_t rank = std::ceil(p / 100 * total);
+    if (rank == 0)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return std::max(std::min(highestValue(i), maxSeen), min());
+    }
+
+    return maxSeen;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a log-linear histogram for percentiles of values
+ * over a wide range, such as latencies.
+ */
+
+#ifndef __BASE_HDR_HISTOGRAM_HH__
+#define __BASE_HDR_HISTOGRAM_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A histogram in the style of HdrHistogram, whose buckets are linear
+ * within each power of two and grow with it, so that every value is
+ * kept to a fixed number of significant bits. Values below
+ * 2^precision_bits get a bucket each and are thus exact, and larger
+ * ones are within a relative error of 2^-(precision_bits - 1). The
+ * buckets cover up to a maximum value fixed when creating the
+ * histogram, which bounds its memory to some tens of KB for any
+ * practical range, and larger values count as the maximum.
+ *
+ * Percentiles walk the counts, so they are exact in rank: the
+ * percentile p is the bucket of the sample with rank ceil(p * n /
+ * 100), reported as the highest value of that bucket, but never
+ * beyond the largest value seen.
+ */
+class HdrHistogram
+{
+  public:
+
+    /**
+     * Create an empty histogram.
+     *
+     * @param precision_bits Significant bits kept of each value,
+     *                       between 2 and 20
+     * @param max_value Largest value to tell apart from others
+     */
+    HdrHistogram(unsigned precision_bits, uint64_t max_value);
+
+    /**
+     * Count a value.
+     *
+     * @param value Value to count, clamped to the maximum
+     */
+    void
+    record(uint64_t value)
+    {
+        if (value > maxValue)
+            value = maxValue;
+        ++counts[index(value)];
+        ++total;
+        sum += value;
+        if (value < minSeen)
+            minSeen = value;
+        if (value > maxSeen)
+            maxSeen = value;
+    }
+
+    /**
+     * Add the counts of another histogram of the same precision and
+     * range.
+     *
+     * @param other Histogram to add to this one
+     */
+    void add(const HdrHistogram& other);
+
+    /** Forget all values counted so far. */
+    void reset();
+
+    /**
+     * Get a percentile of the values counted.
+     *
+     * @param p Percentile in [0, 100]
+     * @return Value with p percent of the values at or below it, 0
+     *         if there are none
+     */
+    uint64_t percentile(double p) const;
+
+    /** @return number of values counted */
+    uint64_t samples() const { return total; }
+
+    /** @return smallest value counted, 0 if none */
+    uint64_t min() const { return total ? minSeen : 0; }
+
+    /** @return largest value counted, 0 if none */
+    uint64_t max() const { return maxSeen; }
+
+    /** @return mean of the values counted, 0 if none */
+    double mean() const { return total ? double(sum) / total : 0; }
+
+    /** @return number of buckets, which bounds the memory used */
+    size_t numBuckets() const { return counts.size(); }
+
+    /**
+     * Get the bucket of a value.
+     *
+     * @param value Value no larger than the maximum
+     * @return index of its bucket
+     */
+    size_t
+    index(uint64_t value) const
+    {
+        // the values below the full sub-bucket count are in the
+        // first, linear buckets, and the others are shifted down so
+        // that their top precisionBits bits pick the sub-bucket
+        unsigned magnitude = 0;
+        if (value >= (halfCount << 1))
+            magnitude = 63 - __builtin_clzll(value) - (precisionBits - 1);
+        return size_t(magnitude) * halfCount + (value >> magnitude);
+    }
+
+    /**
+     * Get the smallest value of a bucket.
+     *
+     * @param idx Index of the bucket
+     * @return lowest value that falls in it
+     */
+    uint64_t lowestValue(size_t idx) const;
+
+    /**
+     * Get the largest value of a bucket.
+     *
+     * @param idx Index of the bucket
+     * @return highest value that falls in it
+     */
+    uint64_t highestValue(size_t idx) const;
+
+  private:
+
+    /** Significant bits kept of each value */
+    const unsigned precisionBits;
+
+    /** Number of buckets per power of two above the linear ones */
+    const uint64_t halfCount;
+
+    /** Largest value told apart */
+    const uint64_t maxValue;
+
+    /** Count of each bucket */
+    std::vector<uint64_t> counts;
+
+    /** Number of values counted */
+    uint64_t total;
+
+    /** Sum of the values counted, for the mean */
+    uint64_t sum;
+
+    /** Smallest and largest values counted */
+    uint64_t minSeen;
+    uint64_t maxSeen;
+};
+
+#endif // __BASE_HDR_HISTOGRAM_HH__
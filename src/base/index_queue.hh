@@ -102,8 +102,9 @@ IndexQueue::popFront()
 {
     if (empty())
         return -EINVAL;
-    remove(front());
-    return front();
+    int i = front();
+    remove(i);
+    return i;
 }
 
 #endif  // __INDEX_QUEUE_HH__
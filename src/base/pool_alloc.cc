@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/pool_alloc.hh"
+
+#include <algorithm>
+#include <cassert>
+
+#include "base/intmath.hh"
+#include "base/misc.hh"
+
+using namespace std;
+
+const int PoolAllocator::maxPools;
+const unsigned PoolAllocator::batchSize;
+const size_t PoolAllocator::slabBytes;
+
+__thread PoolAllocator::ThreadCache *PoolAllocator::_threadCaches = NULL;
+
+namespace {
+
+/**
+ * All pools and the caches of all threads, so that counters can be
+ * summed up. Function-local so that pools may be created during
+ * static initialization.
+ */
+struct Registry
+{
+    mutex lock;
+    vector<PoolAllocator *> pools;
+    vector<void *> caches;
+};
+
+Registry &
+registry()
+{
+    static Registry reg;
+    return reg;
+}
+
+} // anonymous namespace
+
+PoolAllocator::PoolAllocator(const string &name, size_t size)
+    : _name(name),
+      objSize(roundUp(max(size, sizeof(FreeObj)), 16)),
+      index(registry().pools.size())
+{
+    Registry &reg = registry();
+    lock_guard<mutex> guard(reg.lock);
+    if (index >= maxPools)
+        fatal("Too many pools, %s would be number %d\n", name, index + 1);
+    if (objSize > slabBytes)
+        fatal("Pool %s object size %d exceeds the slab size %d\n",
+              name, objSize, slabBytes);
+    reg.pools.push_back(this);
+}
+
+PoolAllocator::ThreadCache *
+PoolAllocator::newThreadCaches()
+{
+    ThreadCache *caches = new ThreadCache[maxPools]();
+    Registry &reg = registry();
+    lock_guard<mutex> guard(reg.lock);
+    reg.caches.push_back(caches);
+    return caches;
+}
+
+void *
+PoolAllocator::refill(ThreadCache &c)
+{
+    assert(!c.head && !c.count);
+    {
+        lock_guard<mutex> guard(depotMutex);
+        if (!depot.empty()) {
+            c.head = depot.back();
+            c.count = batchSize;
+            depot.pop_back();
+        }
+    }
+    if (c.head)
+        return allocate();
+
+    if (c.bump + objSize > c.bumpEnd) {
+        // the rest of the old slab, if any, is too small to matter
+        c.bump = new char[slabBytes];
+        c.bumpEnd = c.bump + slabBytes;
+    }
+    void *obj = c.bump;
+    c.bump += objSize;
+    ++c.misses;
+    return obj;
+}
+
+void
+PoolAllocator::spill(ThreadCache &c)
+{
+    FreeObj *batch = c.head;
+    FreeObj *tail = batch;
+    for (unsigned i = 1; i < batchSize; ++i)
+        tail = tail->next;
+    c.head = tail->next;
+    tail->next = NULL;
+    c.count -= batchSize;
+
+    lock_guard<mutex> guard(depotMutex);
+    depot.push_back(batch);
+}
+
+uint64_t
+PoolAllocator::sum(uint64_t ThreadCache::*counter) const
+{
+    Registry &reg = registry();
+    lock_guard<mutex> guard(reg.lock);
+    uint64_t total = 0;
+    for (auto caches : reg.caches)
+        total += static_cast<ThreadCache *>(caches)[index].*counter;
+    return total;
+}
+
+uint64_t
+PoolAllocator::hits() const
+{
+    return sum(&ThreadCache::hits);
+}
+
+uint64_t
+PoolAllocator::misses() const
+{
+    return sum(&ThreadCache::misses);
+}
+
+uint64_t
+PoolAllocator::totalHits()
+{
+    uint64_t total = 0;
+    for (auto pool : registry().pools)
+        total += pool->hits();
+    return total;
+}
+
+uint64_t
+PoolAllocator::totalMisses()
+{
+    uint64_t total = 0;
+    for (auto pool : registry().pools)
+        total += pool->misses();
+    return total;
+}
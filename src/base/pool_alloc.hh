@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Thread-local slab pools for small objects that the memory system
+ * creates and destroys at a high rate, i.e., packets, requests and
+ * their data buffers.
+ */
+
+#ifndef __BASE_POOL_ALLOC_HH__
+#define __BASE_POOL_ALLOC_HH__
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "base/types.hh"
+
+/**
+ * A pool of equally sized objects. Each thread allocates from its own
+ * free list and bump-allocated slab, so the common path takes no
+ * lock. An object may be freed by any thread, e.g., when a packet
+ * crosses to another event queue, and is then recycled by the freeing
+ * thread. To keep one thread from hoarding what another allocates,
+ * free lists longer than two batches give a batch back to a shared
+ * depot, from which threads refill before carving new slabs.
+ *
+ * Slabs are never returned to the host, as pooled objects may be
+ * freed during program exit.
+ */
+class PoolAllocator
+{
+  public:
+    /**
+     * @param name Name of the pool, for diagnostics.
+     * @param size Size of each object in bytes.
+     */
+    PoolAllocator(const std::string &name, size_t size);
+
+    void *
+    allocate()
+    {
+        ThreadCache &c = cache();
+        FreeObj *obj = c.head;
+        if (!obj)
+            return refill(c);
+        c.head = obj->next;
+        --c.count;
+        ++c.hits;
+        return obj;
+    }
+
+    void
+    deallocate(void *p)
+    {
+        ThreadCache &c = cache();
+        FreeObj *obj = static_cast<FreeObj *>(p);
+        obj->next = c.head;
+        c.head = obj;
+        if (++c.count > 2 * batchSize)
+            spill(c);
+    }
+
+    const std::string &name() const { return _name; }
+    size_t objectSize() const { return objSize; }
+
+    /** Number of allocations served by a recycled object. */
+    uint64_t hits() const;
+    /** Number of allocations served by a fresh object. */
+    uint64_t misses() const;
+
+    /** Hits and misses summed over all pools. */
+    static uint64_t totalHits();
+    static uint64_t totalMisses();
+
+  private:
+    struct FreeObj
+    {
+        FreeObj *next;
+    };
+
+    /** Per-thread state of a pool. */
+    struct ThreadCache
+    {
+        FreeObj *head;
+        unsigned count;
+        char *bump;
+        char *bumpEnd;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    /** Upper bound on the number of pools in the simulator. */
+    static const int maxPools = 16;
+    /** Objects moved to and from the depot at a time. */
+    static const unsigned batchSize = 256;
+    /** Bytes carved from the host for each slab. */
+    static const size_t slabBytes = 64 * 1024;
+
+    /** Caches of all pools for the calling thread, or NULL. */
+    static __thread ThreadCache *_threadCaches;
+
+    /** Allocate and register the caches of a new thread. */
+    static ThreadCache *newThreadCaches();
+
+    ThreadCache &
+    cache() const
+    {
+        if (!_threadCaches)
+            _threadCaches = newThreadCaches();
+        return _threadCaches[index];
+    }
+
+    /** Slow path of allocate() when the free list is empty. */
+    void *refill(ThreadCache &c);
+    /** Give a batch of the free list back to the depot. */
+    void spill(ThreadCache &c);
+
+    /** Sum a counter of this pool over all threads. */
+    uint64_t sum(uint64_t ThreadCache::*counter) const;
+
+    const std::string _name;
+    const size_t objSize;
+    const int index;
+
+    /** Batches of batchSize linked objects given back by threads. */
+    std::mutex depotMutex;
+    std::vector<FreeObj *> depot;
+};
+
+#endif // __BASE_POOL_ALLOC_HH__
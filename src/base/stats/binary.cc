@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "base/stats/binary.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+
+#include "base/stats/info.hh"
+#include "base/stats/text.hh"
+#include "base/cprintf.hh"
+#include "base/misc.hh"
+#include "base/output.hh"
+#include "sim/core.hh"
+
+using namespace std;
+
+namespace Stats {
+
+namespace {
+
+/** Whether any subname is set, which is when the text output uses them. */
+bool
+haveSubnames(const vector<string> &subnames)
+{
+    for (const auto &name : subnames)
+        if (!name.empty())
+            return true;
+    return false;
+}
+
+/** Subname of an element, or its index if it has none. */
+string
+subname(const vector<string> &subnames, off_type i)
+{
+    if (i < subnames.size() && !subnames[i].empty())
+        return subnames[i];
+    return to_string(i);
+}
+
+} // anonymous namespace
+
+const char Binary::magic[8] = { 'g', '5', 's', 't', 'a', 't', 's', '1' };
+
+Binary::Binary(ostream &_stream)
+    : stream(_stream), numChanged(0)
+{
+    stream.write(magic, sizeof(magic));
+    if (!valid())
+        fatal("Unable to open output stream for writing\n");
+}
+
+bool
+Binary::valid() const
+{
+    return stream.good();
+}
+
+void
+Binary::begin()
+{
+    header.clear();
+    row.clear();
+    numChanged = 0;
+}
+
+void
+Binary::end()
+{
+    string record;
+    record.push_back('R');
+    putVarint(record, curTick());
+    putVarint(record, numChanged);
+
+    stream.write(header.data(), header.size());
+    stream.write(record.data(), record.size());
+    stream.write(row.data(), row.size());
+    stream.flush();
+}
+
+bool
+Binary::noOutput(const Info &info) const
+{
+    // Unlike the text output, keep stats whose prereq is zero, as
+    // unchanged values cost nothing
+    return !info.flags.isSet(display);
+}
+
+void
+Binary::putVarint(string &buf, uint64_t v)
+{
+    while (v >= 0x80) {
+        buf.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((char)v);
+}
+
+void
+Binary::putString(string &buf, const string &s)
+{
+    putVarint(buf, s.size());
+    buf.append(s);
+}
+
+uint32_t
+Binary::columnId(const string &name, const string &desc)
+{
+    auto it = columnIds.find(name);
+    if (it != columnIds.end())
+        return it->second;
+
+    uint32_t id = lastValues.size();
+    columnIds[name] = id;
+    // Columns start as zero, so that rows carry non-zero values only
+    lastValues.push_back(0.0);
+
+    header.push_back('C');
+    putVarint(header, id);
+    putString(header, name);
+    putString(header, desc);
+    return id;
+}
+
+const Binary::StatColumns *
+Binary::cachedColumns(const Info &info, size_type size,
+                      const Buckets &buckets)
+{
+    if (info.id >= statColumns.size())
+        return NULL;
+
+    const StatColumns &cols = statColumns[info.id];
+    if (cols.ids.empty() || cols.size != size || cols.buckets != buckets)
+        return NULL;
+    return &cols;
+}
+
+const Binary::StatColumns &
+Binary::nameColumns(const Info &info, size_type size, const Buckets &buckets)
+{
+    if (info.id >= statColumns.size())
+        statColumns.resize(info.id + 1);
+
+    StatColumns &cols = statColumns[info.id];
+    vector<uint32_t> old_ids;
+    old_ids.swap(cols.ids);
+    cols.size = size;
+    cols.buckets = buckets;
+    for (const auto &name : names)
+        cols.ids.push_back(name.empty() ? noColumn : columnId(name, info.desc));
+    retire(old_ids, cols.ids);
+    return cols;
+}
+
+void
+Binary::retire(vector<uint32_t> old_ids, vector<uint32_t> new_ids)
+{
+    sort(new_ids.begin(), new_ids.end());
+    for (auto id : old_ids) {
+        if (id == noColumn || lastValues[id] == 0.0 ||
+            binary_search(new_ids.begin(), new_ids.end(), id))
+            continue;
+        lastValues[id] = 0.0;
+        putVarint(row, id);
+        row.append((const char *)&lastValues[id], sizeof(Result));
+        ++numChanged;
+    }
+}
+
+void
+Binary::record(const vector<uint32_t> &ids)
+{
+    assert(ids.size() == values.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        uint32_t id = ids[i];
+        if (id == noColumn)
+            continue;
+        // Compare bits, so that a NaN that stays NaN is unchanged
+        Result &last = lastValues[id];
+        if (memcmp(&last, &values[i], sizeof(Result)) == 0)
+            continue;
+
+        last = values[i];
+        putVarint(row, id);
+        row.append((const char *)&last, sizeof(Result));
+        ++numChanged;
+    }
+}
+
+void
+Binary::visit(const ScalarInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    values.assign(1, info.result());
+    const StatColumns *cols = cachedColumns(info, 1);
+    if (!cols) {
+        names.assign(1, info.name);
+        cols = &nameColumns(info, 1);
+    }
+    record(cols->ids);
+}
+
+void
+Binary::visit(const VectorInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    const VResult &result = info.result();
+    size_type size = result.size();
+    values.assign(result.begin(), result.end());
+    const StatColumns *cols = cachedColumns(info, size);
+    if (!cols) {
+        // Same names as the text output, without the totals that the
+        // reader can sum up
+        bool havesub = haveSubnames(info.subnames);
+        string base = info.name + info.separatorString;
+        names.clear();
+        for (off_type i = 0; i < size; ++i) {
+            if (size == 1)
+                names.push_back(info.name);
+            else if (havesub && (i >= info.subnames.size() ||
+                                 info.subnames[i].empty()))
+                names.push_back("");
+            else
+                names.push_back(base + subname(info.subnames, i));
+        }
+        cols = &nameColumns(info, size);
+    }
+    record(cols->ids);
+}
+
+void
+Binary::distNames(const string &base, const DistData &data)
+{
+    static const char *fields[] = {
+        "samples", "sum", "squares", "min_value", "max_value",
+        "underflows", "overflows"
+    };
+    for (auto field : fields)
+        names.push_back(base + "::" + field);
+    for (off_type i = 0; i < data.cvec.size(); ++i) {
+        Counter low = data.min + i * data.bucket_size;
+        names.push_back(base + "::" + ValueToString(low, 0));
+    }
+}
+
+void
+Binary::distValues(const DistData &data)
+{
+    values.push_back(data.samples);
+    values.push_back(data.sum);
+    values.push_back(data.squares);
+    values.push_back(data.min_val);
+    values.push_back(data.max_val);
+    values.push_back(data.underflow);
+    values.push_back(data.overflow);
+    values.insert(values.end(), data.cvec.begin(), data.cvec.end());
+    buckets.push_back(make_pair(data.min, data.bucket_size));
+}
+
+void
+Binary::visit(const DistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    const DistData &data = info.data;
+    values.clear();
+    buckets.clear();
+    distValues(data);
+    // Histograms may grow their buckets, which renames the columns
+    const StatColumns *cols = cachedColumns(info, values.size(), buckets);
+    if (!cols) {
+        names.clear();
+        distNames(info.name, data);
+        cols = &nameColumns(info, values.size(), buckets);
+    }
+    record(cols->ids);
+}
+
+void
+Binary::visit(const VectorDistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    values.clear();
+    buckets.clear();
+    for (const auto &data : info.data)
+        distValues(data);
+    // Each histogram may grow its buckets of its own
+    const StatColumns *cols = cachedColumns(info, values.size(), buckets);
+    if (!cols) {
+        string base = info.name + info.separatorString;
+        names.clear();
+        for (off_type i = 0; i < info.data.size(); ++i)
+            distNames(base + subname(info.subnames, i), info.data[i]);
+        cols = &nameColumns(info, values.size(), buckets);
+    }
+    record(cols->ids);
+}
+
+void
+Binary::visit(const Vector2dInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    values.assign(info.cvec.begin(), info.cvec.end());
+    const StatColumns *cols = cachedColumns(info, values.size());
+    if (!cols) {
+        names.clear();
+        for (off_type i = 0; i < info.x; ++i) {
+            string base = info.name + "_" + subname(info.subnames, i) +
+                info.separatorString;
+            for (off_type j = 0; j < info.y; ++j)
+                names.push_back(base + subname(info.y_subnames, j));
+        }
+        cols = &nameColumns(info, values.size());
+    }
+    record(cols->ids);
+}
+
+void
+Binary::visit(const FormulaInfo &info)
+{
+    visit((const VectorInfo &)info);
+}
+
+void
+Binary::visit(const SparseHistInfo &info)
+{
+    if (noOutput(info))
+        return;
+
+    // Keys come and go, so look the columns up by name every time
+    string base = info.name + info.separatorString;
+    vector<uint32_t> ids;
+    values.clear();
+    ids.push_back(columnId(base + "samples", info.desc));
+    values.push_back(info.data.samples);
+    for (const auto &entry : info.data.cmap) {
+        ids.push_back(columnId(base + ValueToString(entry.first, -1),
+                               info.desc));
+        values.push_back(entry.second);
+    }
+
+    record(ids);
+
+    // Keys that are gone since the last dump, e.g. after a reset, are
+    // zero now
+    if (info.id >= statColumns.size())
+        statColumns.resize(info.id + 1);
+    retire(statColumns[info.id].ids, ids);
+    statColumns[info.id].ids.swap(ids);
+}
+
+Output *
+initBinary(const string &filename)
+{
+    static Binary *binary = NULL;
+
+    if (!binary) {
+        ostream *os = simout.find(filename);
+        if (!os)
+            os = simout.create(filename, true);
+        binary = new Binary(*os);
+    }
+
+    return binary;
+}
+
+} // namespace Stats
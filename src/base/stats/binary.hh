@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BASE_STATS_BINARY_HH__
+#define __BASE_STATS_BINARY_HH__
+
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/stats/output.hh"
+#include "base/stats/types.hh"
+#include "base/types.hh"
+
+namespace Stats {
+
+struct DistData;
+class Info;
+
+/**
+ * Columnar binary stats output. Every stat is flattened into columns
+ * of doubles, one per scalar, vector element, distribution field or
+ * bucket, and each dump appends one row holding only the columns that
+ * changed since the previous dump. The file is a magic string
+ * followed by records, with integers as LEB128 varints and values as
+ * little-endian doubles:
+ *
+ *   'C' id name_len name desc_len desc   defines a column
+ *   'R' tick count (id value)*           appends a row
+ *
+ * A column is defined right before the first row that uses it.
+ * src/python/m5/stats/binary_reader.py reads the file back.
+ */
+class Binary : public Output
+{
+  public:
+    static const char magic[8];
+
+    Binary(std::ostream &stream);
+
+    // Implement Visit
+    virtual void visit(const ScalarInfo &info);
+    virtual void visit(const VectorInfo &info);
+    virtual void visit(const DistInfo &info);
+    virtual void visit(const VectorDistInfo &info);
+    virtual void visit(const Vector2dInfo &info);
+    virtual void visit(const FormulaInfo &info);
+    virtual void visit(const SparseHistInfo &info);
+
+    // Implement Output
+    virtual bool valid() const;
+    virtual void begin();
+    virtual void end();
+
+  private:
+    /** Minimum and bucket size of each distribution of a stat. */
+    typedef std::vector<std::pair<Counter, Counter> > Buckets;
+
+    /** Columns of a stat, valid as long as its shape is unchanged. */
+    struct StatColumns
+    {
+        size_type size;
+        Buckets buckets;
+        std::vector<uint32_t> ids;
+    };
+
+    /** Column id of values that are not output. */
+    static const uint32_t noColumn = ~0U;
+
+    bool noOutput(const Info &info) const;
+
+    /**
+     * Cached columns of a stat, or NULL if the stat is new or its
+     * shape has changed and the columns have to be named again.
+     */
+    const StatColumns *cachedColumns(const Info &info, size_type size,
+                                     const Buckets &buckets = Buckets());
+
+    /** Define the columns of a stat from the names in names. */
+    const StatColumns &nameColumns(const Info &info, size_type size,
+                                   const Buckets &buckets = Buckets());
+
+    /** Append the names of the fields of a distribution. */
+    void distNames(const std::string &base, const DistData &data);
+    /** Append the fields and the buckets of a distribution. */
+    void distValues(const DistData &data);
+
+    /**
+     * Zero the columns that a stat no longer has, e.g. histogram
+     * buckets that were merged.
+     */
+    void retire(std::vector<uint32_t> old_ids, std::vector<uint32_t> new_ids);
+
+    /** Find or define the column of a name. */
+    uint32_t columnId(const std::string &name, const std::string &desc);
+
+    /** Record the values of a stat in the current row. */
+    void record(const std::vector<uint32_t> &ids);
+
+    void putVarint(std::string &buf, uint64_t v);
+    void putString(std::string &buf, const std::string &s);
+
+    std::ostream &stream;
+
+    std::vector<StatColumns> statColumns;
+    std::unordered_map<std::string, uint32_t> columnIds;
+    /** Last value written to each column. */
+    std::vector<Result> lastValues;
+
+    /** Scratch space for the names, values and buckets of a stat. */
+    std::vector<std::string> names;
+    VResult values;
+    Buckets buckets;
+
+    /** Column definitions and row of the current dump. */
+    std::string header;
+    std::string row;
+    uint64_t numChanged;
+};
+
+Output *initBinary(const std::string &filename);
+
+} // namespace Stats
+
+#endif // __BASE_STATS_BINARY_HH__
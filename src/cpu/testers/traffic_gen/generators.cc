@@ -40,6 +40,9 @@
  *          Neha Agarwal
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "base/random.hh"
 #include "base/trace.hh"
 #include "cpu/testers/traffic_gen/generators.hh"
@@ -407,49 +410,380 @@ RandomGen::nextPacketTick(bool elastic, Tick delay) const
     }
 }
 
+ZipfGen::ZipfGen(const std::string& _name, MasterID master_id, Tick _duration,
+                 Addr start_addr, Addr end_addr, Addr _blocksize,
+                 Tick min_period, Tick max_period,
+                 uint8_t read_percent, Addr data_limit,
+                 Addr page_size, double _theta)
+    : RandomGen(_name, master_id, _duration, start_addr, end_addr,
+                _blocksize, min_period, max_period, read_percent,
+                data_limit),
+      pageSize(page_size), numPages((end_addr - start_addr) / page_size),
+      theta(_theta), alpha(0), zetan(0), eta(0)
+{
+    assert(numPages > 0);
+
+    // a uniform distribution needs none of the constants
+    if (theta == 0)
+        return;
+
+    for (uint64_t i = 1; i <= numPages; ++i)
+        zetan += 1 / std::pow((double)i, theta);
+
+    double zeta2 = 1 + std::pow(0.5, theta);
+    alpha = 1 / (1 - theta);
+    eta = (1 - std::pow(2.0 / numPages, 1 - theta)) / (1 - zeta2 / zetan);
+}
+
+uint64_t
+ZipfGen::nextRank() const
+{
+    if (theta == 0)
+        return random_mt.random<uint64_t>(0, numPages - 1);
+
+    double u = random_mt.random<double>();
+    double uz = u * zetan;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + std::pow(0.5, theta))
+        return 1;
+
+    uint64_t rank = numPages * std::pow(eta * u - eta + 1, alpha);
+    return std::min(rank, numPages - 1);
+}
+
+PacketPtr
+ZipfGen::getNextPacket()
+{
+    // choose if we generate a read or a write here
+    bool isRead = readPercent != 0 &&
+        (readPercent == 100 || random_mt.random(0, 100) < readPercent);
+
+    uint64_t rank = nextRank();
+
+    // scramble the rank with FNV-1a so that the hot pages are spread
+    // over the range, and keep a uniform distribution as it is
+    uint64_t page = rank;
+    if (theta != 0) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (int i = 0; i < 8; ++i)
+            hash = (hash ^ ((rank >> (i * 8)) & 0xff)) * 0x100000001b3ULL;
+        page = hash % numPages;
+    }
+
+    // pick a random block within the page
+    Addr addr = startAddr + page * pageSize +
+        random_mt.random<Addr>(0, pageSize - 1);
+    addr -= addr % blocksize;
+
+    DPRINTF(TrafficGen, "ZipfGen::getNextPacket: %c to addr %x, size %d, "
+            "rank %d\n", isRead ? 'r' : 'w', addr, blocksize, rank);
+
+    dataManipulated += blocksize;
+
+    return getPacket(addr, blocksize,
+                     isRead ? MemCmd::ReadReq : MemCmd::WriteReq);
+}
+
+PageLocalityGen::PageLocalityGen(const std::string& _name,
+                                 MasterID master_id, Tick _duration,
+                                 Addr start_addr, Addr end_addr,
+                                 Addr _blocksize, Tick min_period,
+                                 Tick max_period, uint8_t read_percent,
+                                 Addr data_limit, Addr page_size,
+                                 unsigned int blocks_per_page)
+    : RandomGen(_name, master_id, _duration, start_addr, end_addr,
+                _blocksize, min_period, max_period, read_percent,
+                data_limit),
+      pageSize(page_size), blocksPerPage(blocks_per_page),
+      writePage(start_addr), blocksWritten(blocks_per_page),
+      blockOrder(page_size / _blocksize)
+{
+    assert(blocksPerPage > 0 && blocksPerPage <= blockOrder.size());
+
+    for (unsigned int i = 0; i < blockOrder.size(); ++i)
+        blockOrder[i] = i;
+}
+
+void
+PageLocalityGen::enter()
+{
+    RandomGen::enter();
+
+    // start the writes on a new page
+    blocksWritten = blocksPerPage;
+}
+
+PacketPtr
+PageLocalityGen::getNextPacket()
+{
+    // choose if we generate a read or a write here
+    bool isRead = readPercent != 0 &&
+        (readPercent == 100 || random_mt.random(0, 100) < readPercent);
+
+    Addr addr;
+    if (isRead) {
+        addr = random_mt.random(startAddr, endAddr - 1);
+        addr -= addr % blocksize;
+    } else {
+        // move on to a new page once this one has had its blocks
+        if (blocksWritten == blocksPerPage) {
+            Addr num_pages = (endAddr - startAddr) / pageSize;
+            writePage = startAddr +
+                random_mt.random<Addr>(0, num_pages - 1) * pageSize;
+            blocksWritten = 0;
+        }
+
+        // draw a block not yet written to this page, by a step of a
+        // Fisher-Yates shuffle of the block indices
+        unsigned int pick = random_mt.random<unsigned int>(
+            blocksWritten, blockOrder.size() - 1);
+        std::swap(blockOrder[blocksWritten], blockOrder[pick]);
+        addr = writePage + blockOrder[blocksWritten] * blocksize;
+        ++blocksWritten;
+    }
+
+    DPRINTF(TrafficGen, "PageLocalityGen::getNextPacket: %c to addr %x, "
+            "size %d\n", isRead ? 'r' : 'w', addr, blocksize);
+
+    dataManipulated += blocksize;
+
+    return getPacket(addr, blocksize,
+                     isRead ? MemCmd::ReadReq : MemCmd::WriteReq);
+}
+
+Tick
+PhasedGen::phaseEnd(Tick when) const
+{
+    Tick period_start = when - when % phasePeriod;
+    Tick burst_start = period_start + phasePeriod - burstLength;
+    return when < burst_start ? burst_start : period_start + phasePeriod;
+}
+
+PacketPtr
+PhasedGen::getNextPacket()
+{
+    bool burst = inBurst(curTick());
+    uint8_t read_percent = burst ? burstReadPercent : readPercent;
+
+    // choose if we generate a read or a write here
+    bool isRead = read_percent != 0 &&
+        (read_percent == 100 || random_mt.random(0, 100) < read_percent);
+
+    Addr addr = random_mt.random(startAddr, endAddr - 1);
+    addr -= addr % blocksize;
+
+    DPRINTF(TrafficGen, "PhasedGen::getNextPacket: %c to addr %x, size %d, "
+            "%s\n", isRead ? 'r' : 'w', addr, blocksize,
+            burst ? "burst" : "compute");
+
+    dataManipulated += blocksize;
+
+    return getPacket(addr, blocksize,
+                     isRead ? MemCmd::ReadReq : MemCmd::WriteReq);
+}
+
+Tick
+PhasedGen::nextPacketTick(bool elastic, Tick delay) const
+{
+    if (dataLimit && dataManipulated >= dataLimit) {
+        DPRINTF(TrafficGen, "Data limit for PhasedGen reached.\n");
+        return MaxTick;
+    }
+
+    Tick now = curTick();
+    Tick wait = inBurst(now) ? random_mt.random(burstMinPeriod,
+                                                burstMaxPeriod) :
+        random_mt.random(minPeriod, maxPeriod);
+
+    // compensate for the delay experienced to not be elastic
+    if (!elastic) {
+        if (wait < delay)
+            wait = 0;
+        else
+            wait -= delay;
+    }
+
+    // if the next request falls beyond the end of the phase, take
+    // the rate of the next phase from its start instead, so that a
+    // slow compute phase does not eat into a burst
+    Tick end = phaseEnd(now);
+    if (now + wait > end) {
+        return end + (inBurst(end) ? random_mt.random(burstMinPeriod,
+                                                      burstMaxPeriod) :
+                      random_mt.random(minPeriod, maxPeriod));
+    }
+
+    return now + wait;
+}
+
 TraceGen::InputStream::InputStream(const std::string& filename)
-    : trace(filename)
+    : protoTrace(NULL), compactTrace(NULL), nextBlock(0), traceEnd(false),
+      traceCorrupt(false), stopping(false), batchPos(0)
 {
+    if (CompactTraceReader::isCompact(filename))
+        compactTrace = new CompactTraceReader(filename);
+    else
+        protoTrace = new ProtoInputStream(filename);
     init();
+    startPrefetch();
+}
+
+TraceGen::InputStream::~InputStream()
+{
+    stopPrefetch();
+    delete protoTrace;
+    delete compactTrace;
 }
 
 void
 TraceGen::InputStream::init()
 {
-    // Create a protobuf message for the header and read it from the stream
-    ProtoMessage::PacketHeader header_msg;
-    if (!trace.read(header_msg)) {
-        panic("Failed to read packet header from trace\n");
+    // The format of a compact trace is checked when it is opened,
+    // which leaves its tick frequency
+    uint64_t tick_freq;
+    if (compactTrace != NULL) {
+        nextBlock = 0;
+        tick_freq = compactTrace->tickFrequency();
+    } else {
+        // Create a protobuf message for the header and read it from
+        // the stream
+        ProtoMessage::PacketHeader header_msg;
+        if (!protoTrace->read(header_msg))
+            panic("Failed to read packet header from trace\n");
+        tick_freq = header_msg.tick_freq();
+    }
 
-        if (header_msg.tick_freq() != SimClock::Frequency) {
-            panic("Trace was recorded with a different tick frequency %d\n",
-                  header_msg.tick_freq());
-        }
+    if (tick_freq != SimClock::Frequency) {
+        panic("Trace was recorded with a different tick frequency %d\n",
+              tick_freq);
     }
 }
 
 void
 TraceGen::InputStream::reset()
 {
-    trace.reset();
+    stopPrefetch();
+    if (protoTrace != NULL)
+        protoTrace->reset();
     init();
+    startPrefetch();
 }
 
 bool
-TraceGen::InputStream::read(TraceElement& element)
+TraceGen::InputStream::readBatch(std::vector<TraceElement>& elements,
+                                 bool& corrupt)
 {
+    if (compactTrace != NULL) {
+        if (nextBlock == compactTrace->numBlocks())
+            return false;
+
+        // This runs on the prefetch thread, so leave failing to
+        // read() on the simulation thread
+        std::vector<CompactTraceRecord> records;
+        if (!compactTrace->readBlock(nextBlock, records)) {
+            corrupt = true;
+            return false;
+        }
+        ++nextBlock;
+        elements.resize(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            elements[i].cmd = records[i].cmd;
+            elements[i].addr = records[i].addr;
+            elements[i].blocksize = records[i].size;
+            elements[i].tick = records[i].tick;
+            elements[i].flags = records[i].flags;
+        }
+        return true;
+    }
+
+    elements.clear();
     ProtoMessage::Packet pkt_msg;
-    if (trace.read(pkt_msg)) {
+    while (elements.size() < batchElements && protoTrace->read(pkt_msg)) {
+        TraceElement element;
         element.cmd = pkt_msg.cmd();
         element.addr = pkt_msg.addr();
         element.blocksize = pkt_msg.size();
         element.tick = pkt_msg.tick();
         element.flags = pkt_msg.has_flags() ? pkt_msg.flags() : 0;
-        return true;
+        elements.push_back(element);
+    }
+
+    // We have reached the end of the file if nothing was read
+    return !elements.empty();
+}
+
+void
+TraceGen::InputStream::prefetch()
+{
+    std::vector<TraceElement> elements;
+    bool corrupt = false;
+    while (readBatch(elements, corrupt)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        batchTaken.wait(lock, [this] {
+                return stopping || batches.size() < maxBatches;
+            });
+        if (stopping)
+            return;
+        batches.push_back(std::vector<TraceElement>());
+        batches.back().swap(elements);
+        batchRead.notify_one();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    traceEnd = true;
+    traceCorrupt = corrupt;
+    batchRead.notify_one();
+}
+
+void
+TraceGen::InputStream::startPrefetch()
+{
+    batches.clear();
+    batch.clear();
+    batchPos = 0;
+    traceEnd = false;
+    traceCorrupt = false;
+    stopping = false;
+    prefetcher = std::thread(&TraceGen::InputStream::prefetch, this);
+}
+
+void
+TraceGen::InputStream::stopPrefetch()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        batchTaken.notify_one();
+    }
+    prefetcher.join();
+}
+
+bool
+TraceGen::InputStream::read(TraceElement& element)
+{
+    if (batchPos == batch.size()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        batchRead.wait(lock, [this] {
+                return !batches.empty() || traceEnd;
+            });
+
+        // We have reached the end of the file, or a block that the
+        // prefetch thread could not decode
+        if (batches.empty()) {
+            if (traceCorrupt)
+                fatal("Compact trace is corrupt at block %d\n", nextBlock);
+            return false;
+        }
+
+        batch.swap(batches.front());
+        batches.pop_front();
+        batchPos = 0;
+        batchTaken.notify_one();
     }
 
-    // We have reached the end of the file
-    return false;
+    element = batch[batchPos++];
+    return true;
 }
 
 Tick
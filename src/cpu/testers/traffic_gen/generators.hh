@@ -50,9 +50,16 @@
 #ifndef __CPU_TRAFFIC_GEN_GENERATORS_HH__
 #define __CPU_TRAFFIC_GEN_GENERATORS_HH__
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "base/bitfield.hh"
 #include "base/intmath.hh"
 #include "mem/packet.hh"
+#include "proto/compact_trace.hh"
 #include "proto/protoio.hh"
 
 /**
@@ -489,6 +496,222 @@ class DramRotGen : public DramGen
     unsigned int nextSeqCount;
 };
 
+/**
+ * The Zipf generator picks pages of the range with a Zipfian
+ * popularity, and a random block within the page, so that a few hot
+ * pages take most of the traffic and a long tail of cold pages the
+ * rest. The ranks are scrambled over the range, so that the hot
+ * pages are not all next to each other. Keys are drawn as in YCSB
+ * (Gray et al., "Quickly generating billion-record synthetic
+ * databases").
+ */
+class ZipfGen : public RandomGen
+{
+
+  public:
+
+    /**
+     * Create a Zipfian page sequence generator.
+     *
+     * @param _name Name to use for status and debug
+     * @param master_id MasterID set on each request
+     * @param _duration duration of this state before transitioning
+     * @param start_addr Start address
+     * @param end_addr End address
+     * @param _blocksize Size used for transactions injected
+     * @param min_period Lower limit of random inter-transaction time
+     * @param max_period Upper limit of random inter-transaction time
+     * @param read_percent Percent of transactions that are reads
+     * @param data_limit Upper limit on how much data to read/write
+     * @param page_size Size of the pages the skew applies to
+     * @param _theta Skew in [0, 1), with 0 for uniform pages
+     */
+    ZipfGen(const std::string& _name, MasterID master_id, Tick _duration,
+            Addr start_addr, Addr end_addr, Addr _blocksize,
+            Tick min_period, Tick max_period,
+            uint8_t read_percent, Addr data_limit,
+            Addr page_size, double _theta);
+
+    PacketPtr getNextPacket();
+
+  private:
+
+    /**
+     * Draw the rank of a page, with rank 0 the most popular one.
+     *
+     * @return rank in [0, numPages)
+     */
+    uint64_t nextRank() const;
+
+    /** Size of the pages */
+    const Addr pageSize;
+
+    /** Number of pages in the range */
+    const uint64_t numPages;
+
+    /** Skew of the page popularity */
+    const double theta;
+
+    /** Constants of the Zipfian distribution over the pages */
+    double alpha;
+    double zetan;
+    double eta;
+};
+
+/**
+ * The page locality generator controls how many blocks of a page
+ * are written together. Writes go to a random page, which then
+ * takes the next writes until the given number of distinct blocks
+ * of it are written, before moving on to another page. A single
+ * block per page gives sparse writes, and all blocks of the page
+ * dense ones. Reads are spread over the range as for the random
+ * generator.
+ */
+class PageLocalityGen : public RandomGen
+{
+
+  public:
+
+    /**
+     * Create a page locality sequence generator.
+     *
+     * @param _name Name to use for status and debug
+     * @param master_id MasterID set on each request
+     * @param _duration duration of this state before transitioning
+     * @param start_addr Start address
+     * @param end_addr End address
+     * @param _blocksize Size used for transactions injected
+     * @param min_period Lower limit of random inter-transaction time
+     * @param max_period Upper limit of random inter-transaction time
+     * @param read_percent Percent of transactions that are reads
+     * @param data_limit Upper limit on how much data to read/write
+     * @param page_size Size of the pages
+     * @param blocks_per_page Distinct blocks written per page visit
+     */
+    PageLocalityGen(const std::string& _name, MasterID master_id,
+                    Tick _duration, Addr start_addr, Addr end_addr,
+                    Addr _blocksize, Tick min_period, Tick max_period,
+                    uint8_t read_percent, Addr data_limit,
+                    Addr page_size, unsigned int blocks_per_page);
+
+    void enter();
+
+    PacketPtr getNextPacket();
+
+  private:
+
+    /** Size of the pages */
+    const Addr pageSize;
+
+    /** Number of distinct blocks written per page visit */
+    const unsigned int blocksPerPage;
+
+    /** Page that takes the writes */
+    Addr writePage;
+
+    /** Number of blocks written to the current page so far */
+    unsigned int blocksWritten;
+
+    /**
+     * Block indices of a page, of which the first blocksWritten
+     * ones are those already written to the current page.
+     */
+    std::vector<unsigned int> blockOrder;
+};
+
+/**
+ * The phased generator alternates between a compute phase and a
+ * write burst, as an application does that works on its data and
+ * then persists it. Time is split into periods aligned to multiples
+ * of the phase period, rather than to when the state is entered, so
+ * that with the period of the memory epochs the bursts line up with
+ * the epoch boundaries. Each period starts in the compute phase and
+ * ends in a burst, which has its own read percent and
+ * inter-transaction time. Addresses are random in the range for
+ * both phases.
+ */
+class PhasedGen : public RandomGen
+{
+
+  public:
+
+    /**
+     * Create a phased sequence generator.
+     *
+     * @param _name Name to use for status and debug
+     * @param master_id MasterID set on each request
+     * @param _duration duration of this state before transitioning
+     * @param start_addr Start address
+     * @param end_addr End address
+     * @param _blocksize Size used for transactions injected
+     * @param min_period Lower limit of random inter-transaction time
+     *                   in the compute phase
+     * @param max_period Upper limit of random inter-transaction time
+     *                   in the compute phase
+     * @param read_percent Percent of transactions that are reads in
+     *                     the compute phase
+     * @param data_limit Upper limit on how much data to read/write
+     * @param phase_period Length of a compute phase and a burst
+     * @param burst_length Length of the burst at the end of a period
+     * @param burst_min_period Lower limit of random inter-transaction
+     *                         time in the burst
+     * @param burst_max_period Upper limit of random inter-transaction
+     *                         time in the burst
+     * @param burst_read_percent Percent of transactions that are
+     *                           reads in the burst
+     */
+    PhasedGen(const std::string& _name, MasterID master_id, Tick _duration,
+              Addr start_addr, Addr end_addr, Addr _blocksize,
+              Tick min_period, Tick max_period,
+              uint8_t read_percent, Addr data_limit,
+              Tick phase_period, Tick burst_length,
+              Tick burst_min_period, Tick burst_max_period,
+              uint8_t burst_read_percent)
+        : RandomGen(_name, master_id, _duration, start_addr, end_addr,
+          _blocksize, min_period, max_period, read_percent, data_limit),
+          phasePeriod(phase_period), burstLength(burst_length),
+          burstMinPeriod(burst_min_period),
+          burstMaxPeriod(burst_max_period),
+          burstReadPercent(burst_read_percent)
+    { }
+
+    PacketPtr getNextPacket();
+
+    Tick nextPacketTick(bool elastic, Tick delay) const;
+
+  private:
+
+    /**
+     * Check if a tick falls in a burst.
+     *
+     * @param when Tick to check
+     * @return true if in the burst at the end of a period
+     */
+    bool inBurst(Tick when) const
+    { return when % phasePeriod >= phasePeriod - burstLength; }
+
+    /**
+     * Get the tick when the phase of a tick ends.
+     *
+     * @param when Tick in the phase
+     * @return first tick of the next phase
+     */
+    Tick phaseEnd(Tick when) const;
+
+    /** Length of a compute phase and a burst together */
+    const Tick phasePeriod;
+
+    /** Length of the burst at the end of each period */
+    const Tick burstLength;
+
+    /** Request generation period in the burst */
+    const Tick burstMinPeriod;
+    const Tick burstMaxPeriod;
+
+    /** Percent of transactions in the burst that should be reads */
+    const uint8_t burstReadPercent;
+};
+
 /**
  * The trace replay generator reads a trace file and plays
  * back the transactions. The trace is offset with respect to
@@ -539,15 +762,73 @@ class TraceGen : public BaseGen
     /**
      * The InputStream encapsulates a trace file and the
      * internal buffers and populates TraceElements based on
-     * the input.
+     * the input. The trace is either a protobuf trace or a compact
+     * one, and a thread of its own reads and decodes it ahead of the
+     * replay, in batches of elements.
      */
     class InputStream
     {
 
       private:
 
-        /// Input file stream for the protobuf trace
-        ProtoInputStream trace;
+        /// Input file stream for a protobuf trace, or NULL
+        ProtoInputStream* protoTrace;
+
+        /// Mapped compact trace, or NULL
+        CompactTraceReader* compactTrace;
+
+        /// Next block of a compact trace to decode
+        uint64_t nextBlock;
+
+        /// Elements in a batch read from a protobuf trace
+        static const size_t batchElements = 4096;
+
+        /// Batches that the prefetch thread reads ahead
+        static const size_t maxBatches = 4;
+
+        /**
+         * Batches read ahead, the end of the trace, whether it ended
+         * at a corrupt block, and stopping of the prefetch thread,
+         * all protected by the mutex.
+         * @{
+         */
+        std::deque<std::vector<TraceElement>> batches;
+        bool traceEnd;
+        bool traceCorrupt;
+        bool stopping;
+        std::mutex mutex;
+        /** @} */
+
+        /// Signalled when a batch is read, or at the end of the trace
+        std::condition_variable batchRead;
+
+        /// Signalled when a batch is taken, or to stop the thread
+        std::condition_variable batchTaken;
+
+        /// Thread reading the trace ahead
+        std::thread prefetcher;
+
+        /// Batch that is replayed, and the next element in it
+        std::vector<TraceElement> batch;
+        size_t batchPos;
+
+        /**
+         * Read the next batch of elements from the trace.
+         *
+         * @param elements Vector to replace the contents of
+         * @param corrupt Set if the trace ends at a corrupt block
+         * @return False at the end of the trace
+         */
+        bool readBatch(std::vector<TraceElement>& elements, bool& corrupt);
+
+        /** Main loop of the prefetch thread. */
+        void prefetch();
+
+        /** Start reading ahead from the current position. */
+        void startPrefetch();
+
+        /** Stop the prefetch thread and drop what it read. */
+        void stopPrefetch();
 
       public:
 
@@ -558,6 +839,8 @@ class TraceGen : public BaseGen
          */
         InputStream(const std::string& filename);
 
+        ~InputStream();
+
         /**
          * Reset the stream such that it can be played once
          * again.
@@ -268,7 +268,9 @@ TrafficGen::parseConfig()
                     states[id] = new IdleGen(name(), masterID, duration);
                     DPRINTF(TrafficGen, "State: %d IdleGen\n", id);
                 } else if (mode == "LINEAR" || mode == "RANDOM" ||
-                           mode == "DRAM"   || mode == "DRAM_ROTATE") {
+                           mode == "DRAM"   || mode == "DRAM_ROTATE" ||
+                           mode == "ZIPF"   || mode == "PAGE_LOCALITY" ||
+                           mode == "PHASED") {
                     uint32_t read_percent;
                     Addr start_addr;
                     Addr end_addr;
@@ -380,6 +382,101 @@ TrafficGen::parseConfig()
                                                      max_seq_count_per_rank);
                             DPRINTF(TrafficGen, "State: %d DramRotGen\n", id);
                         }
+                    } else if (mode == "ZIPF" || mode == "PAGE_LOCALITY") {
+                        // the skew and the write locality are both
+                        // per page of the range
+                        Addr page_size;
+
+                        is >> page_size;
+
+                        if (page_size < blocksize || page_size % blocksize)
+                            fatal("%s page size (%d) is not a multiple of "
+                                  "the block size (%d)\n", name(),
+                                  page_size, blocksize);
+
+                        if (end_addr - start_addr < page_size)
+                            fatal("%s address range is smaller than a page "
+                                  "(%d)\n", name(), page_size);
+
+                        if (mode == "ZIPF") {
+                            double theta;
+
+                            is >> theta;
+
+                            if (theta < 0 || theta >= 1)
+                                fatal("%s Zipf skew (%f) is not in [0, 1)\n",
+                                      name(), theta);
+
+                            states[id] = new ZipfGen(name(), masterID,
+                                                     duration, start_addr,
+                                                     end_addr, blocksize,
+                                                     min_period, max_period,
+                                                     read_percent, data_limit,
+                                                     page_size, theta);
+                            DPRINTF(TrafficGen, "State: %d ZipfGen, page "
+                                    "size %d, theta %f\n", id, page_size,
+                                    theta);
+                        } else {
+                            unsigned int blocks_per_page;
+
+                            is >> blocks_per_page;
+
+                            if (blocks_per_page == 0 ||
+                                blocks_per_page > page_size / blocksize)
+                                fatal("%s cannot write %d blocks of a page "
+                                      "of %d blocks\n", name(),
+                                      blocks_per_page, page_size / blocksize);
+
+                            states[id] = new PageLocalityGen(name(), masterID,
+                                                     duration, start_addr,
+                                                     end_addr, blocksize,
+                                                     min_period, max_period,
+                                                     read_percent, data_limit,
+                                                     page_size,
+                                                     blocks_per_page);
+                            DPRINTF(TrafficGen, "State: %d PageLocalityGen, "
+                                    "page size %d, %d blocks per page\n", id,
+                                    page_size, blocks_per_page);
+                        }
+                    } else if (mode == "PHASED") {
+                        // the compute phase uses the parameters above,
+                        // and the burst at the end of each period its
+                        // own read percent and period
+                        Tick phase_period;
+                        Tick burst_length;
+                        uint32_t burst_read_percent;
+                        Tick burst_min_period;
+                        Tick burst_max_period;
+
+                        is >> phase_period >> burst_length >>
+                            burst_read_percent >> burst_min_period >>
+                            burst_max_period;
+
+                        if (phase_period == 0 || burst_length > phase_period)
+                            fatal("%s burst length (%d) does not fit in the "
+                                  "phase period (%d)\n", name(),
+                                  burst_length, phase_period);
+
+                        if (burst_read_percent > 100)
+                            fatal("%s cannot have more than 100%% reads in a "
+                                  "burst", name());
+
+                        if (burst_min_period > burst_max_period)
+                            fatal("%s cannot have burst min_period > "
+                                  "max_period", name());
+
+                        states[id] = new PhasedGen(name(), masterID,
+                                                   duration, start_addr,
+                                                   end_addr, blocksize,
+                                                   min_period, max_period,
+                                                   read_percent, data_limit,
+                                                   phase_period, burst_length,
+                                                   burst_min_period,
+                                                   burst_max_period,
+                                                   burst_read_percent);
+                        DPRINTF(TrafficGen, "State: %d PhasedGen, period %d, "
+                                "burst %d, %d%% reads\n", id, phase_period,
+                                burst_length, burst_read_percent);
                     }
                 } else {
                     fatal("%s: Unknown traffic generator mode: %s",
@@ -40,6 +40,7 @@
 #          Andreas Hansson
 
 from m5.params import *
+from m5.proxy import *
 from MemObject import MemObject
 
 class Bridge(MemObject):
@@ -52,3 +53,15 @@ class Bridge(MemObject):
     delay = Param.Latency('0ns', "The latency of this bridge")
     ranges = VectorParam.AddrRange([AllMemory],
                                    "Address ranges to pass through the bridge")
+
+# A bridge whose master side lives on another event queue, typically
+# one that is simulated by its own thread in a parallel simulation.
+# The delay must be at least the simulation quantum (Root.sim_quantum).
+class SyncBridge(MemObject):
+    type = 'SyncBridge'
+    cxx_header = "mem/sync_bridge.hh"
+    slave = SlavePort('Slave port')
+    master = MasterPort('Master port')
+    master_eventq_index = Param.UInt32(Parent.eventq_index,
+                                       "Event queue of the master side")
+    delay = Param.Latency('1ns', "The latency through this bridge")
@@ -63,6 +63,12 @@ class CommMonitor(MemObject):
     # packet trace output file, disabled by default
     trace_file = Param.String("", "Packet trace output file")
 
+    # encoding and compressing the trace is left to a thread of its
+    # own, which takes the packets from a ring buffer
+    trace_ring_records = Param.Unsigned(65536, "Packets buffered for the " \
+                                            "trace writer thread, 0 to " \
+                                            "write the trace inline")
+
     # control the sample period window length of this monitor
     sample_period = Param.Clock("1ms", "Sample period for histograms")
 
@@ -84,6 +90,16 @@ class CommMonitor(MemObject):
     latency_bins = Param.Unsigned('20', "# bins in latency histograms")
     disable_latency_hists = Param.Bool(False, "Disable latency histograms")
 
+    # percentiles of the latency, from log-linear histograms that keep
+    # a number of significant bits of each latency up to a maximum,
+    # over the stats period and as the worst of the sample periods
+    latency_percentiles = VectorParam.Float([50, 90, 99, 99.9, 99.99],
+                                            "Latency percentiles to report")
+    latency_precision_bits = Param.Unsigned(7, "Significant bits of " \
+                                                "latencies in percentiles")
+    latency_max = Param.Latency('1ms', "Largest latency told apart in " \
+                                    "percentiles")
+
     # inter transaction time (ITT) distributions in uniformly sized
     # bins up to the maximum, independently for read-to-read,
     # write-to-write and the combined request-to-request that does not
@@ -113,3 +129,6 @@ class CommMonitor(MemObject):
 
     # optional stack distance calculator
     stack_dist_calc = Param.StackDistCalc(NULL, "Stack distance calculator")
+
+    # optional per-epoch footprint calculator
+    footprint_calc = Param.FootprintCalc(NULL, "Footprint calculator")
@@ -0,0 +1,48 @@
+# Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+from m5.SimObject import SimObject
+from m5.params import *
+
+# Per-epoch footprint of the memory accesses passing a CommMonitor,
+# from pages sampled by hashing, to size the BTT and PTT of the hybrid
+# memory. The block and page bits match those of the hybrid memory.
+class FootprintCalc(SimObject):
+    type = 'FootprintCalc'
+    cxx_header = "mem/footprint_calc.hh"
+
+    epoch_length = Param.Latency('10ms', "Length of an epoch")
+
+    block_bits = Param.Unsigned(6, "Number of bits of a block")
+    page_bits = Param.Unsigned(12, "Number of bits of a page")
+
+    # pages with fewer written blocks are left to the BTT
+    dense_blocks = Param.Unsigned(16, "Written blocks from which a page "
+                                  "counts towards the PTT")
+
+    sampling_rate = Param.Float(0.01, "Fraction of pages sampled")
+
+    hist_bins = Param.Unsigned(20, "Bins in the per-epoch histograms")
@@ -14,6 +14,9 @@ import DRAMCtrl
 #   Benjamin C. Lee, Engin Ipek, Onur Mutlu, and Doug Burger.
 #   Architecting phase change memory as a scalable dram alternative.
 #   In ISCA, 2009.
+# The currents are still those of the DDR3 device, so that the DRAMPower
+# energy of this controller is not that of a PCM array. The array
+# energy is modeled per bit by thynvm::EnergyModel instead.
 class DDR3_1600_x64_PCM(DRAMCtrl.DDR3_1600_x64):
     tRCD = '60ns'
     tRP = '150ns'
@@ -52,3 +52,11 @@ class StackDistCalc(SimObject):
     # logarithmic histogram bins and enable/disable
     log_hist_bins = Param.Unsigned('32', "Bins in logarithmic histograms")
     disable_log_hists = Param.Bool(False, "Disable logarithmic histograms")
+
+    # sampling of the addresses by hashing, with the stack distances
+    # and histograms scaled by the rate, and either a fixed rate or a
+    # bound on the addresses tracked that lowers the rate as needed
+    sampling_rate = Param.Float(1.0, "Fraction of addresses sampled, "
+                                "1 to track all")
+    sampling_max_addrs = Param.Unsigned(0, "Addresses tracked at most "
+                                        "when sampling, 0 for a fixed rate")
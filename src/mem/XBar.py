@@ -110,6 +110,14 @@ class SnoopFilter(SimObject):
     # through a coherent crossbar.
     lookup_latency = Param.Cycles(1, "Lookup latency")
 
+    # Capacity in bytes of the lines the snoop filter can track, 0
+    # leaves it unbounded. A bounded filter is organised like a
+    # set-associative cache and back-invalidates the holders of the
+    # lines it evicts.
+    max_capacity = Param.MemorySize('0B', "Maximum capacity of tracked "
+                                    "lines, 0 for unbounded")
+    assoc = Param.Unsigned(8, "Associativity of a bounded snoop filter")
+
     system = Param.System(Parent.any, "System that the crossbar belongs to.")
 
 # We use a coherent crossbar to connect multiple masters to the L2
@@ -62,6 +62,13 @@ class BaseCache(MemObject):
     tgts_per_mshr = Param.Unsigned("Max number of accesses per MSHR")
     write_buffers = Param.Unsigned(8, "Number of write buffers")
 
+    eager_writeback_row_size = Param.MemorySize('0B',
+        "Write back the other dirty blocks of the memory row of a dirty "
+        "victim along with it, keeping them clean (0 to disable). The row "
+        "is the aligned address range of this size, which is only one "
+        "DRAM row with the row bits above the column bits and no channel "
+        "interleaving below the row size")
+
     forward_snoops = Param.Bool(True,
         "Forward snoops from mem side to cpu side")
     is_top_level = Param.Bool(False, "Is this cache at the top level (e.g. L1)")
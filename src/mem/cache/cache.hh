@@ -193,6 +193,22 @@ class Cache : public BaseCache
      */
     const bool prefetchOnAccess;
 
+    /**
+     * Size of the memory row whose dirty blocks are written back along
+     * with a dirty victim, or 0 if eager writeback is disabled. Meant for
+     * the last-level cache, so that the memory controller sees the writes
+     * to an open row back to back. The row is taken to be the aligned
+     * address range of this size, as the cache knows nothing of the
+     * address mapping of the controller. That only holds for mappings
+     * with the row above the column bits (RoRaBaChCo, or RoRaBaCoCh with
+     * a single channel) and channels, if any, interleaved at no less
+     * than the row size.
+     */
+    const unsigned eagerWritebackRowSize;
+
+    /** Number of dirty blocks cleaned along with a victim. */
+    Stats::Scalar eagerWritebacks;
+
     /**
      * @todo this is a temporary workaround until the 4-phase code is committed.
      * upstream caches need this packet until true is returned, so hold it for
@@ -304,9 +320,21 @@ class Cache : public BaseCache
     /**
      * Create a writeback request for the given block.
      * @param blk The block to writeback.
+     * @param resident True if the block stays in the cache, in which
+     * case it keeps its task and ownership, and the writeback is
+     * flagged block cached so that snoop filters keep us a holder.
      * @return The writeback request for the block.
      */
-    PacketPtr writebackBlk(CacheBlk *blk);
+    PacketPtr writebackBlk(CacheBlk *blk, bool resident = false);
+
+    /**
+     * Write back the victim along with the other dirty blocks in its
+     * memory row, in address order. The other blocks stay in the cache,
+     * clean.
+     * @param victim The dirty block being replaced.
+     * @param writebacks List to append the writebacks to.
+     */
+    void eagerWriteback(CacheBlk *victim, PacketList &writebacks);
 
 
     void memWriteback();
@@ -54,6 +54,7 @@
  * Cache definitions.
  */
 
+#include "base/intmath.hh"
 #include "base/misc.hh"
 #include "base/types.hh"
 #include "debug/Cache.hh"
@@ -70,8 +71,14 @@ Cache::Cache(const Params *p)
       tags(p->tags),
       prefetcher(p->prefetcher),
       doFastWrites(true),
-      prefetchOnAccess(p->prefetch_on_access)
+      prefetchOnAccess(p->prefetch_on_access),
+      eagerWritebackRowSize(p->eager_writeback_row_size)
 {
+    if (eagerWritebackRowSize && (!isPowerOf2(eagerWritebackRowSize) ||
+                                  eagerWritebackRowSize < blkSize))
+        fatal("%s: eager writeback row size must be a power of 2 and no "
+              "smaller than a block\n", name());
+
     tempBlock = new CacheBlk();
     tempBlock->data = new uint8_t[blkSize];
 
@@ -98,6 +105,11 @@ void
 Cache::regStats()
 {
     BaseCache::regStats();
+
+    eagerWritebacks
+        .name(name() + ".eager_writebacks")
+        .desc("number of dirty blocks written back along with a victim")
+        ;
 }
 
 void
@@ -1325,7 +1337,7 @@ Cache::recvTimingResp(PacketPtr pkt)
 }
 
 PacketPtr
-Cache::writebackBlk(CacheBlk *blk)
+Cache::writebackBlk(CacheBlk *blk, bool resident)
 {
     assert(blk && blk->isValid() && blk->isDirty());
 
@@ -1338,11 +1350,17 @@ Cache::writebackBlk(CacheBlk *blk)
         writebackReq->setFlags(Request::SECURE);
 
     writebackReq->taskId(blk->task_id);
-    blk->task_id= ContextSwitchTaskId::Unknown;
-    blk->tickInserted = curTick();
+    if (!resident) {
+        blk->task_id= ContextSwitchTaskId::Unknown;
+        blk->tickInserted = curTick();
+    }
 
     PacketPtr writeback = new Packet(writebackReq, MemCmd::Writeback);
-    if (blk->isWritable()) {
+    // a block that we keep keeps its ownership too, and snoop filters
+    // below must keep tracking us as a holder
+    if (resident) {
+        writeback->setBlockCached();
+    } else if (blk->isWritable()) {
         writeback->setSupplyExclusive();
     }
     writeback->allocate();
@@ -1352,6 +1370,34 @@ Cache::writebackBlk(CacheBlk *blk)
     return writeback;
 }
 
+void
+Cache::eagerWriteback(CacheBlk *victim, PacketList &writebacks)
+{
+    Addr victim_addr = tags->regenerateBlkAddr(victim->tag, victim->set);
+    Addr row_addr = victim_addr & ~(Addr)(eagerWritebackRowSize - 1);
+    bool is_secure = victim->isSecure();
+
+    for (Addr addr = row_addr; addr < row_addr + eagerWritebackRowSize;
+         addr += blkSize) {
+        if (addr == victim_addr) {
+            writebacks.push_back(writebackBlk(victim));
+            continue;
+        }
+
+        // leave blocks with an outstanding request alone, as for the
+        // victim in allocateBlock()
+        CacheBlk *blk = tags->findBlock(addr, is_secure);
+        if (!blk || !blk->isDirty() || mshrQueue.findMatch(addr, is_secure))
+            continue;
+
+        DPRINTF(Cache, "eager writeback of %#llx (%s) along with %#llx\n",
+                addr, is_secure ? "s" : "ns", victim_addr);
+
+        writebacks.push_back(writebackBlk(blk, true));
+        ++eagerWritebacks;
+    }
+}
+
 void
 Cache::memWriteback()
 {
@@ -1436,7 +1482,11 @@ Cache::allocateBlock(Addr addr, bool is_secure, PacketList &writebacks)
 
             if (blk->isDirty()) {
                 // Save writeback packet for handling by caller
-                writebacks.push_back(writebackBlk(blk));
+                if (eagerWritebackRowSize) {
+                    eagerWriteback(blk, writebacks);
+                } else {
+                    writebacks.push_back(writebackBlk(blk));
+                }
             }
         }
     }
@@ -1649,6 +1699,12 @@ Cache::handleSnoop(PacketPtr pkt, CacheBlk *blk, bool is_timing,
         }
     }
 
+    if (pkt->cmd == MemCmd::InvalidationReq && !is_timing) {
+        // caches above may have written the line back into this one
+        // while handling a back-invalidation, so look it up again
+        blk = tags->findBlock(pkt->getAddr(), pkt->isSecure());
+    }
+
     if (!blk || !blk->isValid()) {
         DPRINTF(Cache, "%s snoop miss for %s addr %#llx size %d\n",
                 __func__, pkt->cmdString(), pkt->getAddr(), pkt->getSize());
@@ -1717,6 +1773,21 @@ Cache::handleSnoop(PacketPtr pkt, CacheBlk *blk, bool is_timing,
         }
     }
 
+    if (pkt->cmd == MemCmd::InvalidationReq && blk->isDirty()) {
+        // back-invalidation from a bounded snoop filter, which does
+        // not take data, so write the block back before dropping it
+        PacketPtr wb_pkt = writebackBlk(blk);
+        if (is_timing) {
+            allocateWriteBuffer(wb_pkt, clockEdge(forwardLatency), true);
+            // tell the filter to keep tracking us until it sees the
+            // writeback
+            pkt->setBlockCached();
+        } else {
+            memSidePort->sendAtomic(wb_pkt);
+            delete wb_pkt;
+        }
+    }
+
     if (!respond && is_timing && is_deferred) {
         // if it's a deferred timing snoop then we've made a copy of
         // both the request and the packet, and so if we're not using
@@ -1724,11 +1795,12 @@ Cache::handleSnoop(PacketPtr pkt, CacheBlk *blk, bool is_timing,
         DPRINTF(Cache, "Deleting pkt %p and request %p for cmd %s addr: %p\n",
                 pkt, pkt->req, pkt->cmdString(), pkt->getAddr());
 
-        // the packets needs a response (just not from us), so we also
+        // if the packets needs a response (just not from us), we also
         // need to delete the request and not rely on the packet
-        // destructor
-        assert(pkt->needsResponse());
-        delete pkt->req;
+        // destructor, which only deletes the requests of packets
+        // without a response
+        if (pkt->needsResponse())
+            delete pkt->req;
         delete pkt;
     }
 
@@ -1773,6 +1845,16 @@ Cache::recvTimingSnoopReq(PacketPtr pkt)
         return;
     }
 
+    // Refuse back-invalidations from a bounded snoop filter on MSHR
+    // hits, as the block is about to change anyway, and have the
+    // filter keep tracking us and try again later
+    if (mshr && pkt->cmd == MemCmd::InvalidationReq) {
+        DPRINTF(Cache, "Refusing back-invalidation on MSHR hit %#x\n",
+                pkt->getAddr());
+        pkt->setBlockCached();
+        return;
+    }
+
     // Let the MSHR itself track the snoop and decide whether we want
     // to go ahead and do the regular cache snoop
     if (mshr && mshr->handleSnoop(pkt, order++)) {
@@ -1800,25 +1882,35 @@ Cache::recvTimingSnoopReq(PacketPtr pkt)
         PacketPtr wb_pkt = wb_entry->getTarget()->pkt;
         assert(wb_pkt->cmd == MemCmd::Writeback);
 
-        assert(!pkt->memInhibitAsserted());
-        pkt->assertMemInhibit();
-        if (!pkt->needsExclusive()) {
-            pkt->assertShared();
-            // the writeback is no longer the exclusive copy in the system
-            wb_pkt->clearSupplyExclusive();
+        if (pkt->cmd == MemCmd::InvalidationReq) {
+            // back-invalidation from a bounded snoop filter: nobody
+            // takes the data, so let the writeback proceed and have
+            // the filter track us until it has seen it, and as the
+            // block goes below, the writeback no longer leaves it here
+            pkt->setBlockCached();
+            wb_pkt->clearBlockCached();
         } else {
-            // if we're not asserting the shared line, we need to
-            // invalidate our copy.  we'll do that below as long as
-            // the packet's invalidate flag is set...
-            assert(pkt->isInvalidate());
-        }
-        doTimingSupplyResponse(pkt, wb_pkt->getConstPtr<uint8_t>(),
-                               false, false);
+            assert(!pkt->memInhibitAsserted());
+            pkt->assertMemInhibit();
+            if (!pkt->needsExclusive()) {
+                pkt->assertShared();
+                // the writeback is no longer the exclusive copy in the
+                // system
+                wb_pkt->clearSupplyExclusive();
+            } else {
+                // if we're not asserting the shared line, we need to
+                // invalidate our copy.  we'll do that below as long as
+                // the packet's invalidate flag is set...
+                assert(pkt->isInvalidate());
+            }
+            doTimingSupplyResponse(pkt, wb_pkt->getConstPtr<uint8_t>(),
+                                   false, false);
 
-        if (pkt->isInvalidate()) {
-            // Invalidation trumps our writeback... discard here
-            markInService(wb_entry, false);
-            delete wb_pkt;
+            if (pkt->isInvalidate()) {
+                // Invalidation trumps our writeback... discard here
+                markInService(wb_entry, false);
+                delete wb_pkt;
+            }
         }
     }
 
@@ -66,7 +66,8 @@ MSHR::MSHR() : readyTime(0), _isUncacheable(false), downstreamPending(false),
                postInvalidate(false), postDowngrade(false),
                queue(NULL), order(0), blkAddr(0),
                blkSize(0), isSecure(false), inService(false),
-               isForward(false), threadNum(InvalidThreadID), data(NULL)
+               isForward(false), threadNum(InvalidThreadID), data(NULL),
+               nextMatch(NULL)
 {
 }
 
@@ -367,7 +368,7 @@ MSHR::handleSnoop(PacketPtr pkt, Counter _order)
         // get to send this packet.
         PacketPtr cp_pkt = nullptr;
 
-        if (isPendingDirty()) {
+        if (isPendingDirty() && pkt->needsResponse()) {
             // Case 1: The new packet will need to get the response from the
             // MSHR already queued up here
             cp_pkt = new Packet(pkt, true, true);
@@ -378,7 +379,8 @@ MSHR::handleSnoop(PacketPtr pkt, Counter _order)
             pkt->setSupplyExclusive();
         } else {
             // Case 2: We only need to buffer the packet for information
-            // purposes; the original request can proceed without waiting
+            // purposes; the original request can proceed without waiting,
+            // and so does a snoop that expects no response at all
             // => Create a copy of the request, as that may get deallocated as
             // well
             cp_pkt = new Packet(new Request(*pkt->req), pkt->cmd);
@@ -49,6 +49,8 @@
 #define __MEM_CACHE_MSHR_HH__
 
 #include <list>
+#include <map>
+#include <utility>
 
 #include "base/printable.hh"
 #include "mem/packet.hh"
@@ -140,6 +142,12 @@ class MSHR : public Packet::SenderState, public Printable
     /** MSHR list const_iterator. */
     typedef List::const_iterator ConstIterator;
 
+    /**
+     * MSHRs ordered by the time they become ready, ties broken by the
+     * order in which they were made ready.
+     */
+    typedef std::map<std::pair<Tick, int64_t>, MSHR *> ReadyMap;
+
     /** Pointer to queue containing this MSHR. */
     MSHRQueue *queue;
 
@@ -194,7 +202,7 @@ class MSHR : public Packet::SenderState, public Printable
      * Pointer to this MSHR on the ready list.
      * @sa MissQueue, MSHRQueue::readyList
      */
-    Iterator readyIter;
+    ReadyMap::iterator readyIter;
 
     /**
      * Pointer to this MSHR on the allocated list.
@@ -202,6 +210,12 @@ class MSHR : public Packet::SenderState, public Printable
      */
     Iterator allocIter;
 
+    /**
+     * Next allocated MSHR with the same block address, in allocation order.
+     * @sa MSHRQueue::addrIndex
+     */
+    MSHR *nextMatch;
+
     /** List of all requests that match the address */
     TargetList targets;
 
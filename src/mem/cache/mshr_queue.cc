@@ -56,7 +56,8 @@ MSHRQueue::MSHRQueue(const std::string &_label,
                      int _index)
     : label(_label), numEntries(num_entries + reserve - 1),
       numReserve(reserve), demandReserve(demand_reserve),
-      registers(numEntries), drainManager(NULL), allocated(0),
+      registers(numEntries), addrIndex(numEntries), nextReadySeq(0),
+      nextFrontSeq(-1), drainManager(NULL), allocated(0),
       inServiceEntries(0), index(_index)
 {
     for (int i = 0; i < numEntries; ++i) {
@@ -68,14 +69,14 @@ MSHRQueue::MSHRQueue(const std::string &_label,
 MSHR *
 MSHRQueue::findMatch(Addr blk_addr, bool is_secure) const
 {
-    for (const auto& mshr : allocatedList) {
+    MSHR * const *head = addrIndex.find(blk_addr);
+    for (MSHR *mshr = head ? *head : NULL; mshr; mshr = mshr->nextMatch) {
         // we ignore any MSHRs allocated for uncacheable accesses and
         // simply ignore them when matching, in the cache we never
         // check for matches when adding new uncacheable entries, and
         // we do not want normal cacheable accesses being added to an
         // MSHR serving an uncacheable access
-        if (!mshr->isUncacheable() && mshr->blkAddr == blk_addr &&
-            mshr->isSecure == is_secure) {
+        if (!mshr->isUncacheable() && mshr->isSecure == is_secure) {
             return mshr;
         }
     }
@@ -89,9 +90,9 @@ MSHRQueue::findMatches(Addr blk_addr, bool is_secure,
     // Need an empty vector
     assert(matches.empty());
     bool retval = false;
-    for (const auto& mshr : allocatedList) {
-        if (!mshr->isUncacheable() && mshr->blkAddr == blk_addr &&
-            mshr->isSecure == is_secure) {
+    MSHR * const *head = addrIndex.find(blk_addr);
+    for (MSHR *mshr = head ? *head : NULL; mshr; mshr = mshr->nextMatch) {
+        if (!mshr->isUncacheable() && mshr->isSecure == is_secure) {
             retval = true;
             matches.push_back(mshr);
         }
@@ -104,8 +105,9 @@ bool
 MSHRQueue::checkFunctional(PacketPtr pkt, Addr blk_addr)
 {
     pkt->pushLabel(label);
-    for (const auto& mshr : allocatedList) {
-        if (mshr->blkAddr == blk_addr && mshr->checkFunctional(pkt)) {
+    MSHR * const *head = addrIndex.find(blk_addr);
+    for (MSHR *mshr = head ? *head : NULL; mshr; mshr = mshr->nextMatch) {
+        if (mshr->checkFunctional(pkt)) {
             pkt->popLabel();
             return true;
         }
@@ -118,29 +120,64 @@ MSHRQueue::checkFunctional(PacketPtr pkt, Addr blk_addr)
 MSHR *
 MSHRQueue::findPending(Addr blk_addr, bool is_secure) const
 {
-    for (const auto& mshr : readyList) {
-        if (mshr->blkAddr == blk_addr && mshr->isSecure == is_secure) {
-            return mshr;
+    // Entries that are not in service are exactly those on the ready
+    // list; return the one that comes first there
+    MSHR *pending = NULL;
+    MSHR * const *head = addrIndex.find(blk_addr);
+    for (MSHR *mshr = head ? *head : NULL; mshr; mshr = mshr->nextMatch) {
+        if (!mshr->inService && mshr->isSecure == is_secure &&
+            (!pending || mshr->readyIter->first < pending->readyIter->first)) {
+            pending = mshr;
         }
     }
-    return NULL;
+    return pending;
 }
 
 
-MSHR::Iterator
+MSHR::ReadyMap::iterator
 MSHRQueue::addToReadyList(MSHR *mshr)
 {
-    if (readyList.empty() || readyList.back()->readyTime <= mshr->readyTime) {
-        return readyList.insert(readyList.end(), mshr);
+    // Entries ready at the same time keep the order they were added in
+    return readyList.insert(readyList.end(), std::make_pair(
+        std::make_pair(mshr->readyTime, nextReadySeq++), mshr));
+}
+
+
+void
+MSHRQueue::addToIndex(MSHR *mshr)
+{
+    mshr->nextMatch = NULL;
+    MSHR **head = addrIndex.find(mshr->blkAddr);
+    if (!head) {
+        addrIndex.insert(mshr->blkAddr, mshr);
+        return;
     }
+    MSHR *tail = *head;
+    while (tail->nextMatch)
+        tail = tail->nextMatch;
+    tail->nextMatch = mshr;
+}
+
 
-    for (auto i = readyList.begin(); i != readyList.end(); ++i) {
-        if ((*i)->readyTime > mshr->readyTime) {
-            return readyList.insert(i, mshr);
+void
+MSHRQueue::removeFromIndex(MSHR *mshr)
+{
+    MSHR **head = addrIndex.find(mshr->blkAddr);
+    assert(head);
+    if (*head == mshr) {
+        if (mshr->nextMatch)
+            *head = mshr->nextMatch;
+        else
+            addrIndex.erase(mshr->blkAddr);
+    } else {
+        MSHR *prev = *head;
+        while (prev->nextMatch != mshr) {
+            prev = prev->nextMatch;
+            assert(prev);
         }
+        prev->nextMatch = mshr->nextMatch;
     }
-    assert(false);
-    return readyList.end();  // keep stupid compilers happy
+    mshr->nextMatch = NULL;
 }
 
 
@@ -156,6 +193,7 @@ MSHRQueue::allocate(Addr blk_addr, unsigned blk_size, PacketPtr pkt,
     mshr->allocate(blk_addr, blk_size, pkt, when_ready, order);
     mshr->allocIter = allocatedList.insert(allocatedList.end(), mshr);
     mshr->readyIter = addToReadyList(mshr);
+    addToIndex(mshr);
 
     allocated += 1;
     return mshr;
@@ -172,6 +210,7 @@ MSHR::Iterator
 MSHRQueue::deallocateOne(MSHR *mshr)
 {
     MSHR::Iterator retval = allocatedList.erase(mshr->allocIter);
+    removeFromIndex(mshr);
     freeList.push_front(mshr);
     allocated--;
     if (mshr->inService) {
@@ -195,9 +234,12 @@ void
 MSHRQueue::moveToFront(MSHR *mshr)
 {
     if (!mshr->inService) {
-        assert(mshr == *(mshr->readyIter));
+        assert(mshr == mshr->readyIter->second);
         readyList.erase(mshr->readyIter);
-        mshr->readyIter = readyList.insert(readyList.begin(), mshr);
+        Tick key = readyList.empty() ? mshr->readyTime :
+            std::min(mshr->readyTime, readyList.begin()->first.first);
+        mshr->readyIter = readyList.insert(readyList.begin(), std::make_pair(
+            std::make_pair(key, nextFrontSeq--), mshr));
     }
 }
 
@@ -50,6 +50,7 @@
 
 #include <vector>
 
+#include "base/flat_addr_map.hh"
 #include "mem/cache/mshr.hh"
 #include "mem/packet.hh"
 #include "sim/drain.hh"
@@ -88,14 +89,31 @@ class MSHRQueue : public Drainable
     /** Holds pointers to all allocated entries. */
     MSHR::List allocatedList;
     /** Holds pointers to entries that haven't been sent to the bus. */
-    MSHR::List readyList;
+    MSHR::ReadyMap readyList;
     /** Holds non allocated entries. */
     MSHR::List freeList;
 
+    /**
+     * Maps a block address to the oldest allocated entry for it. The other
+     * entries for the same address are chained through MSHR::nextMatch, so
+     * that lookups do not have to walk the allocated or ready lists.
+     */
+    FlatAddrMap<MSHR *> addrIndex;
+
+    /** Tie breakers for entries that become ready at the same time. */
+    int64_t nextReadySeq;
+    int64_t nextFrontSeq;
+
     /** Drain manager to inform of a completed drain */
     DrainManager *drainManager;
 
-    MSHR::Iterator addToReadyList(MSHR *mshr);
+    MSHR::ReadyMap::iterator addToReadyList(MSHR *mshr);
+
+    /** Add an allocated entry to the address index. */
+    void addToIndex(MSHR *mshr);
+
+    /** Remove an entry from the address index. */
+    void removeFromIndex(MSHR *mshr);
 
 
   public:
@@ -247,15 +265,17 @@ class MSHRQueue : public Drainable
      */
     MSHR *getNextMSHR() const
     {
-        if (readyList.empty() || readyList.front()->readyTime > curTick()) {
+        if (readyList.empty() ||
+            readyList.begin()->second->readyTime > curTick()) {
             return NULL;
         }
-        return readyList.front();
+        return readyList.begin()->second;
     }
 
     Tick nextMSHRReadyTime() const
     {
-        return readyList.empty() ? MaxTick : readyList.front()->readyTime;
+        return readyList.empty() ? MaxTick :
+            readyList.begin()->second->readyTime;
     }
 
     unsigned int drain(DrainManager *dm);
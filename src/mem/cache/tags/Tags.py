@@ -75,3 +75,5 @@ class FALRU(BaseTags):
     type = 'FALRU'
     cxx_class = 'FALRU'
     cxx_header = "mem/cache/tags/fa_lru.hh"
+    min_tracked_size = Param.MemorySize('128kB',
+        "smallest cache size to track hits and misses for")
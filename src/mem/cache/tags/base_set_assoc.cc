@@ -87,6 +87,8 @@ BaseSetAssoc::BaseSetAssoc(const Params *p)
         sets[i].assoc = assoc;
 
         sets[i].blks = new BlkType*[assoc];
+        sets[i].baseBlk = &blks[blkIndex];
+        sets[i].tags = new Addr[assoc];
 
         // link in the data blocks
         for (unsigned j = 0; j < assoc; ++j) {
@@ -102,7 +104,7 @@ BaseSetAssoc::BaseSetAssoc(const Params *p)
 
             // Setting the tag to j is just to prevent long chains in the hash
             // table; won't matter because the block is invalid
-            blk->tag = j;
+            sets[i].setTag(blk, j);
             blk->whenReady = 0;
             blk->isTouched = false;
             blk->size = blkSize;
@@ -114,6 +116,10 @@ BaseSetAssoc::BaseSetAssoc(const Params *p)
 
 BaseSetAssoc::~BaseSetAssoc()
 {
+    for (unsigned i = 0; i < numSets; ++i) {
+        delete [] sets[i].blks;
+        delete [] sets[i].tags;
+    }
     delete [] dataBlks;
     delete [] blks;
     delete [] sets;
@@ -277,7 +277,7 @@ public:
          blk->isTouched = true;
 
          // Set tag for new block.  Caller is responsible for setting status.
-         blk->tag = extractTag(addr);
+         sets[blk->set].setTag(blk, extractTag(addr));
 
          // deal with what we are bringing in
          assert(master_id < cache->system->maxMasters());
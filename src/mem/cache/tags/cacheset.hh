@@ -50,6 +50,12 @@
 
 #include <cassert>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "mem/cache/blk.hh" // base class
 
 /**
@@ -65,6 +71,27 @@ class CacheSet
     /** Cache blocks in this set, maintained in LRU order 0 = MRU. */
     Blktype **blks;
 
+    /**
+     * The first of the assoc contiguous blocks that make up this set. A
+     * block's physical way is its offset from baseBlk, which, unlike its
+     * position in blks, does not change on replacement updates.
+     */
+    Blktype *baseBlk;
+
+    /**
+     * Packed copy of the block tags, indexed by physical way, so that
+     * lookups can compare several ways at once with SIMD instructions.
+     * Must be kept in sync with the tag of each block through setTag().
+     */
+    Addr *tags;
+
+    /**
+     * Set the tag of a block in this set.
+     * @param blk The block, which must belong to this set.
+     * @param tag The new tag.
+     */
+    void setTag(Blktype *blk, Addr tag);
+
     /**
      * Find a block matching the tag in this set.
      * @param way_id The id of the way that matches the tag.
@@ -75,6 +102,14 @@ class CacheSet
     Blktype* findBlk(Addr tag, bool is_secure, int& way_id) const ;
     Blktype* findBlk(Addr tag, bool is_secure) const ;
 
+    /**
+     * Find the physical way of the valid block matching the tag.
+     * @param tag The Tag to find.
+     * @param is_secure True if the target memory space is secure.
+     * @return The physical way of the block, or assoc if none found.
+     */
+    int findWay(Addr tag, bool is_secure) const;
+
     /**
      * Move the given block to the head of the list.
      * @param blk The block to move.
@@ -89,6 +124,59 @@ class CacheSet
 
 };
 
+template <class Blktype>
+void
+CacheSet<Blktype>::setTag(Blktype *blk, Addr tag)
+{
+    assert(blk >= baseBlk && blk < baseBlk + assoc);
+    blk->tag = tag;
+    tags[blk - baseBlk] = tag;
+}
+
+template <class Blktype>
+int
+CacheSet<Blktype>::findWay(Addr tag, bool is_secure) const
+{
+    // Only the tags are compared in bulk. The status bits are updated all
+    // over the cache and are checked on the (rare) candidate ways instead.
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i key = _mm256_set1_epi64x(tag);
+    for (; i + 4 <= assoc; i += 4) {
+        __m256i eq = _mm256_cmpeq_epi64(key,
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + i)));
+        unsigned mask = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        for (; mask; mask &= mask - 1) {
+            const Blktype *blk = baseBlk + i + __builtin_ctz(mask);
+            if (blk->isValid() && blk->isSecure() == is_secure)
+                return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i key = _mm_set1_epi64x(tag);
+    for (; i + 2 <= assoc; i += 2) {
+        __m128i eq = _mm_cmpeq_epi32(key,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + i)));
+        // SSE2 has no 64-bit compare: a tag matches only if both of its
+        // 32-bit halves do
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        unsigned mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        for (; mask; mask &= mask - 1) {
+            const Blktype *blk = baseBlk + i + __builtin_ctz(mask);
+            if (blk->isValid() && blk->isSecure() == is_secure)
+                return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i < assoc; ++i) {
+        if (tags[i] == tag && baseBlk[i].isValid() &&
+            baseBlk[i].isSecure() == is_secure) {
+            return i;
+        }
+    }
+    return assoc;
+}
+
 template <class Blktype>
 Blktype*
 CacheSet<Blktype>::findBlk(Addr tag, bool is_secure, int& way_id) const
@@ -98,22 +186,30 @@ CacheSet<Blktype>::findBlk(Addr tag, bool is_secure, int& way_id) const
      * If no block is found way_id is set to assoc.
      */
     way_id = assoc;
+    int way = findWay(tag, is_secure);
+    if (way == assoc)
+        return NULL;
+
+    Blktype *blk = baseBlk + way;
+    assert(blk->tag == tag);
     for (int i = 0; i < assoc; ++i) {
-        if (blks[i]->tag == tag && blks[i]->isValid() &&
-            blks[i]->isSecure() == is_secure) {
+        if (blks[i] == blk) {
             way_id = i;
-            return blks[i];
+            break;
         }
     }
-    return NULL;
+    return blk;
 }
 
 template <class Blktype>
 Blktype*
 CacheSet<Blktype>::findBlk(Addr tag, bool is_secure) const
 {
-    int ignored_way_id;
-    return findBlk(tag, is_secure, ignored_way_id);
+    int way = findWay(tag, is_secure);
+    if (way == assoc)
+        return NULL;
+    assert(baseBlk[way].tag == tag);
+    return baseBlk + way;
 }
 
 template <class Blktype>
@@ -55,19 +55,26 @@
 using namespace std;
 
 FALRU::FALRU(const Params *p)
-    : BaseTags(p), cacheBoundaries(nullptr)
+    : BaseTags(p), minTrackedSize(p->min_tracked_size),
+      cacheBoundaries(nullptr), tagHash(p->size / p->block_size)
 {
     if (!isPowerOf2(blkSize))
         fatal("cache block size (in bytes) `%d' must be a power of two",
               blkSize);
     if (!isPowerOf2(size))
         fatal("Cache Size must be power of 2 for now");
-
-    // Track all cache sizes from 128K up by powers of 2
-    numCaches = floorLog2(size) - 17;
-    if (numCaches >0){
-        cacheBoundaries = new FALRUBlk *[numCaches];
-        cacheMask = (1 << numCaches) - 1;
+    if (!isPowerOf2(minTrackedSize) || minTrackedSize < blkSize)
+        fatal("Smallest tracked cache size must be a power of 2 and no "
+              "smaller than a block");
+
+    // Track all cache sizes from minTrackedSize up by powers of 2
+    numCaches = size > minTrackedSize ?
+        floorLog2(size) - floorLog2(minTrackedSize) : 0;
+    if (numCaches >= 64)
+        fatal("Too many cache sizes to track, increase min_tracked_size");
+    if (numCaches > 0) {
+        cacheBoundaries = new int[numCaches];
+        cacheMask = (ULL(1) << numCaches) - 1;
     } else {
         cacheMask = 0;
     }
@@ -76,34 +83,25 @@ FALRU::FALRU(const Params *p)
     numBlocks = size/blkSize;
 
     blks = new FALRUBlk[numBlocks];
-    head = &(blks[0]);
-    tail = &(blks[numBlocks-1]);
-
-    head->prev = NULL;
-    head->next = &(blks[1]);
-    head->inCache = cacheMask;
-
-    tail->prev = &(blks[numBlocks-2]);
-    tail->next = NULL;
-    tail->inCache = 0;
+    head = 0;
+    tail = numBlocks - 1;
 
-    unsigned index = (1 << 17) / blkSize;
+    unsigned index = minTrackedSize / blkSize;
     unsigned j = 0;
-    int flags = cacheMask;
-    for (unsigned i = 1; i < numBlocks - 1; i++) {
+    uint64_t flags = cacheMask;
+    for (unsigned i = 0; i < numBlocks; i++) {
         blks[i].inCache = flags;
-        if (i == index - 1){
-            cacheBoundaries[j] = &(blks[i]);
-            flags &= ~ (1<<j);
+        if (j < numCaches && i == index - 1) {
+            cacheBoundaries[j] = i;
+            flags &= ~(ULL(1) << j);
             ++j;
             index = index << 1;
         }
-        blks[i].prev = &(blks[i-1]);
-        blks[i].next = &(blks[i+1]);
+        blks[i].prev = (int)i - 1;
+        blks[i].next = i + 1 < numBlocks ? i + 1 : -1;
         blks[i].isTouched = false;
     }
     assert(j == numCaches);
-    assert(index == numBlocks);
     //assert(check());
 }
 
@@ -134,30 +132,37 @@ FALRU::regStats()
         .name(name() + ".falru_accesses")
         .desc("The number of accesses to the FA LRU cache.")
         ;
+    missRatio
+        .name(name() + ".falru_miss_ratio")
+        .desc("The miss ratio of each cache size.")
+        ;
+    missRatio = misses / accesses;
 
     for (unsigned i = 0; i <= numCaches; ++i) {
+        uint64_t cache_size = (uint64_t)minTrackedSize << i;
         stringstream size_str;
-        if (i < 3){
-            size_str << (1<<(i+7)) <<"K";
+        if (cache_size < (ULL(1) << 20)) {
+            size_str << (cache_size >> 10) << "K";
+        } else if (cache_size < (ULL(1) << 30)) {
+            size_str << (cache_size >> 20) << "M";
         } else {
-            size_str << (1<<(i-3)) <<"M";
+            size_str << (cache_size >> 30) << "G";
         }
 
         hits.subname(i, size_str.str());
         hits.subdesc(i, "Hits in a " + size_str.str() +" cache");
         misses.subname(i, size_str.str());
         misses.subdesc(i, "Misses in a " + size_str.str() +" cache");
+        missRatio.subname(i, size_str.str());
+        missRatio.subdesc(i, "Miss ratio of a " + size_str.str() +" cache");
     }
 }
 
 FALRUBlk *
 FALRU::hashLookup(Addr addr) const
 {
-    tagIterator iter = tagHash.find(addr);
-    if (iter != tagHash.end()) {
-        return (*iter).second;
-    }
-    return NULL;
+    const int *index = tagHash.find(addr);
+    return index ? &blks[*index] : NULL;
 }
 
 void
@@ -175,10 +180,10 @@ FALRU::accessBlock(Addr addr, bool is_secure, Cycles &lat, int context_src)
 
 CacheBlk*
 FALRU::accessBlock(Addr addr, bool is_secure, Cycles &lat, int context_src,
-                   int *inCache)
+                   uint64_t *inCache)
 {
     accesses++;
-    int tmp_in_cache = 0;
+    uint64_t tmp_in_cache = 0;
     Addr blkAddr = blkAlign(addr);
     FALRUBlk* blk = hashLookup(blkAddr);
 
@@ -186,14 +191,14 @@ FALRU::accessBlock(Addr addr, bool is_secure, Cycles &lat, int context_src,
         assert(blk->tag == blkAddr);
         tmp_in_cache = blk->inCache;
         for (unsigned i = 0; i < numCaches; i++) {
-            if (1<<i & blk->inCache) {
+            if ((ULL(1) << i) & blk->inCache) {
                 hits[i]++;
             } else {
                 misses[i]++;
             }
         }
         hits[numCaches]++;
-        if (blk != head){
+        if (blk != &blks[head]){
             moveToHead(blk);
         }
     } else {
@@ -229,81 +234,100 @@ FALRU::findBlock(Addr addr, bool is_secure) const
 CacheBlk*
 FALRU::findVictim(Addr addr)
 {
-    FALRUBlk * blk = tail;
+    // The replacement itself happens in insertBlock(), as the cache may
+    // still decide not to allocate the victim
+    FALRUBlk *blk = &blks[tail];
     assert(blk->inCache == 0);
-    moveToHead(blk);
-    tagHash.erase(blk->tag);
-    tagHash[blkAlign(addr)] = blk;
-    if (blk->isValid()) {
+    return blk;
+}
+
+void
+FALRU::insertBlock(PacketPtr pkt, CacheBlk *blk)
+{
+    FALRUBlk *falru_blk = static_cast<FALRUBlk *>(blk);
+    int index = falru_blk - blks;
+    Addr blk_addr = blkAlign(pkt->getAddr());
+
+    bool was_touched = falru_blk->isTouched;
+    if (falru_blk->isValid()) {
         replacements[0]++;
+        falru_blk->invalidate();
     } else {
         tagsInUse++;
-        blk->isTouched = true;
+        falru_blk->isTouched = true;
         if (!warmedUp && tagsInUse.value() >= warmupBound) {
             warmedUp = true;
             warmupCycle = curTick();
         }
     }
-    //assert(check());
-    return blk;
-}
 
-void
-FALRU::insertBlock(PacketPtr pkt, CacheBlk *blk)
-{
+    // The old address may have been reinserted into another block since
+    // this one was invalidated, in which case its entry must stay
+    if (was_touched) {
+        const int *old_index = tagHash.find(falru_blk->tag);
+        if (old_index && *old_index == index)
+            tagHash.erase(falru_blk->tag);
+    }
+    tagHash.insert(blk_addr, index);
+    falru_blk->tag = blk_addr;
+
+    moveToHead(falru_blk);
+    //assert(check());
 }
 
 void
 FALRU::moveToHead(FALRUBlk *blk)
 {
-    int updateMask = blk->inCache ^ cacheMask;
+    int index = blk - blks;
+    uint64_t updateMask = blk->inCache ^ cacheMask;
     for (unsigned i = 0; i < numCaches; i++){
-        if ((1<<i) & updateMask) {
-            cacheBoundaries[i]->inCache &= ~(1<<i);
-            cacheBoundaries[i] = cacheBoundaries[i]->prev;
-        } else if (cacheBoundaries[i] == blk) {
+        if ((ULL(1) << i) & updateMask) {
+            blks[cacheBoundaries[i]].inCache &= ~(ULL(1) << i);
+            cacheBoundaries[i] = blks[cacheBoundaries[i]].prev;
+        } else if (cacheBoundaries[i] == index) {
             cacheBoundaries[i] = blk->prev;
         }
     }
     blk->inCache = cacheMask;
-    if (blk != head) {
-        if (blk == tail){
-            assert(blk->next == NULL);
+    if (index != head) {
+        if (index == tail){
+            assert(blk->next == -1);
             tail = blk->prev;
-            tail->next = NULL;
+            blks[tail].next = -1;
         } else {
-            blk->prev->next = blk->next;
-            blk->next->prev = blk->prev;
+            blks[blk->prev].next = blk->next;
+            blks[blk->next].prev = blk->prev;
         }
         blk->next = head;
-        blk->prev = NULL;
-        head->prev = blk;
-        head = blk;
+        blk->prev = -1;
+        blks[head].prev = index;
+        head = index;
     }
 }
 
 bool
 FALRU::check()
 {
-    FALRUBlk* blk = head;
-    int tot_size = 0;
-    int boundary = 1<<17;
-    int j = 0;
-    int flags = cacheMask;
-    while (blk) {
+    int index = head;
+    uint64_t tot_size = 0;
+    uint64_t boundary = minTrackedSize;
+    unsigned j = 0;
+    uint64_t flags = cacheMask;
+    while (index != -1) {
+        FALRUBlk *blk = &blks[index];
         tot_size += blkSize;
         if (blk->inCache != flags) {
             return false;
         }
-        if (tot_size == boundary && blk != tail) {
-            if (cacheBoundaries[j] != blk) {
+        if (tot_size == boundary && index != tail) {
+            if (cacheBoundaries[j] != index) {
                 return false;
             }
-            flags &=~(1 << j);
+            flags &= ~(ULL(1) << j);
             boundary = boundary<<1;
             ++j;
         }
-        blk = blk->next;
+        index = blk->next;
     }
     return true;
 }
@@ -50,7 +50,7 @@
 
 #include <list>
 
-#include "base/hashmap.hh"
+#include "base/flat_addr_map.hh"
 #include "mem/cache/tags/base.hh"
 #include "mem/cache/blk.hh"
 #include "mem/packet.hh"
@@ -62,22 +62,22 @@
 class FALRUBlk : public CacheBlk
 {
 public:
-    /** The previous block in LRU order. */
-    FALRUBlk *prev;
-    /** The next block in LRU order. */
-    FALRUBlk *next;
+    /** Index of the previous block in LRU order, -1 for the MRU block. */
+    int prev;
+    /** Index of the next block in LRU order, -1 for the LRU block. */
+    int next;
     /** Has this block been touched? */
     bool isTouched;
 
     /**
      * A bit mask of the sizes of cache that this block is resident in.
-     * Each bit represents a power of 2 in MB size cache.
-     * If bit 0 is set, this block is in a 1MB cache
-     * If bit 2 is set, this block is in a 4MB cache, etc.
-     * There is one bit for each cache smaller than the full size (default
-     * 16MB).
+     * Each bit represents a power of 2 multiple of the smallest tracked
+     * size (min_tracked_size, 128kB by default).
+     * If bit 0 is set, this block is in a 128kB cache
+     * If bit 2 is set, this block is in a 512kB cache, etc.
+     * There is one bit for each cache smaller than the full size.
      */
-    int inCache;
+    uint64_t inCache;
 };
 
 /**
@@ -93,28 +93,29 @@ class FALRU : public BaseTags
     typedef std::list<FALRUBlk*> BlkList;
 
   protected:
-    /** Array of pointers to blocks at the cache size  boundaries. */
-    FALRUBlk **cacheBoundaries;
+    /** The smallest cache size being tracked. */
+    const unsigned minTrackedSize;
+
+    /** Array of indexes of the blocks at the cache size boundaries. */
+    int *cacheBoundaries;
     /** A mask for the FALRUBlk::inCache bits. */
-    int cacheMask;
+    uint64_t cacheMask;
     /** The number of different size caches being tracked. */
     unsigned numCaches;
 
     /** The cache blocks. */
     FALRUBlk *blks;
 
-    /** The MRU block. */
-    FALRUBlk *head;
-    /** The LRU block. */
-    FALRUBlk *tail;
-
-    /** Hash table type mapping addresses to cache block pointers. */
-    typedef m5::hash_map<Addr, FALRUBlk *, m5::hash<Addr> > hash_t;
-    /** Iterator into the address hash table. */
-    typedef hash_t::const_iterator tagIterator;
+    /** Index of the MRU block. */
+    int head;
+    /** Index of the LRU block. */
+    int tail;
 
-    /** The address hash table. */
-    hash_t tagHash;
+    /**
+     * The address hash table, mapping block addresses to block indexes.
+     * An invalidated block keeps its entry until the block is reused.
+     */
+    FlatAddrMap<int> tagHash;
 
     /**
      * Find the cache block for the given address.
@@ -143,12 +144,14 @@ class FALRU : public BaseTags
      * @{
      */
 
-    /** Hits in each cache size >= 128K. */
+    /** Hits in each cache size >= min_tracked_size. */
     Stats::Vector hits;
-    /** Misses in each cache size >= 128K. */
+    /** Misses in each cache size >= min_tracked_size. */
     Stats::Vector misses;
     /** Total number of accesses. */
     Stats::Scalar accesses;
+    /** Miss ratio of each cache size, i.e., the miss-ratio curve. */
+    Stats::Formula missRatio;
 
     /**
      * @}
@@ -189,7 +192,7 @@ public:
      * @return Pointer to the cache block.
      */
     CacheBlk* accessBlock(Addr addr, bool is_secure, Cycles &lat,
-                          int context_src, int *inCache);
+                          int context_src, uint64_t *inCache);
 
     /**
      * Just a wrapper of above function to conform with the base interface.
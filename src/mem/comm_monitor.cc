@@ -38,6 +38,9 @@
  *          Andreas Hansson
  */
 
+#include <algorithm>
+#include <sstream>
+
 #include "base/callback.hh"
 #include "base/output.hh"
 #include "base/trace.hh"
@@ -56,7 +59,9 @@ CommMonitor::CommMonitor(Params* params)
       writeAddrMask(params->write_addr_mask),
       stats(params),
       stackDistCalc(params->stack_dist_calc),
+      footprintCalc(params->footprint_calc),
       traceStream(NULL),
+      traceWriter(NULL),
       system(params->system)
 {
     // If we are using a trace file, then open the file
@@ -81,14 +86,20 @@ CommMonitor::CommMonitor(Params* params)
                                       (params->trace_compress ? ".gz" : ""));
         }
 
-        traceStream = new ProtoOutputStream(filename);
-
-        // Create a protobuf message for the header and write it to
-        // the stream
-        ProtoMessage::PacketHeader header_msg;
-        header_msg.set_obj_id(name());
-        header_msg.set_tick_freq(SimClock::Frequency);
-        traceStream->write(header_msg);
+        if (params->trace_ring_records) {
+            traceWriter = new PacketTraceWriter(filename, name(),
+                                                SimClock::Frequency,
+                                                params->trace_ring_records);
+        } else {
+            traceStream = new ProtoOutputStream(filename);
+
+            // Create a protobuf message for the header and write it to
+            // the stream
+            ProtoMessage::PacketHeader header_msg;
+            header_msg.set_obj_id(name());
+            header_msg.set_tick_freq(SimClock::Frequency);
+            traceStream->write(header_msg);
+        }
 
         // Register a callback to compensate for the destructor not
         // being called. The callback forces the stream to flush and
@@ -115,8 +126,16 @@ CommMonitor::~CommMonitor()
 void
 CommMonitor::closeStreams()
 {
-    if (traceStream != NULL)
-        delete traceStream;
+    delete traceStream;
+    traceStream = NULL;
+
+    if (traceWriter != NULL) {
+        if (traceWriter->fullStalls())
+            inform("%s: Waited %d times for the trace writer\n", name(),
+                   traceWriter->fullStalls());
+        delete traceWriter;
+        traceWriter = NULL;
+    }
 }
 
 CommMonitor*
@@ -132,7 +151,7 @@ CommMonitor::init()
     if (!slavePort.isConnected() || !masterPort.isConnected())
         fatal("Communication monitor is not connected on both sides.\n");
 
-    if (traceStream != NULL) {
+    if (traceStream != NULL || traceWriter != NULL) {
         // Check the memory mode. We only record something when in
         // timing mode. Warn accordingly.
         if (!system->isTimingMode())
@@ -180,22 +199,38 @@ CommMonitor::recvAtomic(PacketPtr pkt)
     if (stackDistCalc)
         stackDistCalc->update(pkt->cmd, pkt->getAddr());
 
+    if (footprintCalc)
+        footprintCalc->update(pkt->cmd, pkt->getAddr());
+
    // if tracing enabled, store the packet information
    // to the trace stream
-   if (traceStream != NULL) {
-        ProtoMessage::Packet pkt_msg;
-        pkt_msg.set_tick(curTick());
-        pkt_msg.set_cmd(pkt->cmdToIndex());
-        pkt_msg.set_flags(pkt->req->getFlags());
-        pkt_msg.set_addr(pkt->getAddr());
-        pkt_msg.set_size(pkt->getSize());
-
-        traceStream->write(pkt_msg);
-    }
+   if (traceStream != NULL || traceWriter != NULL)
+        tracePacket(pkt->cmdToIndex(), pkt->req->getFlags(), pkt->getAddr(),
+                    pkt->getSize());
 
     return masterPort.sendAtomic(pkt);
 }
 
+void
+CommMonitor::tracePacket(int cmd_idx, Request::FlagsType req_flags,
+                         Addr addr, unsigned size)
+{
+    if (traceWriter != NULL) {
+        traceWriter->write(curTick(), cmd_idx, req_flags, addr, size);
+        return;
+    }
+
+    // Create a protobuf message representing the packet
+    ProtoMessage::Packet pkt_msg;
+    pkt_msg.set_tick(curTick());
+    pkt_msg.set_cmd(cmd_idx);
+    pkt_msg.set_flags(req_flags);
+    pkt_msg.set_addr(addr);
+    pkt_msg.set_size(size);
+
+    traceStream->write(pkt_msg);
+}
+
 Tick
 CommMonitor::recvAtomicSnoop(PacketPtr pkt)
 {
@@ -241,19 +276,11 @@ CommMonitor::recvTimingReq(PacketPtr pkt)
     if (successful && stackDistCalc)
         stackDistCalc->update(cmd, addr);
 
-    if (successful && traceStream != NULL) {
-        // Create a protobuf message representing the
-        // packet. Currently we do not preserve the flags in the
-        // trace.
-        ProtoMessage::Packet pkt_msg;
-        pkt_msg.set_tick(curTick());
-        pkt_msg.set_cmd(cmd_idx);
-        pkt_msg.set_flags(req_flags);
-        pkt_msg.set_addr(addr);
-        pkt_msg.set_size(size);
-
-        traceStream->write(pkt_msg);
-    }
+    if (successful && footprintCalc)
+        footprintCalc->update(cmd, addr);
+
+    if (successful && (traceStream != NULL || traceWriter != NULL))
+        tracePacket(cmd_idx, req_flags, addr, size);
 
     if (successful && is_read) {
         DPRINTF(CommMonitor, "Forwarded read request\n");
@@ -390,6 +417,8 @@ CommMonitor::recvTimingResp(PacketPtr pkt)
 
         if (!stats.disableLatencyHists) {
             stats.readLatencyHist.sample(latency);
+            stats.readLatency.record(latency);
+            stats.periodReadLatency.record(latency);
         }
 
         // Update the bandwidth stats based on responses for reads
@@ -408,6 +437,8 @@ CommMonitor::recvTimingResp(PacketPtr pkt)
 
         if (!stats.disableLatencyHists) {
             stats.writeLatencyHist.sample(latency);
+            stats.writeLatency.record(latency);
+            stats.periodWriteLatency.record(latency);
         }
     } else if (successful) {
         DPRINTF(CommMonitor, "Received non read/write response\n");
@@ -527,6 +558,47 @@ CommMonitor::regStats()
         .desc("Write request-response latency")
         .flags(stats.disableLatencyHists ? nozero : pdf);
 
+    size_t num_percentiles = stats.latencyPercentiles.size();
+
+    stats.readLatencyPercentiles
+        .init(num_percentiles)
+        .name(name() + ".readLatencyPercentiles")
+        .desc("Read request-response latency percentiles")
+        .flags(stats.disableLatencyHists ? nozero : none);
+
+    stats.writeLatencyPercentiles
+        .init(num_percentiles)
+        .name(name() + ".writeLatencyPercentiles")
+        .desc("Write request-response latency percentiles")
+        .flags(stats.disableLatencyHists ? nozero : none);
+
+    stats.readLatencyWorstPeriod
+        .init(num_percentiles)
+        .name(name() + ".readLatencyWorstPeriod")
+        .desc("Worst read latency percentiles of a sample period")
+        .flags(stats.disableLatencyHists ? nozero : none);
+
+    stats.writeLatencyWorstPeriod
+        .init(num_percentiles)
+        .name(name() + ".writeLatencyWorstPeriod")
+        .desc("Worst write latency percentiles of a sample period")
+        .flags(stats.disableLatencyHists ? nozero : none);
+
+    for (size_t i = 0; i < num_percentiles; ++i) {
+        std::ostringstream subname;
+        subname << "p" << stats.latencyPercentiles[i];
+        stats.readLatencyPercentiles.subname(i, subname.str());
+        stats.writeLatencyPercentiles.subname(i, subname.str());
+        stats.readLatencyWorstPeriod.subname(i, subname.str());
+        stats.writeLatencyWorstPeriod.subname(i, subname.str());
+    }
+
+    // the percentiles are only worked out from the histograms when
+    // the stats are dumped
+    if (!stats.disableLatencyHists)
+        Stats::registerDumpCallback(new MakeCallback<CommMonitor,
+            &CommMonitor::updateLatencyPercentiles>(this));
+
     stats.ittReadRead
         .init(1, params()->itt_max_bin, params()->itt_max_bin /
               params()->itt_bins)
@@ -611,6 +683,18 @@ CommMonitor::samplePeriodic()
             stats.outstandingReadsHist.sample(stats.outstandingReadReqs);
             stats.outstandingWritesHist.sample(stats.outstandingWriteReqs);
         }
+
+        if (!stats.disableLatencyHists) {
+            for (size_t i = 0; i < stats.latencyPercentiles.size(); ++i) {
+                double p = stats.latencyPercentiles[i];
+                stats.worstPeriodRead[i] =
+                    std::max(stats.worstPeriodRead[i],
+                             stats.periodReadLatency.percentile(p));
+                stats.worstPeriodWrite[i] =
+                    std::max(stats.worstPeriodWrite[i],
+                             stats.periodWriteLatency.percentile(p));
+            }
+        }
     }
 
     // reset the sampled values
@@ -620,9 +704,34 @@ CommMonitor::samplePeriodic()
     stats.readBytes = 0;
     stats.writtenBytes = 0;
 
+    stats.periodReadLatency.reset();
+    stats.periodWriteLatency.reset();
+
     schedule(samplePeriodicEvent, curTick() + samplePeriodTicks);
 }
 
+void
+CommMonitor::updateLatencyPercentiles()
+{
+    for (size_t i = 0; i < stats.latencyPercentiles.size(); ++i) {
+        double p = stats.latencyPercentiles[i];
+        stats.readLatencyPercentiles[i] = stats.readLatency.percentile(p);
+        stats.writeLatencyPercentiles[i] = stats.writeLatency.percentile(p);
+        stats.readLatencyWorstPeriod[i] = stats.worstPeriodRead[i];
+        stats.writeLatencyWorstPeriod[i] = stats.worstPeriodWrite[i];
+    }
+}
+
+void
+CommMonitor::resetStats()
+{
+    stats.readLatency.reset();
+    stats.writeLatency.reset();
+    std::fill(stats.worstPeriodRead.begin(), stats.worstPeriodRead.end(), 0);
+    std::fill(stats.worstPeriodWrite.begin(), stats.worstPeriodWrite.end(),
+              0);
+}
+
 void
 CommMonitor::startup()
 {
@@ -41,11 +41,16 @@
 #ifndef __MEM_COMM_MONITOR_HH__
 #define __MEM_COMM_MONITOR_HH__
 
+#include <vector>
+
+#include "base/hdr_histogram.hh"
 #include "base/statistics.hh"
 #include "base/time.hh"
+#include "mem/footprint_calc.hh"
 #include "mem/mem_object.hh"
 #include "mem/stack_dist_calc.hh"
 #include "params/CommMonitor.hh"
+#include "proto/packet_trace_writer.hh"
 #include "proto/protoio.hh"
 #include "sim/system.hh"
 
@@ -58,6 +63,8 @@
  * outstanding read/write requests, read latency and inter transaction time
  * (read-read, write-write, read/write-read/write). Furthermore it allows
  * to capture the number of accesses to an address over time ("heat map").
+ * Percentiles of the read/write latency come from log-linear histograms,
+ * both over the stats period and as the worst of each sample period.
  * All stats can be disabled from Python.
  */
 class CommMonitor : public MemObject
@@ -97,6 +104,9 @@ class CommMonitor : public MemObject
     /** Register statistics */
     void regStats();
 
+    /** Reset the latency histograms along with the stats */
+    void resetStats();
+
   private:
 
     /**
@@ -312,6 +322,35 @@ class CommMonitor : public MemObject
         /** Histogram of write request-to-response latencies */
         Stats::Histogram writeLatencyHist;
 
+        /** Latency percentiles to report */
+        const std::vector<double> latencyPercentiles;
+
+        /**
+         * Log-linear histograms of the read and write latencies over
+         * the stats period, for exact percentiles across the range.
+         */
+        HdrHistogram readLatency;
+        HdrHistogram writeLatency;
+
+        /** Log-linear histograms over the current sample period */
+        HdrHistogram periodReadLatency;
+        HdrHistogram periodWriteLatency;
+
+        /**
+         * Worst value of each percentile over the sample periods,
+         * kept outside of the stats which are only updated on a dump.
+         */
+        std::vector<Tick> worstPeriodRead;
+        std::vector<Tick> worstPeriodWrite;
+
+        /** Read and write latency percentiles over the stats period */
+        Stats::Vector readLatencyPercentiles;
+        Stats::Vector writeLatencyPercentiles;
+
+        /** Worst read and write latency percentiles of a sample period */
+        Stats::Vector readLatencyWorstPeriod;
+        Stats::Vector writeLatencyWorstPeriod;
+
         /** Disable flag for ITT distributions. */
         bool disableITTDists;
 
@@ -383,6 +422,15 @@ class CommMonitor : public MemObject
             disableBandwidthHists(params->disable_bandwidth_hists),
             readBytes(0), writtenBytes(0),
             disableLatencyHists(params->disable_latency_hists),
+            latencyPercentiles(params->latency_percentiles),
+            readLatency(params->latency_precision_bits, params->latency_max),
+            writeLatency(params->latency_precision_bits, params->latency_max),
+            periodReadLatency(params->latency_precision_bits,
+                              params->latency_max),
+            periodWriteLatency(params->latency_precision_bits,
+                               params->latency_max),
+            worstPeriodRead(latencyPercentiles.size(), 0),
+            worstPeriodWrite(latencyPercentiles.size(), 0),
             disableITTDists(params->disable_itt_dists),
             timeOfLastRead(0), timeOfLastWrite(0), timeOfLastReq(0),
             disableOutstandingHists(params->disable_outstanding_hists),
@@ -397,6 +445,12 @@ class CommMonitor : public MemObject
     /** This function is called periodically at the end of each time bin */
     void samplePeriodic();
 
+    /**
+     * Fill in the latency percentile stats from the histograms, as
+     * they are about to be dumped.
+     */
+    void updateLatencyPercentiles();
+
     /** Schedule the first periodic event */
     void startup();
 
@@ -419,9 +473,22 @@ class CommMonitor : public MemObject
     /** Optional stack distance calculator */
     StackDistCalc* stackDistCalc;
 
-    /** Output stream for a potential trace. */
+    /** Optional footprint calculator */
+    FootprintCalc* footprintCalc;
+
+    /**
+     * Add a packet to the trace, through the writer thread if there
+     * is one.
+     */
+    void tracePacket(int cmd_idx, Request::FlagsType req_flags, Addr addr,
+                     unsigned size);
+
+    /** Output stream for a potential trace written inline. */
     ProtoOutputStream* traceStream;
 
+    /** Writer thread for a potential trace. */
+    PacketTraceWriter* traceWriter;
+
     /** The system in which the monitor lives */
     System *system;
 };
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Definition of a per-epoch footprint calculator that samples pages
+ * by hashing.
+ */
+
+#include <algorithm>
+
+#include "base/bitfield.hh"
+#include "base/misc.hh"
+#include "base/trace.hh"
+#include "debug/Footprint.hh"
+#include "mem/footprint_calc.hh"
+
+FootprintCalc::FootprintCalc(const FootprintCalcParams* p) :
+    SimObject(p), epochEvent(this), epochLength(p->epoch_length),
+    blockBits(p->block_bits), pageBits(p->page_bits),
+    blocksPerPage(1 << (pageBits - blockBits)),
+    wordsPerPage((blocksPerPage + 63) / 64),
+    denseBlocks(p->dense_blocks), sampler(p->sampling_rate)
+{
+    if (pageBits < blockBits || pageBits - blockBits > 16)
+        fatal("%s needs pages of 1 to 64K blocks\n", name());
+    if (p->sampling_rate <= 0 || p->sampling_rate > 1)
+        fatal("%s sampling rate %f is not in (0, 1]\n", name(),
+              p->sampling_rate);
+    if (sampler.getThreshold() == 0)
+        fatal("%s sampling rate %f is too low\n", name(), p->sampling_rate);
+    if (epochLength == 0)
+        fatal("%s needs a non-zero epoch length\n", name());
+}
+
+void
+FootprintCalc::startup()
+{
+    schedule(epochEvent, curTick() + epochLength);
+}
+
+void
+FootprintCalc::updateSampled(const MemCmd& cmd, Addr page, Addr addr)
+{
+    std::vector<uint64_t>& written = pages[page];
+    if (!cmd.isWrite())
+        return;
+
+    if (written.empty())
+        written.resize(wordsPerPage);
+    Addr block = (addr >> blockBits) & (blocksPerPage - 1);
+    written[block / 64] |= ULL(1) << (block % 64);
+}
+
+void
+FootprintCalc::endEpoch()
+{
+    uint64_t written_pages = 0;
+    uint64_t written_blocks = 0;
+    uint64_t dense_pages = 0;
+    uint64_t sparse_blocks = 0;
+
+    for (auto& page : pages) {
+        unsigned blocks = 0;
+        for (auto word : page.second)
+            blocks += popCount(word);
+        if (blocks == 0)
+            continue;
+
+        ++written_pages;
+        written_blocks += blocks;
+        blocksPerPageWritten.sample(blocks);
+        if (blocks >= denseBlocks)
+            ++dense_pages;
+        else
+            sparse_blocks += blocks;
+    }
+
+    DPRINTF(Footprint, "Epoch %d sampled %d pages touched, %d pages and "
+            "%d blocks written\n", (uint64_t)epochs.value(), pages.size(),
+            written_pages, written_blocks);
+
+    ++epochs;
+    pagesTouched.sample(scaled(pages.size()));
+    pagesWritten.sample(scaled(written_pages));
+    blocksWritten.sample(scaled(written_blocks));
+    pttDemand.sample(scaled(dense_pages));
+    bttDemand.sample(scaled(sparse_blocks));
+
+    pages.clear();
+    schedule(epochEvent, curTick() + epochLength);
+}
+
+void
+FootprintCalc::regStats()
+{
+    using namespace Stats;
+
+    epochs
+        .name(name() + ".epochs")
+        .desc("Number of epochs measured");
+
+    pagesTouched
+        .init(params()->hist_bins)
+        .name(name() + ".pagesTouched")
+        .desc("Estimated unique pages touched per epoch");
+
+    pagesWritten
+        .init(params()->hist_bins)
+        .name(name() + ".pagesWritten")
+        .desc("Estimated unique pages written per epoch");
+
+    blocksWritten
+        .init(params()->hist_bins)
+        .name(name() + ".blocksWritten")
+        .desc("Estimated unique blocks written per epoch");
+
+    blocksPerPageWritten
+        .init(1, blocksPerPage, std::max(blocksPerPage / 64, 1u))
+        .name(name() + ".blocksPerPageWritten")
+        .desc("Distribution of blocks written per written page, over the "
+              "sampled pages of all epochs")
+        .flags(pdf);
+
+    pttDemand
+        .init(params()->hist_bins)
+        .name(name() + ".pttDemand")
+        .desc("Estimated pages per epoch with at least dense_blocks "
+              "blocks written, i.e., PTT entries");
+
+    bttDemand
+        .init(params()->hist_bins)
+        .name(name() + ".bttDemand")
+        .desc("Estimated blocks written per epoch in other pages, i.e., "
+              "BTT entries");
+}
+
+FootprintCalc*
+FootprintCalcParams::create()
+{
+    return new FootprintCalc(this);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a per-epoch footprint calculator that samples pages
+ * by hashing.
+ */
+
+#ifndef __MEM_FOOTPRINT_CALC_HH__
+#define __MEM_FOOTPRINT_CALC_HH__
+
+#include <unordered_map>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "mem/packet.hh"
+#include "mem/spatial_sampler.hh"
+#include "params/FootprintCalc.hh"
+#include "sim/sim_object.hh"
+
+/**
+ * The footprint calculator measures, for each epoch of a fixed
+ * length, the unique pages touched, the unique blocks written, and
+ * how many blocks are written in each written page. This is what
+ * sizes the tables of a hybrid memory that remaps blocks and writes
+ * back pages: pages with many written blocks are best kept in DRAM
+ * under the page table (PTT), while the blocks written in other pages
+ * need entries in the block table (BTT).
+ *
+ * Rather than tracking every address, the calculator uses spatial
+ * sampling by hashing, as in SHARDS (Waldspurger et al., FAST'15): a
+ * page is only tracked if the hash of its address falls below a
+ * threshold set by the sampling rate. Since all blocks of a tracked
+ * page are tracked, the blocks written per page are exact for the
+ * sampled pages, and the totals are estimated by scaling the sampled
+ * counts by the inverse of the rate. The cost per access is a hash
+ * and, for the sampled pages only, a hash table lookup.
+ */
+class FootprintCalc : public SimObject
+{
+
+  public:
+
+    const FootprintCalcParams* params() const
+    { return reinterpret_cast<const FootprintCalcParams*>(_params); }
+
+    FootprintCalc(const FootprintCalcParams* p);
+
+    void regStats();
+
+    void startup();
+
+    /**
+     * Account for an access in the running epoch.
+     *
+     * @param cmd Command from the packet
+     * @param addr Address accessed
+     */
+    void
+    update(const MemCmd& cmd, Addr addr)
+    {
+        Addr page = addr >> pageBits;
+        if (sampler.sampled(page))
+            updateSampled(cmd, page, addr);
+    }
+
+  private:
+
+    /** Track an access to a sampled page */
+    void updateSampled(const MemCmd& cmd, Addr page, Addr addr);
+
+    /** Sample the footprint of the epoch in the stats and start anew */
+    void endEpoch();
+
+    EventWrapper<FootprintCalc, &FootprintCalc::endEpoch> epochEvent;
+
+    const Tick epochLength;
+
+    const unsigned blockBits;
+    const unsigned pageBits;
+
+    /** Blocks per page and 64-bit words of a page bitmap */
+    const unsigned blocksPerPage;
+    const unsigned wordsPerPage;
+
+    /** Written blocks per page from which a page goes to the PTT */
+    const unsigned denseBlocks;
+
+    /** Sampler of the page numbers */
+    const SpatialSampler sampler;
+
+    /**
+     * Sampled pages touched in the running epoch, with a bitmap of
+     * their written blocks, which is empty for pages only read.
+     */
+    std::unordered_map<Addr, std::vector<uint64_t> > pages;
+
+    /** Estimate of a total from a count of the sampled pages */
+    double
+    scaled(uint64_t count) const
+    {
+        return count / sampler.rate();
+    }
+
+    Stats::Scalar epochs;
+    Stats::Histogram pagesTouched;
+    Stats::Histogram pagesWritten;
+    Stats::Histogram blocksWritten;
+    Stats::Distribution blocksPerPageWritten;
+    Stats::Histogram pttDemand;
+    Stats::Histogram bttDemand;
+};
+
+#endif //__MEM_FOOTPRINT_CALC_HH__
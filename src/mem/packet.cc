@@ -52,6 +52,7 @@
 #include <iostream>
 
 #include "base/cprintf.hh"
+#include "base/intmath.hh"
 #include "base/misc.hh"
 #include "base/trace.hh"
 #include "mem/packet.hh"
@@ -387,3 +388,69 @@ Packet::PrintReqState::printObj(Printable *obj)
     printLabels();
     obj->print(os, verbosity, curPrefix());
 }
+
+#if USE_POOL_ALLOC
+
+static PoolAllocator &
+packetPool()
+{
+    static PoolAllocator pool("packet", sizeof(Packet));
+    return pool;
+}
+
+void *
+Packet::operator new(size_t size)
+{
+    assert(size == sizeof(Packet));
+    return packetPool().allocate();
+}
+
+void
+Packet::operator delete(void *p)
+{
+    packetPool().deallocate(p);
+}
+
+/** Smallest data size class is 8 bytes, i.e., 2^3. */
+static const int minDataSizeBits = 3;
+static const int numDataPools = 5;
+static_assert((1 << (minDataSizeBits + numDataPools - 1)) ==
+              Packet::maxPooledDataSize,
+              "Data size classes must end at the largest pooled size");
+
+/** Pools of data buffers, one for each power-of-two size class. */
+struct DataPools
+{
+    PoolAllocator *pools[numDataPools];
+
+    DataPools()
+    {
+        for (int i = 0; i < numDataPools; ++i) {
+            unsigned bytes = 1 << (i + minDataSizeBits);
+            pools[i] = new PoolAllocator(csprintf("data%d", bytes), bytes);
+        }
+    }
+};
+
+static PoolAllocator &
+dataPool(unsigned size)
+{
+    static DataPools dataPools;
+    int i = max(ceilLog2(max(size, 1U)), minDataSizeBits) - minDataSizeBits;
+    assert(i < numDataPools);
+    return *dataPools.pools[i];
+}
+
+PacketDataPtr
+Packet::allocPooledData(unsigned size)
+{
+    return static_cast<PacketDataPtr>(dataPool(size).allocate());
+}
+
+void
+Packet::freePooledData(PacketDataPtr p, unsigned size)
+{
+    dataPool(size).deallocate(p);
+}
+
+#endif // USE_POOL_ALLOC
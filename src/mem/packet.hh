@@ -62,6 +62,7 @@
 #include "base/misc.hh"
 #include "base/printable.hh"
 #include "base/types.hh"
+#include "config/use_pool_alloc.hh"
 #include "mem/request.hh"
 #include "sim/core.hh"
 
@@ -258,11 +259,15 @@ class Packet : public Printable
     /// the packet is destroyed. The pointer is assumed to be pointing
     /// to an array, and delete [] is consequently called
     static const FlagsType DYNAMIC_DATA           = 0x00002000;
+    /// The data pointer, in addition to being dynamic, comes from
+    /// the pool of its size class and must be returned there.
+    static const FlagsType POOLED_DATA            = 0x00004000;
     /// suppress the error if this packet encounters a functional
     /// access failure.
     static const FlagsType SUPPRESS_FUNC_ERROR    = 0x00008000;
     // Signal block present to squash prefetch and cache evict packets
-    // through express snoop flag
+    // through express snoop flag, and, on a writeback, that the sender
+    // keeps the block
     static const FlagsType BLOCK_CACHED          = 0x00010000;
 
     Flags flags;
@@ -507,6 +512,7 @@ class Packet : public Printable
     void setSuppressFuncError()     { flags.set(SUPPRESS_FUNC_ERROR); }
     bool suppressFuncError() const  { return flags.isSet(SUPPRESS_FUNC_ERROR); }
     void setBlockCached()          { flags.set(BLOCK_CACHED); }
+    void clearBlockCached()        { flags.clear(BLOCK_CACHED); }
     bool isBlockCached() const     { return flags.isSet(BLOCK_CACHED); }
 
     // Network error conditions... encapsulate them as methods since
@@ -707,6 +713,17 @@ class Packet : public Printable
         deleteData();
     }
 
+#if USE_POOL_ALLOC
+    static void *operator new(size_t size);
+    static void operator delete(void *p);
+
+    /// Largest data size served by the pools, typically a cache line.
+    static const unsigned maxPooledDataSize = 128;
+
+    static PacketDataPtr allocPooledData(unsigned size);
+    static void freePooledData(PacketDataPtr p, unsigned size);
+#endif
+
     /**
      * Take a request packet and modify it in place to be suitable for
      * returning as a response to that request.
@@ -900,10 +917,15 @@ class Packet : public Printable
     void
     deleteData()
     {
+#if USE_POOL_ALLOC
+        if (flags.isSet(POOLED_DATA))
+            freePooledData(data, getSize());
+        else
+#endif
         if (flags.isSet(DYNAMIC_DATA))
             delete [] data;
 
-        flags.clear(STATIC_DATA|DYNAMIC_DATA);
+        flags.clear(STATIC_DATA|DYNAMIC_DATA|POOLED_DATA);
         data = NULL;
     }
 
@@ -913,6 +935,13 @@ class Packet : public Printable
     {
         assert(flags.noneSet(STATIC_DATA|DYNAMIC_DATA));
         flags.set(DYNAMIC_DATA);
+#if USE_POOL_ALLOC
+        if (getSize() <= maxPooledDataSize) {
+            flags.set(POOLED_DATA);
+            data = allocPooledData(getSize());
+            return;
+        }
+#endif
         data = new uint8_t[getSize()];
     }
 
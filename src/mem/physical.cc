@@ -37,19 +37,30 @@
  * Authors: Andreas Hansson
  */
 
+#include <sys/file.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/user.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 
+#include "base/atomicio.hh"
+#include "base/intmath.hh"
 #include "base/trace.hh"
 #include "debug/AddrRanges.hh"
 #include "debug/Checkpoint.hh"
@@ -70,11 +81,141 @@
 
 using namespace std;
 
+namespace {
+
+/**
+ * Layout of the chunked checkpoint format: a header, the compressed
+ * blocks, and an index with an entry per block. Blocks are compressed
+ * independently, so that they can be written and read in parallel,
+ * and the pages of a block that are all zero are left out.
+ */
+const char chunkedMagic[8] = { 'g', '5', 'p', 'm', 'e', 'm', '0', '1' };
+
+/** Bytes per page, the unit of zero skipping. */
+const uint64_t chunkPageBytes = 4096;
+
+/** Pages per block, the unit of compression. */
+const uint64_t chunkBlockPages = 16;
+
+const uint64_t chunkBlockBytes = chunkPageBytes * chunkBlockPages;
+
+struct ChunkedHeader
+{
+    char magic[8];
+    uint32_t pageBytes;
+    uint32_t blockPages;
+    uint64_t rangeSize;
+    uint64_t numBlocks;
+    uint64_t indexOffset;
+};
+
+struct ChunkedIndexEntry
+{
+    /** Offset of the compressed pages in the file. */
+    uint64_t offset;
+    /** Compressed size, zero if all pages are zero. */
+    uint32_t length;
+    /** Pages of the block that are stored, i.e., not all zero. */
+    uint16_t pageMask;
+    uint16_t reserved;
+};
+
+static_assert(chunkBlockPages <= 16, "Page mask of a block is 16 bits");
+
+bool
+isZeroPage(const uint8_t* page, uint64_t bytes)
+{
+    // backing stores and pages are word aligned, and page sizes are
+    // a multiple of the word size, so compare words
+    const uint64_t* words = (const uint64_t*)page;
+    uint64_t acc = 0;
+    for (uint64_t i = 0; i < bytes / sizeof(uint64_t); ++i)
+        acc |= words[i];
+    for (uint64_t i = bytes & ~(sizeof(uint64_t) - 1); i < bytes; ++i)
+        acc |= page[i];
+    return acc == 0;
+}
+
+/** Bytes of the pages in a block, the last one possibly partial. */
+uint64_t
+pageBytes(uint64_t block_bytes, unsigned page)
+{
+    return min(chunkPageBytes, block_bytes - page * chunkPageBytes);
+}
+
+/**
+ * Read or write all bytes at an offset. These report failures rather
+ * than calling fatal, as the workers that use them cannot, so the
+ * thread that started the workers does it once they are done.
+ *
+ * @return False if the file ended early or an error occurred
+ */
+bool
+preadAll(int fd, void* buf, uint64_t bytes, uint64_t offset)
+{
+    uint8_t* p = (uint8_t*)buf;
+    while (bytes) {
+        ssize_t n = pread(fd, p, bytes, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+bool
+pwriteAll(int fd, const void* buf, uint64_t bytes, uint64_t offset)
+{
+    const uint8_t* p = (const uint8_t*)buf;
+    while (bytes) {
+        ssize_t n = pwrite(fd, p, bytes, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/** Size of the default hugetlb pages of the host. */
+uint64_t
+hugePageSize()
+{
+    unsigned long kb = 0;
+    FILE* meminfo = fopen("/proc/meminfo", "r");
+    if (meminfo) {
+        char line[128];
+        while (fgets(line, sizeof(line), meminfo)) {
+            if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1)
+                break;
+        }
+        fclose(meminfo);
+    }
+    return kb ? kb << 10 : 2 << 20;
+}
+
+} // anonymous namespace
+
 PhysicalMemory::PhysicalMemory(const string& _name,
                                const vector<AbstractMemory*>& _memories,
-                               bool mmap_using_noreserve) :
+                               bool mmap_using_noreserve,
+                               unsigned checkpoint_threads,
+                               bool checkpoint_raw,
+                               const string& image_dir,
+                               Enums::HugePages huge_pages) :
     _name(_name), rangeCache(addrMap.end()), size(0),
-    mmapUsingNoReserve(mmap_using_noreserve)
+    mmapUsingNoReserve(mmap_using_noreserve),
+    checkpointThreads(checkpoint_threads),
+    checkpointRaw(checkpoint_raw),
+    imageDir(image_dir),
+    hugePages(huge_pages)
 {
     if (mmap_using_noreserve)
         warn("Not reserving swap space. May cause SIGSEGV on actual usage\n");
@@ -172,9 +313,37 @@ PhysicalMemory::createBackingStore(AddrRange range,
         map_flags |= MAP_NORESERVE;
     }
 
-    uint8_t* pmem = (uint8_t*) mmap(NULL, range.size(),
-                                    PROT_READ | PROT_WRITE,
-                                    map_flags, -1, 0);
+    uint64_t map_bytes = range.size();
+    bool hugetlb = false;
+    uint8_t* pmem = (uint8_t*) MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (hugePages == Enums::hugetlb) {
+        // hugetlb mappings are a whole number of huge pages, taken
+        // from the pool reserved on the host, and fail if it is short
+        uint64_t huge_bytes = hugePageSize();
+        uint64_t huge_map_bytes = roundUp(map_bytes, huge_bytes);
+        pmem = (uint8_t*) mmap(NULL, huge_map_bytes, PROT_READ | PROT_WRITE,
+                               map_flags | MAP_HUGETLB, -1, 0);
+        if (pmem != (uint8_t*) MAP_FAILED) {
+            map_bytes = huge_map_bytes;
+            hugetlb = true;
+        } else {
+            warn("Could not map range %s in %d byte huge pages (%s), " \
+                 "advising transparent huge pages instead\n",
+                 range.to_string(), huge_bytes, strerror(errno));
+        }
+    }
+#else
+    if (hugePages == Enums::hugetlb)
+        warn("No hugetlb pages on this host, advising transparent huge " \
+             "pages instead\n");
+#endif
+
+    if (!hugetlb) {
+        pmem = (uint8_t*) mmap(NULL, map_bytes, PROT_READ | PROT_WRITE,
+                               map_flags, -1, 0);
+    }
 
     if (pmem == (uint8_t*) MAP_FAILED) {
         perror("mmap");
@@ -182,9 +351,26 @@ PhysicalMemory::createBackingStore(AddrRange range,
               range.to_string());
     }
 
+    if (hugePages != Enums::none && !hugetlb) {
+        // transparent huge pages are a hint, and whether the host
+        // finds them as memory gets touched shows in hugePageBytes()
+#ifdef MADV_HUGEPAGE
+        if (madvise(pmem, map_bytes, MADV_HUGEPAGE))
+            warn("Could not advise huge pages for range %s (%s)\n",
+                 range.to_string(), strerror(errno));
+#else
+        warn_once("No transparent huge pages on this host\n");
+#endif
+    }
+
+    if (hugetlb)
+        inform("Backing range %s by %d bytes of hugetlb pages\n",
+               range.to_string(), map_bytes);
+
     // remember this backing store so we can checkpoint it and unmap
     // it appropriately
     backingStore.push_back(make_pair(range, pmem));
+    backingStoreMaps.push_back(make_pair(map_bytes, hugetlb));
 
     // point the memories to their backing store
     for (const auto& m : _memories) {
@@ -197,8 +383,52 @@ PhysicalMemory::createBackingStore(AddrRange range,
 PhysicalMemory::~PhysicalMemory()
 {
     // unmap the backing store
-    for (auto& s : backingStore)
-        munmap((char*)s.second, s.first.size());
+    for (size_t i = 0; i < backingStore.size(); ++i)
+        munmap((char*)backingStore[i].second, backingStoreMaps[i].first);
+}
+
+uint64_t
+PhysicalMemory::hugePageBytes() const
+{
+    if (hugePages == Enums::none)
+        return 0;
+
+    uint64_t bytes = 0;
+    bool transparent = false;
+    for (const auto& m : backingStoreMaps) {
+        if (m.second)
+            bytes += m.first;
+        else
+            transparent = true;
+    }
+    if (!transparent)
+        return bytes;
+
+    // the transparent huge pages of a store are the anonymous huge
+    // pages of the host memory areas that it spans
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps)
+        return bytes;
+
+    char line[256];
+    bool in_store = false;
+    while (fgets(line, sizeof(line), smaps)) {
+        unsigned long start, end, kb;
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            in_store = false;
+            for (size_t i = 0; i < backingStore.size(); ++i) {
+                uintptr_t s = (uintptr_t)backingStore[i].second;
+                if (!backingStoreMaps[i].second &&
+                    start < s + backingStoreMaps[i].first && s < end)
+                    in_store = true;
+            }
+        } else if (in_store &&
+                   sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            bytes += kb << 10;
+        }
+    }
+    fclose(smaps);
+    return bytes;
 }
 
 bool
@@ -334,34 +564,14 @@ PhysicalMemory::serializeStore(ostream& os, unsigned int store_id,
     SERIALIZE_SCALAR(filename);
     SERIALIZE_SCALAR(range_size);
 
-    // write memory file
-    string filepath = Checkpoint::dir() + "/" + filename.c_str();
-    gzFile compressed_mem = gzopen(filepath.c_str(), "wb");
-    if (compressed_mem == NULL)
-        fatal("Can't open physical memory checkpoint file '%s'\n",
-              filename);
-
-    uint64_t pass_size = 0;
-
-    // gzwrite fails if (int)len < 0 (gzwrite returns int)
-    for (uint64_t written = 0; written < range.size();
-         written += pass_size) {
-        pass_size = (uint64_t)INT_MAX < (range.size() - written) ?
-            (uint64_t)INT_MAX : (range.size() - written);
-
-        if (gzwrite(compressed_mem, pmem + written,
-                    (unsigned int) pass_size) != (int) pass_size) {
-            fatal("Write failed on physical memory checkpoint file '%s'\n",
-                  filename);
-        }
-    }
-
-    // close the compressed stream and check that the exit status
-    // is zero
-    if (gzclose(compressed_mem))
-        fatal("Close failed on physical memory checkpoint file '%s'\n",
-              filename);
+    string format = checkpointRaw ? "raw" : "chunked";
+    SERIALIZE_SCALAR(format);
 
+    string filepath = Checkpoint::dir() + "/" + filename;
+    if (checkpointRaw)
+        serializeRaw(filename, filepath, range, pmem);
+    else
+        serializeChunked(filename, filepath, range, pmem);
 }
 
 void
@@ -391,8 +601,6 @@ PhysicalMemory::unserialize(Checkpoint* cp, const string& section)
 void
 PhysicalMemory::unserializeStore(Checkpoint* cp, const string& section)
 {
-    const uint32_t chunk_size = 16384;
-
     unsigned int store_id;
     UNSERIALIZE_SCALAR(store_id);
 
@@ -400,11 +608,6 @@ PhysicalMemory::unserializeStore(Checkpoint* cp, const string& section)
     UNSERIALIZE_SCALAR(filename);
     string filepath = cp->cptDir + "/" + filename;
 
-    // mmap memoryfile
-    gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
-    if (compressed_mem == NULL)
-        fatal("Can't open physical memory checkpoint file '%s'", filename);
-
     // we've already got the actual backing store mapped
     uint8_t* pmem = backingStore[store_id].second;
     AddrRange range = backingStore[store_id].first;
@@ -419,6 +622,78 @@ PhysicalMemory::unserializeStore(Checkpoint* cp, const string& section)
         fatal("Memory range size has changed! Saw %lld, expected %lld\n",
               range_size, range.size());
 
+    // checkpoints without a format are a single gzip stream
+    string format = "gzip";
+    UNSERIALIZE_OPT_SCALAR(format);
+
+    if (format != "raw" && !imageDir.empty()) {
+        // Expand the checkpoint to a raw image once, under a lock so
+        // that concurrent runs wait for the first one rather than
+        // expanding it too, and map the image like a raw checkpoint
+        string image = imagePath(filename, filepath);
+        string lock_path = image + ".lock";
+        int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT, 0664);
+        if (lock_fd < 0 || flock(lock_fd, LOCK_EX))
+            fatal("Can't lock memory image '%s'\n", lock_path);
+
+        if (::access(image.c_str(), F_OK) != 0) {
+            inform("Creating memory image %s from %s\n", image, filename);
+            string tmp = image + ".tmp";
+            if (format == "chunked")
+                unserializeChunked(filename, filepath, range, pmem);
+            else
+                unserializeGzip(filename, filepath, range, pmem);
+            serializeRaw(tmp, tmp, range, pmem);
+            if (rename(tmp.c_str(), image.c_str()))
+                fatal("Can't create memory image '%s'\n", image);
+        }
+
+        flock(lock_fd, LOCK_UN);
+        close(lock_fd);
+        filepath = image;
+        format = "raw";
+    }
+
+    if (format == "chunked")
+        unserializeChunked(filename, filepath, range, pmem);
+    else if (format == "raw")
+        unserializeRaw(filename, filepath, range, pmem);
+    else if (format == "gzip")
+        unserializeGzip(filename, filepath, range, pmem);
+    else
+        fatal("Unknown format '%s' of physical memory checkpoint file '%s'\n",
+              format, filename);
+}
+
+string
+PhysicalMemory::imagePath(const string& filename,
+                          const string& filepath) const
+{
+    char* real_path = realpath(filepath.c_str(), NULL);
+    struct stat file_stat;
+    if (!real_path || stat(real_path, &file_stat))
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    string identity = csprintf("%s:%d:%d:%d", real_path, file_stat.st_size,
+                               file_stat.st_mtime, file_stat.st_ino);
+    free(real_path);
+    return csprintf("%s/%016x.%s", imageDir, hash<string>()(identity),
+                    filename);
+}
+
+void
+PhysicalMemory::unserializeGzip(const string& filename,
+                                const string& filepath,
+                                AddrRange range, uint8_t* pmem)
+{
+    const uint32_t chunk_size = 16384;
+
+    // mmap memoryfile
+    gzFile compressed_mem = gzopen(filepath.c_str(), "rb");
+    if (compressed_mem == NULL)
+        fatal("Can't open physical memory checkpoint file '%s'", filename);
+
     uint64_t curr_size = 0;
     long* temp_page = new long[chunk_size];
     long* pmem_current;
@@ -447,3 +722,427 @@ PhysicalMemory::unserializeStore(Checkpoint* cp, const string& section)
         fatal("Close failed on physical memory checkpoint file '%s'\n",
               filename);
 }
+
+unsigned
+PhysicalMemory::checkpointThreadCount(uint64_t num_blocks) const
+{
+    uint64_t threads = checkpointThreads ? checkpointThreads :
+        max(thread::hardware_concurrency(), 1U);
+    return max<uint64_t>(min(threads, num_blocks), 1);
+}
+
+void
+PhysicalMemory::serializeChunked(const string& filename,
+                                 const string& filepath,
+                                 AddrRange range, uint8_t* pmem)
+{
+    int fd = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (fd < 0)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    uint64_t range_size = range.size();
+    ChunkedHeader header;
+    memcpy(header.magic, chunkedMagic, sizeof(header.magic));
+    header.pageBytes = chunkPageBytes;
+    header.blockPages = chunkBlockPages;
+    header.rangeSize = range_size;
+    header.numBlocks = divCeil(range_size, chunkBlockBytes);
+    header.indexOffset = 0;
+    uint64_t num_blocks = header.numBlocks;
+
+    vector<ChunkedIndexEntry> index(num_blocks);
+
+    // The workers compress blocks into a ring of slots, from which
+    // this thread writes them out in order. A worker only starts a
+    // block when its slot has been written.
+    unsigned num_threads = checkpointThreadCount(num_blocks);
+    uint64_t num_slots = 4 * num_threads;
+    struct Slot
+    {
+        vector<Bytef> buf;
+        bool ready;
+    };
+    vector<Slot> slots(num_slots);
+    mutex lock;
+    condition_variable cond;
+    uint64_t next_block = 0;
+    uint64_t written_blocks = 0;
+    bool compress_failed = false;
+
+    auto compress_blocks = [&]() {
+        vector<Bytef> pages(chunkBlockBytes);
+        while (true) {
+            uint64_t b;
+            {
+                unique_lock<mutex> guard(lock);
+                cond.wait(guard, [&] {
+                    return next_block >= num_blocks ||
+                        next_block < written_blocks + num_slots;
+                });
+                if (next_block >= num_blocks)
+                    return;
+                b = next_block++;
+            }
+
+            uint8_t* block = pmem + b * chunkBlockBytes;
+            uint64_t block_bytes =
+                min(chunkBlockBytes, range_size - b * chunkBlockBytes);
+            unsigned num_pages = divCeil(block_bytes, chunkPageBytes);
+
+            // gather the non-zero pages, unless all of them are
+            uint16_t mask = 0;
+            uint64_t bytes = 0;
+            for (unsigned p = 0; p < num_pages; ++p) {
+                uint8_t* page = block + p * chunkPageBytes;
+                uint64_t page_bytes = pageBytes(block_bytes, p);
+                if (isZeroPage(page, page_bytes))
+                    continue;
+                mask |= 1 << p;
+                memcpy(&pages[bytes], page, page_bytes);
+                bytes += page_bytes;
+            }
+            const Bytef* src = bytes == block_bytes ? block : pages.data();
+
+            Slot& slot = slots[b % num_slots];
+            uLongf length = 0;
+            bool compressed = true;
+            if (mask) {
+                slot.buf.resize(compressBound(bytes));
+                length = slot.buf.size();
+                compressed = compress2(slot.buf.data(), &length, src, bytes,
+                                       Z_BEST_SPEED) == Z_OK;
+                if (!compressed)
+                    length = 0;
+            }
+
+            {
+                lock_guard<mutex> guard(lock);
+                compress_failed |= !compressed;
+                index[b].length = length;
+                index[b].pageMask = mask;
+                index[b].reserved = 0;
+                slot.ready = true;
+            }
+            cond.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for (unsigned i = 0; i < num_threads; ++i)
+        workers.emplace_back(compress_blocks);
+
+    uint64_t offset = sizeof(header);
+    bool failed = lseek(fd, offset, SEEK_SET) != (off_t)offset;
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        Slot& slot = slots[b % num_slots];
+        {
+            unique_lock<mutex> guard(lock);
+            cond.wait(guard, [&] { return slot.ready; });
+        }
+
+        index[b].offset = offset;
+        uint32_t length = index[b].length;
+        if (!failed && length &&
+            atomic_write(fd, slot.buf.data(), length) != (ssize_t)length)
+            failed = true;
+        offset += length;
+
+        {
+            lock_guard<mutex> guard(lock);
+            slot.ready = false;
+            ++written_blocks;
+        }
+        cond.notify_all();
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    if (compress_failed)
+        fatal("Compression failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    // the index goes last, and the header that points to it first
+    header.indexOffset = offset;
+    uint64_t index_bytes = num_blocks * sizeof(ChunkedIndexEntry);
+    if (failed ||
+        atomic_write(fd, index.data(), index_bytes) != (ssize_t)index_bytes ||
+        pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    if (close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    DPRINTF(Checkpoint, "Wrote %d blocks of %s in %d bytes with %d threads\n",
+            num_blocks, filename, offset + index_bytes, num_threads);
+}
+
+void
+PhysicalMemory::unserializeChunked(const string& filename,
+                                   const string& filepath,
+                                   AddrRange range, uint8_t* pmem)
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    ChunkedHeader header;
+    if (!preadAll(fd, &header, sizeof(header), 0))
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filename);
+    if (memcmp(header.magic, chunkedMagic, sizeof(header.magic)) != 0 ||
+        header.pageBytes != chunkPageBytes ||
+        header.blockPages != chunkBlockPages ||
+        header.rangeSize != range.size() ||
+        header.numBlocks != divCeil(header.rangeSize, chunkBlockBytes))
+        fatal("Physical memory checkpoint file '%s' is corrupt\n",
+              filename);
+
+    uint64_t range_size = header.rangeSize;
+    uint64_t num_blocks = header.numBlocks;
+    vector<ChunkedIndexEntry> index(num_blocks);
+    if (!preadAll(fd, index.data(), num_blocks * sizeof(ChunkedIndexEntry),
+                  header.indexOffset))
+        fatal("Read failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    // Blocks are independent, so the workers simply take the next
+    // one, and all-zero pages are never touched, which keeps a
+    // sparse backing store sparse
+    mutex lock;
+    uint64_t next_block = 0;
+    uint64_t corrupt_block = num_blocks;
+
+    auto decompress_blocks = [&]() {
+        vector<Bytef> compressed;
+        vector<Bytef> pages(chunkBlockBytes);
+        while (true) {
+            uint64_t b;
+            {
+                lock_guard<mutex> guard(lock);
+                if (next_block >= num_blocks)
+                    return;
+                b = next_block++;
+            }
+
+            const ChunkedIndexEntry& entry = index[b];
+            if (!entry.pageMask)
+                continue;
+
+            uint8_t* block = pmem + b * chunkBlockBytes;
+            uint64_t block_bytes =
+                min(chunkBlockBytes, range_size - b * chunkBlockBytes);
+            unsigned num_pages = divCeil(block_bytes, chunkPageBytes);
+            uint64_t bytes = 0;
+            for (unsigned p = 0; p < num_pages; ++p)
+                if (entry.pageMask & (1 << p))
+                    bytes += pageBytes(block_bytes, p);
+
+            compressed.resize(entry.length);
+            bool whole = bytes == block_bytes;
+            uLongf length = bytes;
+            if (!preadAll(fd, compressed.data(), entry.length,
+                          entry.offset) ||
+                uncompress(whole ? block : pages.data(), &length,
+                           compressed.data(), entry.length) != Z_OK ||
+                length != bytes) {
+                lock_guard<mutex> guard(lock);
+                corrupt_block = min(corrupt_block, b);
+                next_block = num_blocks;
+                return;
+            }
+            if (whole)
+                continue;
+
+            uint64_t pos = 0;
+            for (unsigned p = 0; p < num_pages; ++p) {
+                if (!(entry.pageMask & (1 << p)))
+                    continue;
+                uint64_t page_bytes = pageBytes(block_bytes, p);
+                memcpy(block + p * chunkPageBytes, &pages[pos], page_bytes);
+                pos += page_bytes;
+            }
+        }
+    };
+
+    unsigned num_threads = checkpointThreadCount(num_blocks);
+    vector<thread> workers;
+    for (unsigned i = 0; i < num_threads; ++i)
+        workers.emplace_back(decompress_blocks);
+    for (auto& worker : workers)
+        worker.join();
+
+    if (corrupt_block < num_blocks)
+        fatal("Physical memory checkpoint file '%s' is corrupt "
+              "at block %d\n", filename, corrupt_block);
+
+    if (close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filename);
+}
+
+void
+PhysicalMemory::serializeRaw(const string& filename, const string& filepath,
+                             AddrRange range, uint8_t* pmem)
+{
+    int fd = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if (fd < 0)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    // size the file first, so that the pages that are never written
+    // remain holes
+    uint64_t range_size = range.size();
+    if (ftruncate(fd, range_size))
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    uint64_t num_blocks = divCeil(range_size, chunkBlockBytes);
+    mutex lock;
+    uint64_t next_block = 0;
+    bool failed = false;
+
+    // write each run of non-zero pages in a block at once
+    auto write_blocks = [&]() {
+        while (true) {
+            uint64_t b;
+            {
+                lock_guard<mutex> guard(lock);
+                if (next_block >= num_blocks)
+                    return;
+                b = next_block++;
+            }
+
+            uint64_t block_offset = b * chunkBlockBytes;
+            uint64_t block_bytes =
+                min(chunkBlockBytes, range_size - block_offset);
+            unsigned num_pages = divCeil(block_bytes, chunkPageBytes);
+            uint64_t run_start = 0;
+            uint64_t run_bytes = 0;
+            for (unsigned p = 0; p <= num_pages; ++p) {
+                uint64_t offset = block_offset + p * chunkPageBytes;
+                if (p < num_pages &&
+                    !isZeroPage(pmem + offset, pageBytes(block_bytes, p))) {
+                    if (!run_bytes)
+                        run_start = offset;
+                    run_bytes += pageBytes(block_bytes, p);
+                } else if (run_bytes) {
+                    if (!pwriteAll(fd, pmem + run_start, run_bytes,
+                                   run_start)) {
+                        lock_guard<mutex> guard(lock);
+                        failed = true;
+                        next_block = num_blocks;
+                        return;
+                    }
+                    run_bytes = 0;
+                }
+            }
+        }
+    };
+
+    unsigned num_threads = checkpointThreadCount(num_blocks);
+    vector<thread> workers;
+    for (unsigned i = 0; i < num_threads; ++i)
+        workers.emplace_back(write_blocks);
+    for (auto& worker : workers)
+        worker.join();
+
+    if (failed)
+        fatal("Write failed on physical memory checkpoint file '%s'\n",
+              filename);
+
+    if (close(fd))
+        fatal("Close failed on physical memory checkpoint file '%s'\n",
+              filename);
+}
+
+void
+PhysicalMemory::unserializeRaw(const string& filename, const string& filepath,
+                               AddrRange range, uint8_t* pmem)
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+        fatal("Can't open physical memory checkpoint file '%s'\n",
+              filename);
+
+    struct stat file_stat;
+    off_t range_size = range.size();
+    if (fstat(fd, &file_stat) || file_stat.st_size != range_size)
+        fatal("Physical memory checkpoint file '%s' is corrupt\n",
+              filename);
+
+    // hugetlb pages can only be replaced by whole huge pages, so read
+    // the image into them instead
+    for (size_t i = 0; i < backingStore.size(); ++i) {
+        if (backingStore[i].second == pmem && backingStoreMaps[i].second) {
+            DPRINTF(Checkpoint, "Reading %s into hugetlb pages\n",
+                    filename);
+            if (!preadAll(fd, pmem, range_size, 0))
+                fatal("Read failed on physical memory checkpoint file "
+                      "'%s'\n", filename);
+            close(fd);
+            return;
+        }
+    }
+
+    // the private file mapping replaces the anonymous one in place,
+    // so the memories keep their pointers to the backing store
+    int map_flags = MAP_PRIVATE | MAP_FIXED;
+    if (mmapUsingNoReserve)
+        map_flags |= MAP_NORESERVE;
+
+    off_t page_bytes = sysconf(_SC_PAGESIZE);
+    uint64_t mapped_bytes = 0;
+    unsigned regions = 0;
+    auto map_region = [&](off_t start, off_t end) {
+        start = roundDown(start, page_bytes);
+        end = min(roundUp(end, page_bytes), range_size);
+        if (mmap(pmem + start, end - start, PROT_READ | PROT_WRITE,
+                 map_flags, fd, start) == MAP_FAILED) {
+            perror("mmap");
+            fatal("Could not map physical memory checkpoint file '%s'\n",
+                  filename);
+        }
+        mapped_bytes += end - start;
+        ++regions;
+    };
+
+    // Only map the regions that hold data, if the file system can
+    // tell where the holes are, and otherwise map it all. Holes
+    // smaller than a megabyte are mapped along with their neighbours,
+    // as they read as zero anyway, and every mapping costs the host a
+    // memory area.
+    const off_t min_hole = 1 << 20;
+    off_t map_start = 0;
+    off_t map_end = range_size;
+#ifdef SEEK_DATA
+    off_t data = lseek(fd, 0, SEEK_DATA);
+    if (data >= 0 || errno == ENXIO) {
+        map_end = 0;
+        while (data >= 0 && data < range_size) {
+            off_t hole = lseek(fd, data, SEEK_HOLE);
+            if (hole < 0)
+                hole = range_size;
+            if (map_end == 0 || data - map_end >= min_hole) {
+                if (map_end)
+                    map_region(map_start, map_end);
+                map_start = data;
+            }
+            map_end = hole;
+            data = lseek(fd, hole, SEEK_DATA);
+        }
+    }
+#endif
+    if (map_end)
+        map_region(map_start, map_end);
+
+    // the mappings keep the file open
+    close(fd);
+
+    DPRINTF(Checkpoint, "Mapped %d of %d bytes of %s in %d regions\n",
+            mapped_bytes, range_size, filename, regions);
+}
@@ -41,6 +41,7 @@
 #define __MEM_PHYSICAL_HH__
 
 #include "base/addr_range_map.hh"
+#include "enums/HugePages.hh"
 #include "mem/packet.hh"
 
 /**
@@ -88,10 +89,29 @@ class PhysicalMemory : public Serializable
     // Let the user choose if we reserve swap space when calling mmap
     const bool mmapUsingNoReserve;
 
+    // Threads that (un)serialize the backing stores, 0 for one per
+    // host core
+    const unsigned checkpointThreads;
+
+    // Checkpoint the backing stores as sparse, uncompressed images
+    // that are mapped rather than read on restore
+    const bool checkpointRaw;
+
+    // Directory of the raw images that compressed checkpoints are
+    // expanded to once, and then shared by all restores, or empty
+    const std::string imageDir;
+
+    // Huge pages to back the memory by
+    const Enums::HugePages hugePages;
+
     // The physical memory used to provide the memory in the simulated
     // system
     std::vector<std::pair<AddrRange, uint8_t*>> backingStore;
 
+    // Bytes mapped for each backing store, which hugetlb pages round
+    // up, and whether the mapping is of hugetlb pages
+    std::vector<std::pair<uint64_t, bool>> backingStoreMaps;
+
     // Prevent copying
     PhysicalMemory(const PhysicalMemory&);
 
@@ -109,6 +129,69 @@ class PhysicalMemory : public Serializable
     void createBackingStore(AddrRange range,
                             const std::vector<AbstractMemory*>& _memories);
 
+    /**
+     * Number of threads to use for checkpointing a number of blocks.
+     */
+    unsigned checkpointThreadCount(uint64_t num_blocks) const;
+
+    /**
+     * Write a backing store as independently compressed blocks of
+     * pages, followed by an index of the blocks. The blocks are
+     * compressed by several threads in parallel, and pages that are
+     * all zero are left out.
+     *
+     * @param filename Name of the file, for error messages
+     * @param filepath Path of the file to write
+     * @param range The address range of this backing store
+     * @param pmem The host pointer to this backing store
+     */
+    void serializeChunked(const std::string& filename,
+                          const std::string& filepath,
+                          AddrRange range, uint8_t* pmem);
+
+    /**
+     * Read a backing store written by serializeChunked, decompressing
+     * blocks in parallel and only touching the pages that are not
+     * all zero.
+     */
+    void unserializeChunked(const std::string& filename,
+                            const std::string& filepath,
+                            AddrRange range, uint8_t* pmem);
+
+    /**
+     * Write a backing store as a sparse file that is an image of the
+     * memory, with holes where pages are all zero.
+     */
+    void serializeRaw(const std::string& filename,
+                      const std::string& filepath,
+                      AddrRange range, uint8_t* pmem);
+
+    /**
+     * Map the data regions of an image written by serializeRaw
+     * copy-on-write over the backing store, so that pages are only
+     * read from the file when touched, and the holes remain
+     * anonymous zero pages.
+     */
+    void unserializeRaw(const std::string& filename,
+                        const std::string& filepath,
+                        AddrRange range, uint8_t* pmem);
+
+    /**
+     * Path of the shared raw image of a compressed checkpoint file,
+     * which depends on the identity of the file, so that a changed
+     * checkpoint gets a new image.
+     */
+    std::string imagePath(const std::string& filename,
+                          const std::string& filepath) const;
+
+    /**
+     * Read a backing store from a single gzip stream, as written by
+     * older versions.
+     */
+    void unserializeGzip(const std::string& filename,
+                         const std::string& filepath,
+                         AddrRange range, uint8_t* pmem);
+
   public:
 
     /**
@@ -116,7 +199,11 @@ class PhysicalMemory : public Serializable
      */
     PhysicalMemory(const std::string& _name,
                    const std::vector<AbstractMemory*>& _memories,
-                   bool mmap_using_noreserve);
+                   bool mmap_using_noreserve,
+                   unsigned checkpoint_threads = 0,
+                   bool checkpoint_raw = false,
+                   const std::string& image_dir = "",
+                   Enums::HugePages huge_pages = Enums::none);
 
     /**
      * Unmap all the backing store we have used.
@@ -170,6 +257,15 @@ class PhysicalMemory : public Serializable
     std::vector<std::pair<AddrRange, uint8_t*>> getBackingStore() const
     { return backingStore; }
 
+    /**
+     * Get the number of bytes of the backing store that the host
+     * actually backs by huge pages, as transparent ones are only
+     * advised and may not be available.
+     *
+     * @return Bytes in huge pages, zero if they are not used
+     */
+    uint64_t hugePageBytes() const;
+
     /**
      * Perform an untimed memory access and update all the state
      * (e.g. locked addresses) and statistics accordingly. The packet
@@ -57,8 +57,13 @@
 #include "base/flags.hh"
 #include "base/misc.hh"
 #include "base/types.hh"
+#include "config/use_pool_alloc.hh"
 #include "sim/core.hh"
 
+#if USE_POOL_ALLOC
+#include "base/pool_alloc.hh"
+#endif
+
 /**
  * Special TaskIds that are used for per-context-switch stats dumps
  * and Cache Occupancy. Having too many tasks seems to be a problem
@@ -349,6 +354,28 @@ class Request
 
     ~Request() {}
 
+#if USE_POOL_ALLOC
+    static PoolAllocator &
+    pool()
+    {
+        static PoolAllocator requestPool("request", sizeof(Request));
+        return requestPool;
+    }
+
+    static void *
+    operator new(size_t size)
+    {
+        assert(size == sizeof(Request));
+        return pool().allocate();
+    }
+
+    static void
+    operator delete(void *p)
+    {
+        pool().deallocate(p);
+    }
+#endif
+
     /**
      * Set up CPU and thread numbers.
      */
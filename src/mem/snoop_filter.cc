@@ -42,24 +42,282 @@
  * Definition of a snoop filter.
  */
 
+#include <algorithm>
+
 #include "base/misc.hh"
 #include "base/trace.hh"
 #include "debug/SnoopFilter.hh"
 #include "mem/snoop_filter.hh"
 #include "sim/system.hh"
 
+SnoopFilter::SnoopFilter(const SnoopFilterParams *p) : SimObject(p),
+    maskBytes(0), invalidating(false),
+    linesize(p->system->cacheLineSize()), lookupLatency(p->lookup_latency),
+    numLines(p->max_capacity / linesize), assoc(p->assoc), numSets(0),
+    useCounter(0), masterId(p->system->getMasterId(name())),
+    system(p->system)
+{
+    if (numLines == 0)
+        return;
+
+    if (assoc == 0 || numLines < assoc || numLines % assoc != 0)
+        fatal("%s: capacity of %d lines does not fit associativity %d\n",
+              name(), numLines, assoc);
+    numSets = numLines / assoc;
+    if (!isPowerOf2(numSets))
+        fatal("%s: number of sets (%d) must be a power of 2\n",
+              name(), numSets);
+}
+
+void
+SnoopFilter::setSlavePorts(const std::vector<SlavePort*>& bus_slave_ports)
+{
+    slavePorts = bus_slave_ports;
+    if (numLines == 0)
+        return;
+
+    // The masks only take as many bytes as there are ports
+    maskBytes = std::max<unsigned>((slavePorts.size() + 7) / 8, 1);
+    assert(maskBytes <= sizeof(SnoopMask));
+
+    SnoopEntry empty;
+    empty.lineAddr = MaxAddr;
+    empty.lastUse = 0;
+    entries.assign(numLines, empty);
+    masks.assign(numLines * 2 * maskBytes, 0);
+}
+
+int
+SnoopFilter::findWay(Addr line_addr) const
+{
+    if (entries.empty())
+        return -1;
+
+    int set = ((line_addr / linesize) & (numSets - 1)) * assoc;
+    for (unsigned way = 0; way < assoc; ++way) {
+        if (entries[set + way].lineAddr == line_addr)
+            return set + way;
+    }
+    return -1;
+}
+
+SnoopFilter::SnoopMask
+SnoopFilter::readMask(int way, bool holder) const
+{
+    const uint8_t* bytes = &masks[(2 * way + holder) * maskBytes];
+    SnoopMask mask = 0;
+    for (unsigned i = 0; i < maskBytes; ++i)
+        mask |= (SnoopMask)bytes[i] << (8 * i);
+    return mask;
+}
+
+void
+SnoopFilter::writeMask(int way, bool holder, SnoopMask mask)
+{
+    assert(maskBytes == sizeof(SnoopMask) || !(mask >> (8 * maskBytes)));
+    uint8_t* bytes = &masks[(2 * way + holder) * maskBytes];
+    for (unsigned i = 0; i < maskBytes; ++i)
+        bytes[i] = mask >> (8 * i);
+}
+
+bool
+SnoopFilter::getItem(Addr line_addr, SnoopItem& item)
+{
+    int way = findWay(line_addr);
+    if (way >= 0) {
+        entries[way].lastUse = ++useCounter;
+        item.requested = readMask(way, false);
+        item.holder = readMask(way, true);
+        return true;
+    }
+
+    auto sf_it = cachedLocations.find(line_addr);
+    if (sf_it == cachedLocations.end())
+        return false;
+    item = sf_it->second;
+    return true;
+}
+
+void
+SnoopFilter::setItem(Addr line_addr, const SnoopItem& item)
+{
+    bool release = !item.requested && !item.holder;
+
+    int way = findWay(line_addr);
+    if (way >= 0) {
+        writeMask(way, false, item.requested);
+        writeMask(way, true, item.holder);
+        if (release)
+            entries[way].lineAddr = MaxAddr;
+        return;
+    }
+
+    auto sf_it = cachedLocations.find(line_addr);
+    assert(sf_it != cachedLocations.end());
+    if (release)
+        cachedLocations.erase(sf_it);
+    else
+        sf_it->second = item;
+}
+
+void
+SnoopFilter::allocateItem(Addr line_addr, Addr& victim)
+{
+    victim = MaxAddr;
+    SnoopItem empty = { 0, 0 };
+
+    // Unbounded: create a new element through operator[]
+    if (entries.empty()) {
+        cachedLocations[line_addr] = empty;
+        return;
+    }
+
+    // Prefer a free way, otherwise the LRU way that has no request in
+    // flight, as the requester's response must find its entry
+    int set = ((line_addr / linesize) & (numSets - 1)) * assoc;
+    int repl = -1;
+    for (unsigned way = set; way < set + assoc; ++way) {
+        if (entries[way].lineAddr == MaxAddr) {
+            repl = way;
+            break;
+        }
+        if (!readMask(way, false) &&
+            (repl < 0 || entries[way].lastUse < entries[repl].lastUse))
+            repl = way;
+    }
+
+    if (repl < 0) {
+        DPRINTF(SnoopFilter, "%s: no way to evict for addr 0x%x, "\
+                "overflowing\n", __func__, line_addr);
+        overflowAllocations++;
+        cachedLocations[line_addr] = empty;
+        return;
+    }
+
+    if (entries[repl].lineAddr != MaxAddr) {
+        SnoopItem evicted = { 0, readMask(repl, true) };
+        DPRINTF(SnoopFilter, "%s: evicting addr 0x%x SF value %x.%x\n",
+                __func__, entries[repl].lineAddr, evicted.requested,
+                evicted.holder);
+        evictions++;
+        assert(evicted.holder);
+        cachedLocations[entries[repl].lineAddr] = evicted;
+        victim = entries[repl].lineAddr;
+    }
+
+    entries[repl].lineAddr = line_addr;
+    entries[repl].lastUse = ++useCounter;
+    writeMask(repl, false, 0);
+    writeMask(repl, true, 0);
+}
+
+void
+SnoopFilter::backInvalidate(Addr line_addr)
+{
+    SnoopItem sf_item;
+    bool found M5_VAR_USED = getItem(line_addr, sf_item);
+    assert(found && findWay(line_addr) < 0 && !sf_item.requested);
+    SnoopList holders = maskToPortList(sf_item.holder);
+
+    invalidating = true;
+    bool pending = false;
+    for (auto port = holders.begin(); port != holders.end(); ++port) {
+        // A snoop may have caused a writeback that got us here again,
+        // so get the line again rather than keeping a copy
+        if (!getItem(line_addr, sf_item))
+            break;
+        SnoopMask port_mask = portToMask(**port);
+
+        // Nothing to invalidate above a non-snooping port
+        bool cached = false;
+        if ((*port)->isSnooping()) {
+            DPRINTF(SnoopFilter, "%s: back-invalidating addr 0x%x in %s\n",
+                    __func__, line_addr, (*port)->name());
+            backInvalidations++;
+
+            // Dirty holders write the line back themselves. In atomic
+            // mode this happens within the snoop. In timing mode they
+            // flag the writeback they still have in flight, or a
+            // request of their own for the line, and we keep tracking
+            // them until the writeback has passed through the crossbar
+            // or a retry finds them done. The snoop needs no response,
+            // so a holder keeps its own copy of the request if it needs
+            // it for longer.
+            Request req(line_addr, linesize, 0, masterId);
+            Packet pkt(&req, MemCmd::InvalidationReq);
+            pkt.setExpressSnoop();
+            if (system->isTimingMode())
+                (*port)->sendTimingSnoopReq(&pkt);
+            else
+                (*port)->sendAtomicSnoop(&pkt);
+            cached = pkt.isBlockCached();
+
+            if (!getItem(line_addr, sf_item))
+                break;
+        }
+
+        if (cached) {
+            backInvalidationsPending++;
+            pending = true;
+        } else {
+            sf_item.holder &= ~port_mask;
+            setItem(line_addr, sf_item);
+        }
+    }
+    invalidating = false;
+
+    if (pending && getItem(line_addr, sf_item) &&
+        std::find(pendingInvalidations.begin(), pendingInvalidations.end(),
+                  line_addr) == pendingInvalidations.end())
+        pendingInvalidations.push_back(line_addr);
+}
+
+void
+SnoopFilter::retryBackInvalidation()
+{
+    if (invalidating || pendingInvalidations.empty())
+        return;
+
+    Addr line_addr = pendingInvalidations.front();
+    pendingInvalidations.pop_front();
+
+    // Lines that went back into the array, or that nobody holds any
+    // more, need no invalidation
+    SnoopItem sf_item;
+    if (findWay(line_addr) >= 0 || !getItem(line_addr, sf_item) ||
+        !sf_item.holder)
+        return;
+
+    if (sf_item.requested) {
+        // the line is in use again, try once the request is done
+        pendingInvalidations.push_back(line_addr);
+        return;
+    }
+
+    DPRINTF(SnoopFilter, "%s: retrying addr 0x%x SF value %x.%x\n",
+            __func__, line_addr, sf_item.requested, sf_item.holder);
+    backInvalidationRetries++;
+    backInvalidate(line_addr);
+}
+
 std::pair<SnoopFilter::SnoopList, Cycles>
 SnoopFilter::lookupRequest(const Packet* cpkt, const SlavePort& slave_port)
 {
     DPRINTF(SnoopFilter, "%s: packet src %s addr 0x%x cmd %s\n",
             __func__, slave_port.name(), cpkt->getAddr(), cpkt->cmdString());
 
+    retryBackInvalidation();
+
     Addr line_addr = cpkt->getAddr() & ~(linesize - 1);
     SnoopMask req_port = portToMask(slave_port);
-    auto sf_it = cachedLocations.find(line_addr);
-    bool is_hit = (sf_it != cachedLocations.end());
-    // Create a new element through operator[] and modify in-place
-    SnoopItem& sf_item = is_hit ? sf_it->second : cachedLocations[line_addr];
+    SnoopItem sf_item = { 0, 0 };
+    bool is_hit = getItem(line_addr, sf_item);
+    // Only requests that will be tracked until their response, or that
+    // tell us about a holder, allocate
+    bool track = !cpkt->req->isUncacheable() && cpkt->needsResponse();
+    Addr victim = MaxAddr;
+    if (!is_hit && track)
+        allocateItem(line_addr, victim);
     SnoopMask interested = sf_item.holder | sf_item.requested;
 
     totRequests++;
@@ -74,7 +332,7 @@ SnoopFilter::lookupRequest(const Packet* cpkt, const SlavePort& slave_port)
     DPRINTF(SnoopFilter, "%s:   SF value %x.%x\n",
             __func__, sf_item.requested, sf_item.holder);
 
-    if (!cpkt->req->isUncacheable() && cpkt->needsResponse()) {
+    if (track) {
         if (!cpkt->memInhibitAsserted()) {
             // Max one request per address per port
             panic_if(sf_item.requested & req_port, "double request :( "\
@@ -86,14 +344,24 @@ SnoopFilter::lookupRequest(const Packet* cpkt, const SlavePort& slave_port)
             // NOTE: The memInhibit might have been asserted by a cache closer
             // to the CPU, already -> the response will not be seen by this
             // filter -> we do not need to keep the in-flight request, but make
-            // sure that we know that that cluster has a copy
-            panic_if(!(sf_item.holder & req_port), "Need to hold the value!");
+            // sure that we know that that cluster has a copy. A bounded
+            // filter may have dropped the line while a holder of that
+            // cluster refused the back-invalidation.
+            panic_if(!(sf_item.holder & req_port) && entries.empty(),
+                     "Need to hold the value!");
+            sf_item.holder |= req_port;
             DPRINTF(SnoopFilter, "%s:   not marking request. SF value %x.%x\n",
                     __func__,  sf_item.requested, sf_item.holder);
         }
         DPRINTF(SnoopFilter, "%s:   new SF value %x.%x\n",
                 __func__,  sf_item.requested, sf_item.holder);
+        setItem(line_addr, sf_item);
     }
+
+    // Back-invalidate only now that we are done with the line
+    if (victim != MaxAddr)
+        backInvalidate(victim);
+
     return snoopSelected(maskToPortList(interested & ~req_port), lookupLatency);
 }
 
@@ -109,7 +377,17 @@ SnoopFilter::updateRequest(const Packet* cpkt, const SlavePort& slave_port,
 
     Addr line_addr = cpkt->getAddr() & ~(linesize - 1);
     SnoopMask req_port = portToMask(slave_port);
-    SnoopItem& sf_item  = cachedLocations[line_addr];
+    SnoopItem sf_item;
+    if (!getItem(line_addr, sf_item)) {
+        // A bounded filter may have dropped the line already, e.g.,
+        // when a back-invalidation found the block clean, but an
+        // unbounded one tracks every line held above it
+        panic_if(entries.empty(), "requester %x is not a holder :( "\
+                 "line 0x%x is untracked\n", req_port, line_addr);
+        DPRINTF(SnoopFilter, "%s:   untracked, retry: %i\n",
+                __func__, will_retry);
+        return;
+    }
 
     DPRINTF(SnoopFilter, "%s:   old SF value %x.%x retry: %i\n",
             __func__, sf_item.requested, sf_item.holder, will_retry);
@@ -117,6 +395,7 @@ SnoopFilter::updateRequest(const Packet* cpkt, const SlavePort& slave_port,
     if (will_retry) {
         // Unmark a request that will come again.
         sf_item.requested &= ~req_port;
+        setItem(line_addr, sf_item);
         return;
     }
 
@@ -131,13 +410,16 @@ SnoopFilter::updateRequest(const Packet* cpkt, const SlavePort& slave_port,
             panic_if(!(sf_item.holder & req_port), "requester %x is not a "\
                      "holder :( SF value %x.%x\n", req_port,
                      sf_item.requested, sf_item.holder);
-            // Writebacks -> the sender does not have the line anymore
-            sf_item.holder &= ~req_port;
+            // Writebacks -> the sender does not have the line anymore,
+            // unless it only cleaned a block that it keeps
+            if (!cpkt->isBlockCached())
+                sf_item.holder &= ~req_port;
         } else {
             assert(0 == "Handle non-writeback, here");
         }
         DPRINTF(SnoopFilter, "%s:   new SF value %x.%x\n",
                 __func__,  sf_item.requested, sf_item.holder);
+        setItem(line_addr, sf_item);
     }
 }
 
@@ -156,24 +438,24 @@ SnoopFilter::lookupSnoop(const Packet* cpkt)
         return snoopAll(lookupLatency);
 
     Addr line_addr = cpkt->getAddr() & ~(linesize - 1);
-    auto sf_it = cachedLocations.find(line_addr);
-    bool is_hit = (sf_it != cachedLocations.end());
-    // Create a new element through operator[] and modify in-place
-    SnoopItem& sf_item = is_hit ? sf_it->second : cachedLocations[line_addr];
+    SnoopItem sf_item;
+
+    totSnoops++;
+    if (!getItem(line_addr, sf_item)) {
+        DPRINTF(SnoopFilter, "%s:   untracked\n", __func__);
+        return snoopDown(lookupLatency);
+    }
 
     DPRINTF(SnoopFilter, "%s:   old SF value %x.%x\n",
             __func__, sf_item.requested, sf_item.holder);
 
     SnoopMask interested = (sf_item.holder | sf_item.requested);
 
-    totSnoops++;
-    if (is_hit) {
-        // Single bit set -> value is a power of two
-        if (isPow2(interested))
-            hitSingleSnoops++;
-        else
-            hitMultiSnoops++;
-    }
+    // Single bit set -> value is a power of two
+    if (isPow2(interested))
+        hitSingleSnoops++;
+    else
+        hitMultiSnoops++;
 
     assert(cpkt->isInvalidate() == cpkt->needsExclusive());
     if (cpkt->isInvalidate() && !sf_item.requested) {
@@ -186,6 +468,7 @@ SnoopFilter::lookupSnoop(const Packet* cpkt)
     DPRINTF(SnoopFilter, "%s:   new SF value %x.%x interest: %x \n",
             __func__, sf_item.requested, sf_item.holder, interested);
 
+    setItem(line_addr, sf_item);
     return snoopSelected(maskToPortList(interested), lookupLatency);
 }
 
@@ -207,7 +490,10 @@ SnoopFilter::updateSnoopResponse(const Packet* cpkt,
     Addr line_addr = cpkt->getAddr() & ~(linesize - 1);
     SnoopMask rsp_mask = portToMask(rsp_port);
     SnoopMask req_mask = portToMask(req_port);
-    SnoopItem& sf_item = cachedLocations[line_addr];
+    SnoopItem sf_item;
+    // The request allocated the line and requested lines are never evicted
+    panic_if(!getItem(line_addr, sf_item), "SF missing line 0x%x\n",
+             line_addr);
 
     DPRINTF(SnoopFilter, "%s:   old SF value %x.%x\n",
             __func__,  sf_item.requested, sf_item.holder);
@@ -238,6 +524,7 @@ SnoopFilter::updateSnoopResponse(const Packet* cpkt,
     sf_item.requested &= ~req_mask;
     DPRINTF(SnoopFilter, "%s:   new SF value %x.%x\n",
             __func__, sf_item.requested, sf_item.holder);
+    setItem(line_addr, sf_item);
 }
 
 void
@@ -249,12 +536,15 @@ SnoopFilter::updateSnoopForward(const Packet* cpkt,
             cpkt->cmdString());
 
     Addr line_addr = cpkt->getAddr() & ~(linesize - 1);
-    SnoopItem& sf_item = cachedLocations[line_addr];
     SnoopMask rsp_mask M5_VAR_USED = portToMask(rsp_port);
 
     assert(cpkt->isResponse());
     assert(cpkt->memInhibitAsserted());
 
+    SnoopItem sf_item;
+    if (!getItem(line_addr, sf_item))
+        return;
+
     DPRINTF(SnoopFilter, "%s:   old SF value %x.%x\n",
             __func__,  sf_item.requested, sf_item.holder);
 
@@ -268,6 +558,7 @@ SnoopFilter::updateSnoopForward(const Packet* cpkt,
     }
     DPRINTF(SnoopFilter, "%s:   new SF value %x.%x\n",
             __func__, sf_item.requested, sf_item.holder);
+    setItem(line_addr, sf_item);
 }
 
 void
@@ -283,7 +574,9 @@ SnoopFilter::updateResponse(const Packet* cpkt, const SlavePort& slave_port)
 
     Addr line_addr = cpkt->getAddr() & ~(linesize - 1);
     SnoopMask slave_mask = portToMask(slave_port);
-    SnoopItem& sf_item = cachedLocations[line_addr];
+    SnoopItem sf_item;
+    panic_if(!getItem(line_addr, sf_item), "SF missing line 0x%x\n",
+             line_addr);
 
     DPRINTF(SnoopFilter, "%s:   old SF value %x.%x\n",
             __func__,  sf_item.requested, sf_item.holder);
@@ -299,6 +592,7 @@ SnoopFilter::updateResponse(const Packet* cpkt, const SlavePort& slave_port)
     sf_item.requested &= ~slave_mask;
     DPRINTF(SnoopFilter, "%s:   new SF value %x.%x\n",
             __func__, sf_item.requested, sf_item.holder);
+    setItem(line_addr, sf_item);
 }
 
 void
@@ -331,6 +625,30 @@ SnoopFilter::regStats()
         .name(name() + ".hit_multi_snoops")
         .desc("Number of snoops hitting in the snoop filter with multiple "\
               "(>1) holders of the requested data.");
+
+    evictions
+        .name(name() + ".evictions")
+        .desc("Number of lines evicted from a bounded snoop filter.");
+
+    backInvalidations
+        .name(name() + ".back_invalidations")
+        .desc("Number of back-invalidation snoops sent to holders of "\
+              "evicted lines.");
+
+    backInvalidationsPending
+        .name(name() + ".back_invalidations_pending")
+        .desc("Number of back-invalidations that found a writeback or a "\
+              "request of the holder still in flight.");
+
+    backInvalidationRetries
+        .name(name() + ".back_invalidation_retries")
+        .desc("Number of evicted lines whose back-invalidation was tried "\
+              "again.");
+
+    overflowAllocations
+        .name(name() + ".overflow_allocations")
+        .desc("Number of lines tracked outside the bounded snoop filter "\
+              "because all ways had requests in flight.");
 }
 
 SnoopFilter *
@@ -45,7 +45,9 @@
 #ifndef __MEM_SNOOP_FILTER_HH__
 #define __MEM_SNOOP_FILTER_HH__
 
+#include <deque>
 #include <utility>
+#include <vector>
 
 #include "base/hashmap.hh"
 #include "mem/packet.hh"
@@ -82,15 +84,23 @@
  *     upper cache dropped a line, making the snoop filter pessimistic for now
  * (4) ordering: there is no single point of order in the system.  Instead,
  *     requesting MSHRs track order between local requests and remote snoops
+ *
+ * By default the filter tracks an unbounded number of lines. If a
+ * maximum capacity is given, lines are kept in a set-associative
+ * array with LRU replacement, whose holder and requested masks are
+ * packed in as many bytes as the ports need. Evicting a line
+ * back-invalidates all its holders, which write back dirty data on
+ * their own. Lines that cannot be dropped yet spill into an overflow
+ * map until they are no longer held or requested: those of a set
+ * whose ways all have requests in flight, and victims whose holders
+ * still have a writeback or a request of their own in flight. The
+ * back-invalidation of the latter is tried again later.
  */
 class SnoopFilter : public SimObject {
   public:
     typedef std::vector<SlavePort*> SnoopList;
 
-    SnoopFilter (const SnoopFilterParams *p) : SimObject(p),
-        linesize(p->system->cacheLineSize()), lookupLatency(p->lookup_latency)
-    {
-    }
+    SnoopFilter (const SnoopFilterParams *p);
 
     /**
      * Init a new snoop filter and tell it about all the slave ports of the
@@ -98,9 +108,7 @@ class SnoopFilter : public SimObject {
      *
      * @param bus_slave_ports Vector of slave ports that the bus is attached to.
      */
-    void setSlavePorts(const std::vector<SlavePort*>& bus_slave_ports) {
-        slavePorts = bus_slave_ports;
-    }
+    void setSlavePorts(const std::vector<SlavePort*>& bus_slave_ports);
 
     /**
      * Lookup a request (from a slave port) in the snoop filter and return a
@@ -221,7 +229,82 @@ class SnoopFilter : public SimObject {
     SnoopList maskToPortList(SnoopMask ports) const;
 
   private:
-    /** Simple hash set of cached addresses. */
+    /** One way of the bounded, set-associative tracking array. */
+    struct SnoopEntry {
+        /** Line address, MaxAddr if the way is free. */
+        Addr lineAddr;
+        /** Value of useCounter at the last access, for LRU. */
+        uint64_t lastUse;
+    };
+
+    /**
+     * Get the tracking state of a line and update its LRU position.
+     * @param line_addr Line aligned address.
+     * @param item Set to the state of the line if it is tracked.
+     * @return True if the line is tracked.
+     */
+    bool getItem(Addr line_addr, SnoopItem& item);
+
+    /**
+     * Update the tracking state of a tracked line, and stop tracking
+     * it if nobody holds or requests it any more.
+     * @param line_addr Line aligned address.
+     * @param item The new state of the line.
+     */
+    void setItem(Addr line_addr, const SnoopItem& item);
+
+    /**
+     * Start tracking a line, with an empty state. In a bounded filter
+     * this may evict the LRU line of the set that has no request in
+     * flight; if that line still has holders it moves to the overflow
+     * map and must be passed to backInvalidate() once the caller is
+     * done with the new line.
+     * @param line_addr Line aligned address, not tracked yet.
+     * @param victim Set to the line to back-invalidate, or MaxAddr.
+     */
+    void allocateItem(Addr line_addr, Addr& victim);
+
+    /**
+     * Find the way of the tracking array holding a line.
+     * @return The index of the way, or -1 if the line is not in the
+     *         array.
+     */
+    int findWay(Addr line_addr) const;
+
+    /** Read and write the packed masks of a way. */
+    SnoopMask readMask(int way, bool holder) const;
+    void writeMask(int way, bool holder, SnoopMask mask);
+
+    /**
+     * Invalidate an evicted line in all its holders. Holders that
+     * still have a writeback or a request for the line in flight stay
+     * recorded, and the line is queued to try again.
+     * @param line_addr Line aligned address of the evicted line.
+     */
+    void backInvalidate(Addr line_addr);
+
+    /**
+     * Try again the oldest back-invalidation that holders could not
+     * take, if its line is not requested at the moment.
+     */
+    void retryBackInvalidation();
+
+    /** Set-associative tracking array, empty when unbounded. */
+    std::vector<SnoopEntry> entries;
+    /**
+     * Requested and holder masks of each way of the tracking array,
+     * maskBytes each, least significant byte first.
+     */
+    std::vector<uint8_t> masks;
+    unsigned maskBytes;
+    /** Evicted lines whose holders could not be invalidated yet. */
+    std::deque<Addr> pendingInvalidations;
+    /** True while back-invalidating, which may get us here again. */
+    bool invalidating;
+    /**
+     * Hash map of tracked lines: all of them if the filter is
+     * unbounded, only the overflowing ones otherwise.
+     */
     m5::hash_map<Addr, SnoopItem> cachedLocations;
     /** List of all attached slave ports. */
     SnoopList slavePorts;
@@ -229,6 +312,16 @@ class SnoopFilter : public SimObject {
     const unsigned linesize;
     /** Latency for doing a lookup in the filter */
     const Cycles lookupLatency;
+    /** Lines, associativity and sets of the tracking array. */
+    const uint64_t numLines;
+    const unsigned assoc;
+    unsigned numSets;
+    /** Access counter used as the LRU timestamp. */
+    uint64_t useCounter;
+    /** Master id used for back-invalidation requests. */
+    const MasterID masterId;
+    /** The system, to tell atomic from timing mode. */
+    System* system;
 
     /** Statistics */
     Stats::Scalar totRequests;
@@ -238,6 +331,12 @@ class SnoopFilter : public SimObject {
     Stats::Scalar totSnoops;
     Stats::Scalar hitSingleSnoops;
     Stats::Scalar hitMultiSnoops;
+
+    Stats::Scalar evictions;
+    Stats::Scalar backInvalidations;
+    Stats::Scalar backInvalidationsPending;
+    Stats::Scalar backInvalidationRetries;
+    Stats::Scalar overflowAllocations;
 };
 
 inline SnoopFilter::SnoopMask
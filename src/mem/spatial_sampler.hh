@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of spatial sampling by hashing, for profiling a stream
+ * of addresses at a fraction of the cost.
+ */
+
+#ifndef __MEM_SPATIAL_SAMPLER_HH__
+#define __MEM_SPATIAL_SAMPLER_HH__
+
+#include "base/types.hh"
+
+/**
+ * Spatial sampling as in SHARDS (Waldspurger et al., FAST'15): a key,
+ * e.g., an address or a page number, is sampled if a hash of it falls
+ * below a threshold. All references to a sampled key are thus seen,
+ * and counts over the sampled keys scale by the inverse of the rate
+ * to estimate those over all keys. The threshold may be lowered as
+ * sampling goes on, e.g., to bound the number of keys tracked.
+ */
+class SpatialSampler
+{
+  public:
+
+    /** Hashes are in [0, 2^HashBits) */
+    static const unsigned HashBits = 24;
+
+    /**
+     * Create a sampler with a sampling rate in (0, 1], which is
+     * rounded to a multiple of 2^-HashBits.
+     */
+    SpatialSampler(double rate)
+        : threshold(rate * (ULL(1) << HashBits))
+    { }
+
+    /** Hash of a key, from a 64-bit finalizer that mixes all bits */
+    static uint64_t
+    hash(uint64_t key)
+    {
+        key ^= key >> 33;
+        key *= ULL(0xff51afd7ed558ccd);
+        key ^= key >> 33;
+        key *= ULL(0xc4ceb9fe1a85ec53);
+        key ^= key >> 33;
+        return key & ((ULL(1) << HashBits) - 1);
+    }
+
+    bool sampled(uint64_t key) const { return hash(key) < threshold; }
+
+    uint64_t getThreshold() const { return threshold; }
+
+    /** Only sample keys with hashes below a new threshold */
+    void setThreshold(uint64_t t) { threshold = t; }
+
+    double rate() const { return double(threshold) / (ULL(1) << HashBits); }
+
+  private:
+
+    uint64_t threshold;
+};
+
+#endif //__MEM_SPATIAL_SAMPLER_HH__
@@ -37,6 +37,10 @@
  * Authors: Kanishk Sugand
  */
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
 #include "base/intmath.hh"
 #include "base/trace.hh"
 #include "debug/StackDist.hh"
@@ -45,8 +49,17 @@
 StackDistCalc::StackDistCalc(const StackDistCalcParams* p) :
     SimObject(p), index(0), verifyStack(p->verify),
     disableLinearHists(p->disable_linear_hists),
-    disableLogHists(p->disable_log_hists)
+    disableLogHists(p->disable_log_hists),
+    sampler(p->sampling_rate),
+    sampling(p->sampling_rate < 1 || p->sampling_max_addrs != 0),
+    maxSampledAddrs(p->sampling_max_addrs), weightCarry(0)
 {
+    if (p->sampling_rate <= 0 || p->sampling_rate > 1)
+        fatal("%s sampling rate %f is not in (0, 1]\n", name(),
+              p->sampling_rate);
+    if (sampler.getThreshold() == 0)
+        fatal("%s sampling rate %f is too low\n", name(), p->sampling_rate);
+
     // Instantiate a new root and leaf layer
     // Map type variable, representing a layer in the tree
     IndexNodeMap tree_level;
@@ -97,17 +110,41 @@ StackDistCalc::update(const MemCmd& cmd, Addr addr)
     // only capturing read and write requests (which allocate in the
     // cache)
     if (cmd.isRead() || cmd.isWrite()) {
+        ++accesses;
+        if (sampling && !sampler.sampled(addr))
+            return;
+        ++sampledAccesses;
+
+        // the rate the access is sampled at, before tracking a new
+        // address possibly lowers it
+        double rate = sampler.rate();
+
         auto returnType = calcStackDistAndUpdate(addr);
 
         uint64_t stackDist = returnType.first;
 
+        // Each sampled access stands for 1 / rate accesses, which are
+        // counted in whole samples with the fractions carried over
+        int weight = 1;
+        if (sampling) {
+            if (stackDist == Infinity && maxSampledAddrs)
+                trackSampled(addr);
+
+            weightCarry += 1 / rate;
+            weight = weightCarry;
+            weightCarry -= weight;
+            if (stackDist != Infinity)
+                stackDist = stackDist / rate;
+        }
+        estimatedAccesses += weight;
+
         if (stackDist != Infinity) {
             // Sample the stack distance of the address in linear bins
             if (!disableLinearHists) {
                 if (cmd.isRead())
-                    readLinearHist.sample(stackDist);
+                    readLinearHist.sample(stackDist, weight);
                 else
-                    writeLinearHist.sample(stackDist);
+                    writeLinearHist.sample(stackDist, weight);
             }
 
             if (!disableLogHists) {
@@ -115,14 +152,46 @@ StackDistCalc::update(const MemCmd& cmd, Addr addr)
 
                 // Sample the stack distance of the address in log bins
                 if (cmd.isRead())
-                    readLogHist.sample(stackDistLog2);
+                    readLogHist.sample(stackDistLog2, weight);
                 else
-                    writeLogHist.sample(stackDistLog2);
+                    writeLogHist.sample(stackDistLog2, weight);
             }
         }
     }
 }
 
+void
+StackDistCalc::trackSampled(const Addr r_address)
+{
+    sampledAddrs.insert(std::make_pair(SpatialSampler::hash(r_address),
+                                       r_address));
+
+    while (sampledAddrs.size() > maxSampledAddrs) {
+        // Only sample below the largest hash from now on, and drop
+        // the addresses with it from the stack
+        uint64_t largest = sampledAddrs.rbegin()->first;
+        sampler.setThreshold(largest);
+        while (!sampledAddrs.empty() &&
+               sampledAddrs.rbegin()->first == largest) {
+            Addr evicted = sampledAddrs.rbegin()->second;
+            calcStackDistAndUpdate(evicted, false);
+            if (verifyStack)
+                stack.erase(std::find(stack.begin(), stack.end(), evicted));
+            sampledAddrs.erase(std::prev(sampledAddrs.end()));
+        }
+        DPRINTF(StackDist, "Sampling rate lowered to %f\n", sampler.rate());
+    }
+}
+
+double
+StackDistCalc::sampleError() const
+{
+    if (accesses.value() == 0)
+        return 0;
+    return std::abs(estimatedAccesses.value() - accesses.value()) /
+        accesses.value();
+}
+
 // The updateSum method is a recursive function which updates
 // the node sums till the root. It also deletes the nodes that
 // are not used anymore.
@@ -661,6 +730,28 @@ StackDistCalc::regStats()
         .name(name() + ".writeLogHist")
         .desc("Writes logarithmic distribution")
         .flags(disableLogHists ? nozero : pdf);
+
+    accesses
+        .name(name() + ".accesses")
+        .desc("Number of reads and writes seen");
+
+    sampledAccesses
+        .name(name() + ".sampledAccesses")
+        .desc("Number of reads and writes of sampled addresses");
+
+    estimatedAccesses
+        .name(name() + ".estimatedAccesses")
+        .desc("Number of reads and writes estimated from the samples");
+
+    samplingRateStat
+        .method(this, &StackDistCalc::samplingRate)
+        .name(name() + ".samplingRate")
+        .desc("Fraction of addresses sampled");
+
+    sampleErrorStat
+        .method(this, &StackDistCalc::sampleError)
+        .name(name() + ".sampleError")
+        .desc("Relative error of the accesses estimated from the samples");
 }
 
 StackDistCalc*
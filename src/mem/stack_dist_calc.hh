@@ -42,10 +42,12 @@
 #define __MEM_STACK_DIST_CALC_HH__
 
 #include <map>
+#include <set>
 #include <vector>
 
 #include "base/types.hh"
 #include "mem/packet.hh"
+#include "mem/spatial_sampler.hh"
 #include "params/StackDistCalc.hh"
 #include "sim/sim_object.hh"
 #include "sim/stats.hh"
@@ -163,6 +165,19 @@
   * layer is connected to this.  In an intermediate node update
   * operation a new intermediate node is added to the required layer.
   *
+  * Sampling: As the tree grows with the unique addresses, and each
+  * access walks it, the calculator can instead only track the
+  * addresses sampled by hashing, as in SHARDS (Waldspurger et al.,
+  * FAST'15). With a fixed sampling rate R, the stack distance d
+  * among the sampled addresses estimates a distance of d / R, and
+  * each sampled access stands for 1 / R accesses in the
+  * histograms. With a bound on the addresses tracked, the rate
+  * starts at the given one and is lowered as needed by evicting the
+  * addresses with the largest hashes, which keeps the memory and
+  * time per access constant however large the working set. The
+  * relative difference between the accesses so estimated and those
+  * seen gives an estimate of the sampling error.
+  *
   * Debugging: Debugging can be enabled by setting the verifyStack flag
   * true. Debugging is implemented using a dummy stack that behaves in
   * a naive way, using STL vectors (i.e each unique address is pushed
@@ -340,6 +355,25 @@ class StackDistCalc : public SimObject
     uint64_t verifyStackDist(const Addr r_address,
                              bool update_stack = false);
 
+    /**
+     * Start tracking a newly sampled address. If that makes for more
+     * addresses than the bound, lower the sampling rate by evicting
+     * those with the largest hash.
+     *
+     * @param r_address The address newly added to the stack
+     */
+    void trackSampled(const Addr r_address);
+
+    /**
+     * Estimate of the sampling error, as the relative difference
+     * between the accesses estimated from the samples and the
+     * accesses seen.
+     */
+    double sampleError() const;
+
+    /** The current sampling rate, for the stats */
+    double samplingRate() const { return sampler.rate(); }
+
   public:
 
     /**
@@ -437,6 +471,37 @@ class StackDistCalc : public SimObject
     // Disable the logarithmic histograms
     const bool disableLogHists;
 
+    // Sampler of the addresses, if sampling
+    SpatialSampler sampler;
+
+    // Flag to only track the sampled addresses
+    const bool sampling;
+
+    // Bound on the addresses tracked, 0 for a fixed sampling rate
+    const uint64_t maxSampledAddrs;
+
+    // Tracked addresses ordered by hash, to evict the largest first
+    std::set<std::pair<uint64_t, Addr> > sampledAddrs;
+
+    // Fraction of an access carried over to the weight of the next
+    // sampled one
+    double weightCarry;
+
+    // Accesses seen
+    Stats::Scalar accesses;
+
+    // Accesses sampled
+    Stats::Scalar sampledAccesses;
+
+    // Accesses estimated from the samples
+    Stats::Scalar estimatedAccesses;
+
+    // Sampling rate at the time of the stats
+    Stats::Value samplingRateStat;
+
+    // Estimate of the sampling error
+    Stats::Value sampleErrorStat;
+
     // Reads linear histogram
     Stats::Histogram readLinearHist;
 
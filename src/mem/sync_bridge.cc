@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Implementation of a bridge between two event queues of a parallel
+ * simulation.
+ */
+
+#include "base/trace.hh"
+#include "debug/Drain.hh"
+#include "debug/SyncBridge.hh"
+#include "mem/sync_bridge.hh"
+#include "sim/eventq_impl.hh"
+
+SyncBridge::Channel::Channel(SyncBridge &_bridge, const std::string &_name,
+                             bool _is_request)
+    : bridge(_bridge), _name(_name), isRequest(_is_request),
+      dstEventq(NULL), waitingRetry(false), pending(0)
+{
+}
+
+void
+SyncBridge::Channel::push(PacketPtr pkt)
+{
+    // the delay spans the quantum, so the destination does not look
+    // at this packet before the queues have synchronised
+    Tick when = curTick() + bridge.delay + pkt->headerDelay +
+        pkt->payloadDelay;
+    pkt->headerDelay = pkt->payloadDelay = 0;
+
+    DPRINTF(SyncBridge, "%s: %s addr %#x due at %d\n", name(),
+            pkt->cmdString(), pkt->getAddr(), when);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight.push_back(std::make_pair(when, pkt));
+    }
+    ++pending;
+
+    // one delivery per packet, delivering all that are due keeps the
+    // order of packets that become due in the same tick
+    dstEventq->schedule(
+        new EventWrapper<Channel, &Channel::deliver>(this, true), when);
+}
+
+void
+SyncBridge::Channel::deliver()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!inFlight.empty() && inFlight.front().first <= curTick()) {
+            outbound.push_back(inFlight.front().second);
+            inFlight.pop_front();
+        }
+    }
+
+    if (!waitingRetry)
+        trySend();
+}
+
+void
+SyncBridge::Channel::trySend()
+{
+    while (!outbound.empty()) {
+        PacketPtr pkt = outbound.front();
+        bool success = isRequest ? bridge.masterPort.sendTimingReq(pkt) :
+            bridge.slavePort.sendTimingResp(pkt);
+        if (!success) {
+            DPRINTF(SyncBridge, "%s: waiting for retry\n", name());
+            waitingRetry = true;
+            return;
+        }
+        outbound.pop_front();
+        --pending;
+    }
+
+    bridge.checkDrained();
+}
+
+void
+SyncBridge::Channel::retry()
+{
+    assert(waitingRetry);
+    waitingRetry = false;
+    trySend();
+}
+
+bool
+SyncBridge::Channel::checkFunctional(PacketPtr pkt)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto i = outbound.begin(); i != outbound.end(); ++i) {
+        if (pkt->checkFunctional(*i))
+            return true;
+    }
+    for (auto i = inFlight.begin(); i != inFlight.end(); ++i) {
+        if (pkt->checkFunctional(i->second))
+            return true;
+    }
+    return false;
+}
+
+SyncBridge::SyncBridge(const SyncBridgeParams *p)
+    : MemObject(p),
+      slavePort(p->name + ".slave", *this),
+      masterPort(p->name + ".master", *this),
+      masterEventq(getEventQueue(p->master_eventq_index)),
+      delay(p->delay),
+      reqChannel(*this, p->name + ".req", true),
+      respChannel(*this, p->name + ".resp", false),
+      drainManager(NULL)
+{
+    reqChannel.setEventQueue(masterEventq);
+    respChannel.setEventQueue(eventQueue());
+}
+
+void
+SyncBridge::init()
+{
+    if (!slavePort.isConnected() || !masterPort.isConnected())
+        fatal("Both ports of sync bridge %s are not connected.\n", name());
+
+    // with more than one queue, anything sent in one quantum must
+    // only be due in the next one
+    if (numMainEventQueues > 1 && delay < simQuantum)
+        fatal("%s: delay %d is shorter than the simulation quantum %d\n",
+              name(), delay, simQuantum);
+
+    slavePort.sendRangeChange();
+}
+
+bool
+SyncBridge::recvTimingReq(PacketPtr pkt)
+{
+    for (auto p : pendingDelete)
+        delete p;
+    pendingDelete.clear();
+
+    if (pkt->memInhibitAsserted()) {
+        // a cache supplies the data, and the packet is still in use on
+        // this side, so sink it here like a memory would
+        pendingDelete.push_back(pkt);
+        return true;
+    }
+
+    reqChannel.push(pkt);
+    return true;
+}
+
+bool
+SyncBridge::recvTimingResp(PacketPtr pkt)
+{
+    respChannel.push(pkt);
+    return true;
+}
+
+Tick
+SyncBridge::recvAtomic(PacketPtr pkt)
+{
+    if (inParallelMode && curEventQueue() != masterEventq) {
+        EventQueue::ScopedMigration migrate(masterEventq);
+        return masterPort.sendAtomic(pkt) + delay;
+    }
+    return masterPort.sendAtomic(pkt) + delay;
+}
+
+void
+SyncBridge::recvFunctional(PacketPtr pkt)
+{
+    if (inParallelMode && curEventQueue() != masterEventq) {
+        // stop the master side while looking at its packets
+        EventQueue::ScopedMigration migrate(masterEventq);
+        functionalAccess(pkt);
+    } else {
+        functionalAccess(pkt);
+    }
+}
+
+void
+SyncBridge::functionalAccess(PacketPtr pkt)
+{
+    pkt->pushLabel(name());
+
+    if (reqChannel.checkFunctional(pkt) || respChannel.checkFunctional(pkt)) {
+        pkt->popLabel();
+        return;
+    }
+
+    pkt->popLabel();
+
+    masterPort.sendFunctional(pkt);
+}
+
+void
+SyncBridge::checkDrained()
+{
+    std::lock_guard<std::mutex> lock(drainMutex);
+    if (drainManager && !reqChannel.size() && !respChannel.size()) {
+        DPRINTF(Drain, "%s drained\n", name());
+        setDrainState(Drainable::Drained);
+        drainManager->signalDrainDone();
+        drainManager = NULL;
+    }
+}
+
+unsigned int
+SyncBridge::drain(DrainManager *dm)
+{
+    std::lock_guard<std::mutex> lock(drainMutex);
+    if (reqChannel.size() || respChannel.size()) {
+        drainManager = dm;
+        setDrainState(Drainable::Draining);
+        return 1;
+    }
+
+    setDrainState(Drainable::Drained);
+    return 0;
+}
+
+BaseMasterPort&
+SyncBridge::getMasterPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "master")
+        return masterPort;
+    return MemObject::getMasterPort(if_name, idx);
+}
+
+BaseSlavePort&
+SyncBridge::getSlavePort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "slave")
+        return slavePort;
+    return MemObject::getSlavePort(if_name, idx);
+}
+
+SyncBridge *
+SyncBridgeParams::create()
+{
+    return new SyncBridge(this);
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a bridge between two event queues of a parallel
+ * simulation.
+ */
+
+#ifndef __MEM_SYNC_BRIDGE_HH__
+#define __MEM_SYNC_BRIDGE_HH__
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mem/mem_object.hh"
+#include "params/SyncBridge.hh"
+#include "sim/drain.hh"
+#include "sim/eventq.hh"
+
+/**
+ * A bridge whose slave side runs on the event queue of the SimObject
+ * and whose master side runs on another event queue, typically the one
+ * of a memory controller that is simulated by its own thread.
+ *
+ * Timing packets cross over with a fixed delay that must be at least
+ * one simulation quantum. A packet sent within a quantum is thus only
+ * due in a later one, after the queues have synchronised, which keeps
+ * the simulation deterministic without locking the two sides against
+ * each other. There is no flow control across the queues: each side
+ * buffers what its peer does not accept yet.
+ *
+ * Atomic and functional accesses are passed through after migrating
+ * to the queue of the other side.
+ */
+class SyncBridge : public MemObject
+{
+  protected:
+
+    /**
+     * One direction through the bridge. Packets are pushed on the
+     * source queue, moved out of the cross-queue buffer on the
+     * destination queue once due, and then sent through the
+     * destination port, waiting for retries as needed.
+     */
+    class Channel
+    {
+      public:
+
+        Channel(SyncBridge &_bridge, const std::string &_name,
+                bool _is_request);
+
+        /** Set the event queue the packets are delivered on. */
+        void setEventQueue(EventQueue *eq) { dstEventq = eq; }
+
+        /** Queue a packet on the source side. */
+        void push(PacketPtr pkt);
+
+        /** Try sending the next outbound packet again. */
+        void retry();
+
+        /**
+         * Check a functional access against all packets in flight,
+         * with the destination side not running.
+         */
+        bool checkFunctional(PacketPtr pkt);
+
+        /** Number of packets in flight through this channel. */
+        size_t size() const { return pending; }
+
+        const std::string &name() const { return _name; }
+
+      private:
+
+        /** Move due packets to the outbound queue and send them. */
+        void deliver();
+
+        void trySend();
+
+        SyncBridge &bridge;
+        const std::string _name;
+        const bool isRequest;
+        EventQueue *dstEventq;
+
+        /**
+         * Packets and the tick they are due on the destination side.
+         * Only this buffer is shared by the two threads.
+         */
+        std::mutex mutex;
+        std::deque<std::pair<Tick, PacketPtr>> inFlight;
+
+        /** Due packets, only touched on the destination queue. */
+        std::deque<PacketPtr> outbound;
+        bool waitingRetry;
+
+        /** Packets pushed but not yet sent on, for draining. */
+        std::atomic<size_t> pending;
+    };
+
+    class BridgeSlavePort : public SlavePort
+    {
+      public:
+
+        BridgeSlavePort(const std::string &_name, SyncBridge &_bridge)
+            : SlavePort(_name, &_bridge), bridge(_bridge)
+        { }
+
+      protected:
+
+        bool recvTimingReq(PacketPtr pkt)
+        { return bridge.recvTimingReq(pkt); }
+
+        void recvRespRetry() { bridge.respChannel.retry(); }
+
+        Tick recvAtomic(PacketPtr pkt) { return bridge.recvAtomic(pkt); }
+
+        void recvFunctional(PacketPtr pkt) { bridge.recvFunctional(pkt); }
+
+        AddrRangeList getAddrRanges() const
+        { return bridge.masterPort.getAddrRanges(); }
+
+      private:
+
+        SyncBridge &bridge;
+    };
+
+    class BridgeMasterPort : public MasterPort
+    {
+      public:
+
+        BridgeMasterPort(const std::string &_name, SyncBridge &_bridge)
+            : MasterPort(_name, &_bridge), bridge(_bridge)
+        { }
+
+      protected:
+
+        bool recvTimingResp(PacketPtr pkt)
+        { return bridge.recvTimingResp(pkt); }
+
+        void recvReqRetry() { bridge.reqChannel.retry(); }
+
+        void recvRangeChange() { bridge.slavePort.sendRangeChange(); }
+
+      private:
+
+        SyncBridge &bridge;
+    };
+
+    bool recvTimingReq(PacketPtr pkt);
+    bool recvTimingResp(PacketPtr pkt);
+    Tick recvAtomic(PacketPtr pkt);
+    void recvFunctional(PacketPtr pkt);
+    void functionalAccess(PacketPtr pkt);
+
+    /** Called by the channels whenever they have emptied. */
+    void checkDrained();
+
+    BridgeSlavePort slavePort;
+    BridgeMasterPort masterPort;
+
+    /** Event queue of the master side. */
+    EventQueue *masterEventq;
+
+    /** Latency of a packet across the bridge in either direction. */
+    const Tick delay;
+
+    Channel reqChannel;
+    Channel respChannel;
+
+    /** Inhibited requests that we sink, deleted on the next request. */
+    std::vector<PacketPtr> pendingDelete;
+
+    DrainManager *drainManager;
+    /** Both sides may empty their channel at the same time. */
+    std::mutex drainMutex;
+
+  public:
+
+    SyncBridge(const SyncBridgeParams *p);
+
+    void init();
+
+    unsigned int drain(DrainManager *dm);
+
+    BaseMasterPort& getMasterPort(const std::string& if_name,
+                                  PortID idx = InvalidPortID);
+    BaseSlavePort& getSlavePort(const std::string& if_name,
+                                PortID idx = InvalidPortID);
+};
+
+#endif //__MEM_SYNC_BRIDGE_HH__
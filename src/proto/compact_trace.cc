@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "base/intmath.hh"
+#include "base/misc.hh"
+#include "proto/compact_trace.hh"
+
+using namespace std;
+using namespace CompactTrace;
+
+namespace {
+
+/** Record key bits besides the command. */
+const uint64_t sizeChanged = 0x2;
+const uint64_t flagsChanged = 0x1;
+const int cmdShift = 2;
+
+void
+putVarint(vector<uint8_t>& buf, uint64_t value)
+{
+    while (value >= 0x80) {
+        buf.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    buf.push_back(uint8_t(value));
+}
+
+/** Zigzag encoding of a difference, so that small ones are short. */
+uint64_t
+zigzag(uint64_t delta)
+{
+    return (delta << 1) ^ uint64_t(int64_t(delta) >> 63);
+}
+
+uint64_t
+unzigzag(uint64_t value)
+{
+    return (value >> 1) ^ -(value & 1);
+}
+
+} // anonymous namespace
+
+CompactTraceWriter::CompactTraceWriter(const string& filename,
+                                       uint64_t tick_freq,
+                                       uint32_t block_records)
+    : filename(filename), file(fopen(filename.c_str(), "wb")),
+      blockCount(0), offset(sizeof(Header))
+{
+    if (file == NULL)
+        fatal("Could not open %s for writing\n", filename);
+
+    if (block_records == 0)
+        fatal("Compact trace %s needs packets in a block\n", filename);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(magic));
+    header.tickFreq = tick_freq;
+    header.blockRecords = block_records;
+
+    // leave room for the header, which is only complete at the end
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+        fatal("Could not write compact trace %s\n", filename);
+
+    memset(&prev, 0, sizeof(prev));
+}
+
+CompactTraceWriter::~CompactTraceWriter()
+{
+    if (blockCount)
+        flushBlock();
+
+    header.numBlocks = index.size();
+    header.indexOffset = offset;
+    if ((!index.empty() &&
+         fwrite(&index[0], sizeof(IndexEntry), index.size(), file) !=
+         index.size()) ||
+        fseek(file, 0, SEEK_SET) ||
+        fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fclose(file))
+        fatal("Could not write compact trace %s\n", filename);
+}
+
+void
+CompactTraceWriter::write(const CompactTraceRecord& record)
+{
+    if (blockCount == 0) {
+        IndexEntry entry = { offset, record.tick };
+        index.push_back(entry);
+    }
+
+    uint64_t key = uint64_t(record.cmd) << cmdShift;
+    if (record.size != prev.size)
+        key |= sizeChanged;
+    if (record.flags != prev.flags)
+        key |= flagsChanged;
+
+    putVarint(block, key);
+    putVarint(block, zigzag(record.tick - prev.tick));
+    // sequential packets are common, so the address is relative to
+    // the end of the previous packet
+    putVarint(block, zigzag(record.addr - (prev.addr + prev.size)));
+    if (key & sizeChanged)
+        putVarint(block, record.size);
+    if (key & flagsChanged)
+        putVarint(block, record.flags);
+
+    prev = record;
+    ++header.numRecords;
+    if (++blockCount == header.blockRecords)
+        flushBlock();
+}
+
+void
+CompactTraceWriter::flushBlock()
+{
+    if (fwrite(&block[0], 1, block.size(), file) != block.size())
+        fatal("Could not write compact trace %s\n", filename);
+
+    offset += block.size();
+    block.clear();
+    blockCount = 0;
+    memset(&prev, 0, sizeof(prev));
+}
+
+CompactTraceReader::CompactTraceReader(const string& filename)
+    : filename(filename), data(NULL), bytes(0), header(NULL), index(NULL)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        fatal("Could not open %s for reading\n", filename);
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat))
+        fatal("Could not read %s\n", filename);
+    bytes = file_stat.st_size;
+
+    if (bytes < sizeof(Header))
+        fatal("Compact trace %s is truncated\n", filename);
+
+    void* map = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        fatal("Could not map compact trace %s\n", filename);
+
+    // replay reads the blocks in order, so have the host read ahead
+    madvise(map, bytes, MADV_SEQUENTIAL);
+
+    data = (const uint8_t*)map;
+    header = (const Header*)data;
+    if (memcmp(header->magic, magic, sizeof(magic)))
+        fatal("%s is not a compact trace\n", filename);
+
+    if (header->blockRecords == 0 || header->indexOffset > bytes ||
+        header->numBlocks > (bytes - header->indexOffset) /
+        sizeof(IndexEntry) ||
+        header->numBlocks != divCeil(header->numRecords,
+                                     header->blockRecords))
+        fatal("Compact trace %s is corrupt\n", filename);
+
+    index = (const IndexEntry*)(data + header->indexOffset);
+}
+
+CompactTraceReader::~CompactTraceReader()
+{
+    munmap((void*)data, bytes);
+}
+
+bool
+CompactTraceReader::isCompact(const string& filename)
+{
+    char buf[sizeof(magic)];
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == NULL)
+        return false;
+    bool compact = fread(buf, sizeof(buf), 1, file) == 1 &&
+        memcmp(buf, magic, sizeof(magic)) == 0;
+    fclose(file);
+    return compact;
+}
+
+bool
+CompactTraceReader::readBlock(uint64_t block,
+                              vector<CompactTraceRecord>& records) const
+{
+    assert(block < header->numBlocks);
+
+    const uint8_t* p = data + index[block].offset;
+    const uint8_t* end = data + (block + 1 < header->numBlocks ?
+                                 index[block + 1].offset :
+                                 header->indexOffset);
+    if (p > end || end > data + header->indexOffset)
+        return false;
+
+    uint64_t count = min<uint64_t>(header->blockRecords,
+                                   header->numRecords -
+                                   block * header->blockRecords);
+    records.resize(count);
+
+    // running past the end of the block marks it corrupt, and the
+    // remaining varints read as zero
+    bool corrupt = false;
+    auto get_varint = [&]() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) {
+                corrupt = true;
+                break;
+            }
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        return value;
+    };
+
+    CompactTraceRecord prev;
+    memset(&prev, 0, sizeof(prev));
+    for (auto& r : records) {
+        uint64_t key = get_varint();
+        r.cmd = key >> cmdShift;
+        r.tick = prev.tick + unzigzag(get_varint());
+        r.addr = prev.addr + prev.size + unzigzag(get_varint());
+        r.size = key & sizeChanged ? get_varint() : prev.size;
+        r.flags = key & flagsChanged ? get_varint() : prev.flags;
+        prev = r;
+    }
+    return !corrupt;
+}
+
+uint64_t
+CompactTraceReader::findBlock(Tick tick) const
+{
+    const IndexEntry* last = index + header->numBlocks;
+    const IndexEntry* e =
+        upper_bound(index, last, tick,
+                    [](Tick t, const IndexEntry& entry) {
+                        return t < entry.firstTick;
+                    });
+    return e == index ? 0 : e - index - 1;
+}
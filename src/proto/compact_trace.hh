@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a compact packet trace format, which stores the
+ * ticks and addresses of packets as varint deltas in blocks that are
+ * indexed for seeking.
+ */
+
+#ifndef __PROTO_COMPACT_TRACE_HH__
+#define __PROTO_COMPACT_TRACE_HH__
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "base/types.hh"
+
+/**
+ * A packet in a compact trace, with the same fields as a
+ * ProtoMessage::Packet.
+ */
+struct CompactTraceRecord
+{
+    Tick tick;
+    Addr addr;
+    uint32_t cmd;
+    uint32_t size;
+    uint32_t flags;
+};
+
+/**
+ * Layout of a compact trace: a header, blocks of records, and an
+ * index with an entry per block. Each record is a varint key of the
+ * command and of whether the size and flags change, followed by the
+ * zigzag varint deltas of the tick from the previous packet and of the
+ * address from the end of the previous packet, and then the size and
+ * flags if they changed. Every block starts from a zero tick, address,
+ * size and flags, so that blocks decode independently.
+ */
+namespace CompactTrace {
+
+const char magic[8] = { 'g', '5', 'c', 't', 'r', 'c', '0', '1' };
+
+struct Header
+{
+    char magic[8];
+    uint64_t tickFreq;
+    uint64_t numRecords;
+    uint64_t numBlocks;
+    uint64_t indexOffset;
+    uint32_t blockRecords;
+    uint32_t reserved;
+};
+
+struct IndexEntry
+{
+    /** Offset of the block in the file. */
+    uint64_t offset;
+    /** Tick of the first packet of the block. */
+    uint64_t firstTick;
+};
+
+/** Records per block unless asked otherwise. */
+const uint32_t defaultBlockRecords = 4096;
+
+} // namespace CompactTrace
+
+/**
+ * Write a compact trace. The index and header are written when the
+ * writer is destroyed.
+ */
+class CompactTraceWriter
+{
+  public:
+
+    /**
+     * @param filename Path to the file to create or truncate
+     * @param tick_freq Frequency of the ticks of the packets
+     * @param block_records Packets per block, the unit of seeking
+     */
+    CompactTraceWriter(const std::string& filename, uint64_t tick_freq,
+                       uint32_t block_records =
+                       CompactTrace::defaultBlockRecords);
+
+    ~CompactTraceWriter();
+
+    void write(const CompactTraceRecord& record);
+
+  private:
+
+    /** Write the current block and start a new one. */
+    void flushBlock();
+
+    const std::string filename;
+    FILE* file;
+
+    CompactTrace::Header header;
+    std::vector<CompactTrace::IndexEntry> index;
+
+    /** Encoded records of the current block. */
+    std::vector<uint8_t> block;
+    uint32_t blockCount;
+    uint64_t offset;
+
+    /** Previous packet of the block, which the next is relative to. */
+    CompactTraceRecord prev;
+};
+
+/**
+ * Read a compact trace that is mapped into memory. Blocks decode
+ * independently, and reading does not change the reader, so several
+ * threads can decode blocks at the same time.
+ */
+class CompactTraceReader
+{
+  public:
+
+    /**
+     * Map a compact trace, and check its header and index.
+     *
+     * @param filename Path to the file to read
+     */
+    CompactTraceReader(const std::string& filename);
+
+    ~CompactTraceReader();
+
+    /**
+     * @return True if the file starts like a compact trace
+     */
+    static bool isCompact(const std::string& filename);
+
+    uint64_t tickFrequency() const { return header->tickFreq; }
+    uint64_t numRecords() const { return header->numRecords; }
+    uint64_t numBlocks() const { return header->numBlocks; }
+
+    /**
+     * Decode the packets of a block. A corrupt block is reported
+     * rather than fatal, as readers may decode on a thread of their
+     * own.
+     *
+     * @param block Index of the block
+     * @param records Vector to replace the contents of by the packets
+     * @return False if the block is corrupt
+     */
+    bool readBlock(uint64_t block,
+                   std::vector<CompactTraceRecord>& records) const;
+
+    /**
+     * Find the block to start at to replay from a tick onwards.
+     *
+     * @return The last block starting at or before the tick, or the
+     *         first block if there is none
+     */
+    uint64_t findBlock(Tick tick) const;
+
+  private:
+
+    const std::string filename;
+
+    const uint8_t* data;
+    uint64_t bytes;
+
+    const CompactTrace::Header* header;
+    const CompactTrace::IndexEntry* index;
+};
+
+#endif //__PROTO_COMPACT_TRACE_HH__
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <chrono>
+
+#include "base/intmath.hh"
+#include "proto/packet.pb.h"
+#include "proto/packet_trace_writer.hh"
+
+const size_t PacketTraceWriter::batchRecords;
+
+PacketTraceWriter::PacketTraceWriter(const std::string& filename,
+                                     const std::string& obj_id,
+                                     uint64_t tick_freq, size_t ring_records)
+    : ring(size_t(1) << ceilLog2(std::max(ring_records, batchRecords))),
+      mask(ring.size() - 1), head(0), tailCache(0), stalls(0), tail(0),
+      stopping(false), stream(filename)
+{
+    ProtoMessage::PacketHeader header_msg;
+    header_msg.set_obj_id(obj_id);
+    header_msg.set_tick_freq(tick_freq);
+    stream.write(header_msg);
+
+    writer = std::thread(&PacketTraceWriter::drain, this);
+}
+
+PacketTraceWriter::~PacketTraceWriter()
+{
+    stopping.store(true, std::memory_order_release);
+    wakeup.notify_one();
+    writer.join();
+}
+
+void
+PacketTraceWriter::waitForSpace(uint64_t h)
+{
+    tailCache = tail.load(std::memory_order_acquire);
+    if (h - tailCache < ring.size())
+        return;
+
+    // the writer thread is busy or about to wake up, so spinning
+    // rather than sleeping gets the simulation going sooner
+    ++stalls;
+    wakeup.notify_one();
+    while (h - tailCache == ring.size()) {
+        std::this_thread::yield();
+        tailCache = tail.load(std::memory_order_acquire);
+    }
+}
+
+void
+PacketTraceWriter::drain()
+{
+    ProtoMessage::Packet pkt_msg;
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    while (true) {
+        // stopping is set after the last record is written, so read
+        // it before the head to be sure that the ring is drained
+        bool stop = stopping.load(std::memory_order_acquire);
+        uint64_t h = head.load(std::memory_order_acquire);
+        if (h == t) {
+            if (stop)
+                break;
+            // the simulation does not wake us up for every record,
+            // so sleep for a bit and look again
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait_for(lock, std::chrono::milliseconds(1));
+            continue;
+        }
+
+        uint64_t end = std::min(h, t + batchRecords);
+        for (; t < end; ++t) {
+            const Record& r = ring[t & mask];
+            pkt_msg.set_tick(r.tick);
+            pkt_msg.set_cmd(r.cmd);
+            pkt_msg.set_flags(r.flags);
+            pkt_msg.set_addr(r.addr);
+            pkt_msg.set_size(r.size);
+            stream.write(pkt_msg);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Declaration of a packet trace writer that encodes, compresses and
+ * writes the trace on a thread of its own.
+ */
+
+#ifndef __PROTO_PACKET_TRACE_WRITER_HH__
+#define __PROTO_PACKET_TRACE_WRITER_HH__
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "base/types.hh"
+#include "proto/protoio.hh"
+
+/**
+ * A PacketTraceWriter takes the fields of traced packets as fixed-size
+ * records into a single-producer, single-consumer ring buffer, and a
+ * writer thread drains the ring in batches into a ProtoOutputStream
+ * of ProtoMessage::Packet messages. Encoding and compression thus run
+ * alongside the simulation, which only waits when the ring is full.
+ * The trace is the same as if written directly to the stream.
+ */
+class PacketTraceWriter
+{
+  public:
+
+    /**
+     * Create the output stream, write the packet header to it and
+     * start the writer thread.
+     *
+     * @param filename Path to the trace, compressed if it ends in .gz
+     * @param obj_id Name of the object that captures the trace
+     * @param tick_freq Frequency of the ticks of the packets
+     * @param ring_records Records the ring holds, rounded up to a
+     *                     power of two
+     */
+    PacketTraceWriter(const std::string& filename, const std::string& obj_id,
+                      uint64_t tick_freq, size_t ring_records);
+
+    /**
+     * Write the remaining records, stop the writer thread, and close
+     * the stream.
+     */
+    ~PacketTraceWriter();
+
+    /**
+     * Queue a packet for the trace, waiting for the writer thread if
+     * the ring is full.
+     */
+    void write(Tick tick, uint32_t cmd, uint32_t flags, Addr addr,
+               uint32_t size)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tailCache == ring.size())
+            waitForSpace(h);
+
+        Record& r = ring[h & mask];
+        r.tick = tick;
+        r.addr = addr;
+        r.cmd = cmd;
+        r.flags = flags;
+        r.size = size;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    /** @return Times the simulation waited for a full ring */
+    uint64_t fullStalls() const { return stalls; }
+
+  private:
+
+    /** The fields of a packet in the trace. */
+    struct Record
+    {
+        Tick tick;
+        Addr addr;
+        uint32_t cmd;
+        uint32_t flags;
+        uint32_t size;
+    };
+
+    /** Wait until the writer thread has made room in the ring. */
+    void waitForSpace(uint64_t h);
+
+    /** Main loop of the writer thread. */
+    void drain();
+
+    /** Records that the writer thread takes from the ring at once. */
+    static const size_t batchRecords = 1024;
+
+    std::vector<Record> ring;
+    const uint64_t mask;
+
+    /**
+     * Padding of a cache line on either side of what only one thread
+     * writes, so that the head and the tail never share a line,
+     * whatever the alignment of the writer. Explicit padding rather
+     * than alignas keeps a plain operator new sufficient.
+     */
+    static const size_t lineBytes = 64;
+
+    char padBeforeHead[lineBytes];
+
+    /**
+     * Records written to the ring, with the tail as last seen by the
+     * simulation, to avoid reloading it, and the number of times the
+     * simulation found the ring full. Only the simulation writes
+     * these.
+     */
+    std::atomic<uint64_t> head;
+    uint64_t tailCache;
+    uint64_t stalls;
+
+    char padBeforeTail[lineBytes];
+
+    /** Records taken from the ring, only written by the writer thread. */
+    std::atomic<uint64_t> tail;
+
+    char padAfterTail[lineBytes - sizeof(std::atomic<uint64_t>)];
+
+    /** Set to stop the writer thread once the ring is empty. */
+    std::atomic<bool> stopping;
+
+    /** For the writer thread to sleep on when the ring is empty. */
+    std::mutex mutex;
+    std::condition_variable wakeup;
+
+    ProtoOutputStream stream;
+    std::thread writer;
+};
+
+#endif //__PROTO_PACKET_TRACE_WRITER_HH__
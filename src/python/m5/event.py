@@ -66,4 +66,7 @@ def getEventQueue(index):
 def setEventQueue(eventq):
     internal.event.curEventQueue(eventq)
 
+def setEventQueueBackend(name):
+    internal.event.setEventQueueBackend(name)
+
 __all__ = [ 'create', 'Event', 'ProgressEvent', 'SimExit', 'mainq' ]
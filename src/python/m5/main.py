@@ -82,6 +82,9 @@ def parse_options():
     group("Statistics Options")
     option("--stats-file", metavar="FILE", default="stats.txt",
         help="Sets the output file for statistics [Default: %default]")
+    option("--stats-binary", metavar="FILE", default="",
+        help="Also dump statistics to a binary file that stores changed "
+        "values only")
 
     # Configuration Options
     group("Configuration Options")
@@ -91,6 +94,9 @@ def parse_options():
         help="Create JSON output of the configuration [Default: %default]")
     option("--dot-config", metavar="FILE", default="config.dot",
         help="Create DOT & pdf outputs of the configuration [Default: %default]")
+    option("--eventq-backend", metavar="NAME", default="list",
+        choices=["list", "calendar"],
+        help="Event queue implementation (list, calendar) [Default: %default]")
 
     # Debugging options
     group("Debugging Options")
@@ -191,6 +197,7 @@ def main(*args):
         fatal("Tracing is not enabled.  Compile with TRACING_ON")
 
     # Set the main event queue for the main thread.
+    event.setEventQueueBackend(options.eventq_backend)
     event.mainq = event.getEventQueue(0)
     event.setEventQueue(event.mainq)
 
@@ -313,6 +320,8 @@ def main(*args):
 
     # set stats options
     stats.initText(options.stats_file)
+    if options.stats_binary:
+        stats.initBinary(options.stats_binary)
 
     # set debugging options
     debug.setRemoteGDBPort(options.remote_gdb_port)
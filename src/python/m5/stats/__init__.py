@@ -39,6 +39,13 @@ def initText(filename, desc=True):
     output = internal.stats.initText(filename, desc)
     outputList.append(output)
 
+def initBinary(filename):
+    '''Also dump stats to a columnar binary file, which only stores
+    the values that changed since the previous dump. See
+    binary_reader.py for reading it back.'''
+    output = internal.stats.initBinary(filename)
+    outputList.append(output)
+
 def initSimStats():
     internal.stats.initSimStats()
     internal.stats.registerPythonStatsHandlers()
@@ -0,0 +1,153 @@
+# Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Reader of the columnar binary stats written by Stats::Binary
+# (src/base/stats/binary.hh). It has no dependency on the rest of m5,
+# so it also runs as a stand-alone script:
+#
+#   binary_reader.py stats.bin [stat_name_prefix ...]
+#
+# prints the dumps as CSV, one row per dump.
+
+import struct
+import sys
+
+MAGIC = b'g5stats1'
+
+class Truncated(Exception):
+    '''The file ends in the middle of a record.'''
+    pass
+
+class StatsReader(object):
+    '''Columns and rows of a binary stats file. Rows are dense, i.e.,
+    values unchanged in a dump are carried over from the previous one.'''
+
+    def __init__(self, path):
+        self.names = []
+        self.descs = []
+        self.ticks = []
+        self._changes = []
+        with open(path, 'rb') as f:
+            self._parse(f.read())
+        self.index = dict((n, i) for i, n in enumerate(self.names))
+
+    def _parse(self, data):
+        if data[:len(MAGIC)] != MAGIC:
+            raise ValueError('not a binary stats file')
+        pos = len(MAGIC)
+        double = struct.Struct('<d')
+
+        def varint(pos):
+            shift = value = 0
+            while True:
+                if pos >= len(data):
+                    raise Truncated()
+                b = ord(data[pos:pos + 1])
+                pos += 1
+                value |= (b & 0x7f) << shift
+                if b < 0x80:
+                    return value, pos
+                shift += 7
+
+        def string(pos):
+            n, pos = varint(pos)
+            if pos + n > len(data):
+                raise Truncated()
+            return data[pos:pos + n].decode('utf-8'), pos + n
+
+        # columns of the complete dumps, as the columns of a dump come
+        # right before its row
+        complete = 0
+        while pos < len(data):
+            tag = data[pos:pos + 1]
+            pos += 1
+            try:
+                if tag == b'C':
+                    cid, pos = varint(pos)
+                    name, pos = string(pos)
+                    desc, pos = string(pos)
+                    assert cid == len(self.names)
+                    self.names.append(name)
+                    self.descs.append(desc)
+                elif tag == b'R':
+                    tick, pos = varint(pos)
+                    count, pos = varint(pos)
+                    changes = []
+                    for i in range(count):
+                        cid, pos = varint(pos)
+                        value = double.unpack_from(data, pos)[0]
+                        changes.append((cid, value))
+                        pos += double.size
+                    self.ticks.append(tick)
+                    self._changes.append(changes)
+                    complete = len(self.names)
+                else:
+                    raise ValueError('bad record %r at offset %d' %
+                                     (tag, pos - 1))
+            except (Truncated, struct.error):
+                # the last dump was cut short, e.g. by a crash
+                break
+        del self.names[complete:]
+        del self.descs[complete:]
+
+    def rows(self, names=None):
+        '''Yield (tick, values) for every dump, where values is a list
+        in the order of names, or of all columns by default.'''
+        cols = [self.index[n] for n in names] if names is not None else None
+        values = [0.0] * len(self.names)
+        for tick, changes in zip(self.ticks, self._changes):
+            for cid, value in changes:
+                values[cid] = value
+            if cols is None:
+                yield tick, list(values)
+            else:
+                yield tick, [values[c] for c in cols]
+
+    def column(self, name):
+        '''The values of one column over all dumps.'''
+        return [v[0] for t, v in self.rows([name])]
+
+    def select(self, prefix):
+        '''Names of the columns that start with prefix.'''
+        return [n for n in self.names if n.startswith(prefix)]
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write('usage: %s FILE [PREFIX ...]\n' % argv[0])
+        return 1
+    reader = StatsReader(argv[1])
+    if len(argv) > 2:
+        names = [n for p in argv[2:] for n in reader.select(p)]
+    else:
+        names = reader.names
+    sys.stdout.write(','.join(['tick'] + names) + '\n')
+    for tick, values in reader.rows(names):
+        sys.stdout.write(','.join([str(tick)] + [repr(v) for v in values]) +
+                         '\n')
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -36,6 +36,7 @@
 %include <stdint.i>
 
 %{
+#include "base/stats/binary.hh"
 #include "base/stats/text.hh"
 #include "base/stats/types.hh"
 #include "base/callback.hh"
@@ -136,6 +137,7 @@ template <class T> T cast_info(Info *info);
 
 void initSimStats();
 Output *initText(const std::string &filename, bool desc);
+Output *initBinary(const std::string &filename);
 
 void registerPythonStatsHandlers();
 
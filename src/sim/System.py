@@ -39,6 +39,11 @@ from SimpleMemory import *
 class MemoryMode(Enum): vals = ['invalid', 'atomic', 'timing',
                                 'atomic_noncaching']
 
+# Huge pages for the backing store: transparent ones are only advised,
+# and hugetlb ones are reserved up front, falling back to transparent
+# ones if none are available
+class HugePages(Enum): vals = ['none', 'transparent', 'hugetlb']
+
 class System(MemObject):
     type = 'System'
     cxx_header = "sim/system.hh"
@@ -66,6 +71,28 @@ class System(MemObject):
     mmap_using_noreserve = Param.Bool(False, "mmap the backing store " \
                                           "without reserving swap")
 
+    # The simulated memory is accessed at random across a region that
+    # can be several GB, which thrashes the host TLB with small pages
+    huge_pages = Param.HugePages('none', "Back memory by host huge pages")
+
+    # Checkpointing the backing store compresses and decompresses
+    # independent blocks of it in parallel
+    checkpoint_threads = Param.Unsigned(0, "Threads to (un)serialize " \
+                                            "memory, 0 for one per host core")
+
+    # A raw memory checkpoint is a sparse image of the backing store,
+    # which a restore maps copy-on-write instead of reading, so that
+    # pages are only loaded when the simulation touches them
+    checkpoint_memory_raw = Param.Bool(False, "Checkpoint memory as an " \
+                                           "uncompressed, lazily restored image")
+
+    # Compressed memory checkpoints can be expanded to raw images in a
+    # directory, e.g. /dev/shm, once for all runs that restore them.
+    # The runs then map the images copy-on-write and share the pages
+    # that they do not write through the page cache.
+    memory_image_dir = Param.String("", "Directory of shared memory " \
+                                        "images of restored checkpoints")
+
     # The memory ranges are to be populated when creating the system
     # such that these can be passed from the I/O subsystem through an
     # I/O bridge or cache
@@ -32,6 +32,7 @@
  *          Steve Raasch
  */
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <string>
@@ -42,6 +43,7 @@
 #include "base/trace.hh"
 #include "cpu/smt.hh"
 #include "debug/Config.hh"
+#include "debug/EventQTrace.hh"
 #include "sim/core.hh"
 #include "sim/eventq_impl.hh"
 
@@ -60,6 +62,18 @@ vector<EventQueue *> mainEventQueue;
 __thread EventQueue *_curEventQueue = NULL;
 bool inParallelMode = false;
 
+//! Backend of main event queues that are allocated from now on.
+static EventQueue::Backend mainEventQueueBackend = EventQueue::ListBackend;
+
+//! Smallest number of calendar buckets.
+static const size_t calMinBuckets = 16;
+//! Bucket width until there are enough bins to estimate it.
+static const Tick calInitialWidth = 1000;
+//! Number of earliest bins whose spacing determines the bucket width.
+static const size_t calWidthSamples = 25;
+//! Longest walk along a bucket before the width is re-estimated.
+static const size_t calMaxWalk = 64;
+
 EventQueue *
 getEventQueue(uint32_t index)
 {
@@ -67,11 +81,26 @@ getEventQueue(uint32_t index)
         numMainEventQueues++;
         mainEventQueue.push_back(
             new EventQueue(csprintf("MainEventQueue-%d", index)));
+        mainEventQueue.back()->setBackend(mainEventQueueBackend);
     }
 
     return mainEventQueue[index];
 }
 
+void
+setEventQueueBackend(const string &name)
+{
+    if (name == "list")
+        mainEventQueueBackend = EventQueue::ListBackend;
+    else if (name == "calendar")
+        mainEventQueueBackend = EventQueue::CalendarBackend;
+    else
+        fatal("Unknown event queue backend '%s'\n", name);
+
+    for (uint32_t i = 0; i < numMainEventQueues; ++i)
+        mainEventQueue[i]->setBackend(mainEventQueueBackend);
+}
+
 #ifndef NDEBUG
 Counter Event::instanceCounter = 0;
 #endif
@@ -117,6 +146,14 @@ Event::insertBefore(Event *event, Event *curr)
 void
 EventQueue::insert(Event *event)
 {
+    DPRINTFR(EventQTrace, "%s i %#x %d %d\n", objName, (uintptr_t)event,
+             event->when(), (int)event->priority());
+
+    if (backend == CalendarBackend) {
+        calInsert(event);
+        return;
+    }
+
     // Deal with the head case
     if (!head || *event <= *head) {
         head = Event::insertBefore(event, head);
@@ -176,6 +213,13 @@ EventQueue::remove(Event *event)
 
     assert(event->queue == this);
 
+    DPRINTFR(EventQTrace, "%s r %#x\n", objName, (uintptr_t)event);
+
+    if (backend == CalendarBackend) {
+        calRemove(event);
+        return;
+    }
+
     // deal with an event on the head's 'in bin' list (event has the same
     // time as the head)
     if (*head == *event) {
@@ -200,6 +244,206 @@ EventQueue::remove(Event *event)
     prev->nextBin = Event::removeItem(event, curr);
 }
 
+void
+EventQueue::calInsert(Event *event)
+{
+    // Find the bin of the event in its bucket, exactly as insert()
+    // does on the single list
+    Event **link = &calBuckets[calBucket(event->when())];
+    size_t walk = 0;
+    while (*link && **link < *event) {
+        link = &(*link)->nextBin;
+        ++walk;
+    }
+
+    Event *curr = *link;
+    bool new_bin = !curr || *event < *curr;
+    *link = Event::insertBefore(event, curr);
+
+    if (!new_bin) {
+        if (curr == head)
+            head = event;
+    } else {
+        ++calBins;
+        if (!head || *event < *head)
+            head = event;
+    }
+
+    ++calOps;
+    if (calBins > 2 * calBuckets.size())
+        calRebuild(2 * calBuckets.size());
+    else if (walk > calMaxWalk && calOps > calBins)
+        calRebuild(calBuckets.size());
+}
+
+void
+EventQueue::calRemove(Event *event)
+{
+    Event **link = &calBuckets[calBucket(event->when())];
+    while (*link && **link < *event)
+        link = &(*link)->nextBin;
+
+    Event *top = *link;
+    if (!top || *top != *event)
+        panic("event not found!");
+
+    bool last_in_bin = (event == top && !top->nextInBin);
+    *link = Event::removeItem(event, top);
+
+    if (!last_in_bin) {
+        if (top == head)
+            head = *link;
+        ++calOps;
+        return;
+    }
+
+    if (top == head) {
+        // the head's bucket has already been updated above
+        calPopHeadBin();
+        return;
+    }
+
+    --calBins;
+    ++calOps;
+    if (calBuckets.size() > calMinBuckets && calBins < calBuckets.size() / 2)
+        calRebuild(calBuckets.size() / 2);
+}
+
+void
+EventQueue::calPopHeadBin()
+{
+    assert(calBins > 0);
+    --calBins;
+    ++calOps;
+
+    if (calBuckets.size() > calMinBuckets &&
+        calBins < calBuckets.size() / 2) {
+        // the rebuild also finds the new head
+        head = NULL;
+        calRebuild(calBuckets.size() / 2);
+    } else {
+        head = calFindMin(head->when());
+    }
+}
+
+Event *
+EventQueue::calFindMin(Tick from) const
+{
+    if (!calBins)
+        return NULL;
+
+    // Scan one year of days starting with the one holding 'from'. The
+    // first bin of a bucket that falls on the day being scanned is
+    // the earliest bin of that day, and no earlier day has any bins.
+    const size_t buckets = calBuckets.size();
+    Tick day = from / calWidth;
+    for (size_t i = 0; i < buckets; ++i, ++day) {
+        Event *top = calBuckets[day & (buckets - 1)];
+        if (top && top->when() / calWidth == day)
+            return top;
+    }
+
+    // Nothing within a year, fall back to a direct search
+    Event *min = NULL;
+    for (size_t i = 0; i < buckets; ++i) {
+        Event *top = calBuckets[i];
+        if (top && (!min || *top < *min))
+            min = top;
+    }
+    return min;
+}
+
+void
+EventQueue::calRebuild(size_t buckets)
+{
+    vector<Event *> bins;
+    collectBins(bins);
+    relinkBins(bins, buckets);
+}
+
+void
+EventQueue::collectBins(vector<Event *> &bins) const
+{
+    bins.clear();
+    if (backend == CalendarBackend) {
+        bins.reserve(calBins);
+        for (size_t i = 0; i < calBuckets.size(); ++i)
+            for (Event *top = calBuckets[i]; top; top = top->nextBin)
+                bins.push_back(top);
+        sort(bins.begin(), bins.end(),
+             [](const Event *l, const Event *r) { return *l < *r; });
+    } else {
+        for (Event *top = head; top; top = top->nextBin)
+            bins.push_back(top);
+    }
+}
+
+void
+EventQueue::relinkBins(const vector<Event *> &bins, size_t buckets)
+{
+    head = NULL;
+    calBuckets.clear();
+    calBins = 0;
+    calOps = 0;
+
+    if (backend == ListBackend) {
+        for (size_t i = bins.size(); i-- > 0; ) {
+            bins[i]->nextBin = head;
+            head = bins[i];
+        }
+        return;
+    }
+
+    // Brown's estimate: three times the average spacing of the
+    // earliest bins, ignoring gaps of more than twice the average
+    size_t samples = min(bins.size(), calWidthSamples);
+    if (samples > 1) {
+        Tick span = bins[samples - 1]->when() - bins[0]->when();
+        Tick avg = span / (samples - 1);
+        Tick sum = 0;
+        size_t gaps = 0;
+        for (size_t i = 1; i < samples; ++i) {
+            Tick gap = bins[i]->when() - bins[i - 1]->when();
+            if (gap <= 2 * avg) {
+                sum += gap;
+                ++gaps;
+            }
+        }
+        calWidth = gaps ? max(Tick(1), 3 * sum / gaps) : calInitialWidth;
+    }
+
+    buckets = max(buckets, calMinBuckets);
+    while (2 * buckets < bins.size())
+        buckets *= 2;
+    calBuckets.assign(buckets, NULL);
+
+    // Bins come in service order, so appending keeps each bucket sorted
+    vector<Event **> tails(calBuckets.size());
+    for (size_t i = 0; i < calBuckets.size(); ++i)
+        tails[i] = &calBuckets[i];
+    for (size_t i = 0; i < bins.size(); ++i) {
+        size_t bucket = calBucket(bins[i]->when());
+        bins[i]->nextBin = NULL;
+        *tails[bucket] = bins[i];
+        tails[bucket] = &bins[i]->nextBin;
+    }
+
+    calBins = bins.size();
+    head = bins.empty() ? NULL : bins[0];
+}
+
+void
+EventQueue::setBackend(Backend b)
+{
+    if (b == backend && (b == ListBackend || !calBuckets.empty()))
+        return;
+
+    vector<Event *> bins;
+    collectBins(bins);
+    backend = b;
+    relinkBins(bins, calMinBuckets);
+}
+
 Event *
 EventQueue::serviceOne()
 {
@@ -208,7 +452,17 @@ EventQueue::serviceOne()
     Event *next = head->nextInBin;
     event->flags.clear(Event::Scheduled);
 
-    if (next) {
+    DPRINTFR(EventQTrace, "%s p %#x\n", objName, (uintptr_t)event);
+
+    if (backend == CalendarBackend) {
+        calBuckets[calBucket(head->when())] = next ? next : head->nextBin;
+        if (next) {
+            next->nextBin = head->nextBin;
+            head = next;
+        } else {
+            calPopHeadBin();
+        }
+    } else if (next) {
         // update the next bin pointer since it could be stale
         next->nextBin = head->nextBin;
 
@@ -295,8 +549,9 @@ EventQueue::serialize(ostream &os)
     std::list<Event *> eventPtrs;
 
     int numEvents = 0;
-    Event *nextBin = head;
-    while (nextBin) {
+    vector<Event *> bins;
+    collectBins(bins);
+    for (auto nextBin : bins) {
         Event *nextInBin = nextBin;
 
         while (nextInBin) {
@@ -307,8 +562,6 @@ EventQueue::serialize(ostream &os)
             }
             nextInBin = nextInBin->nextInBin;
         }
-
-        nextBin = nextBin->nextBin;
     }
 
     SERIALIZE_SCALAR(numEvents);
@@ -346,15 +599,14 @@ EventQueue::dump() const
     if (empty())
         cprintf("<No Events>\n");
     else {
-        Event *nextBin = head;
-        while (nextBin) {
+        vector<Event *> bins;
+        collectBins(bins);
+        for (auto nextBin : bins) {
             Event *nextInBin = nextBin;
             while (nextInBin) {
                 nextInBin->dump();
                 nextInBin = nextInBin->nextInBin;
             }
-
-            nextBin = nextBin->nextBin;
         }
     }
 
@@ -369,8 +621,15 @@ EventQueue::debugVerify() const
     Tick time = 0;
     short priority = 0;
 
-    Event *nextBin = head;
-    while (nextBin) {
+    vector<Event *> bins;
+    collectBins(bins);
+    if (!bins.empty() && bins[0] != head) {
+        cprintf("head is not the earliest bin!");
+        head->dump();
+        return false;
+    }
+
+    for (auto nextBin : bins) {
         Event *nextInBin = nextBin;
         while (nextInBin) {
             if (nextInBin->when() < time) {
@@ -396,8 +655,6 @@ EventQueue::debugVerify() const
 
             nextInBin = nextInBin->nextInBin;
         }
-
-        nextBin = nextBin->nextBin;
     }
 
     return true;
@@ -406,6 +663,23 @@ EventQueue::debugVerify() const
 Event*
 EventQueue::replaceHead(Event* s)
 {
+    if (backend == CalendarBackend) {
+        // Hand out and take in the bins as a sorted list, the way the
+        // list backend keeps them
+        vector<Event *> old_bins, new_bins;
+        collectBins(old_bins);
+        for (Event *top = s; top; top = top->nextBin)
+            new_bins.push_back(top);
+        relinkBins(new_bins, calMinBuckets);
+
+        Event *t = NULL;
+        for (size_t i = old_bins.size(); i-- > 0; ) {
+            old_bins[i]->nextBin = t;
+            t = old_bins[i];
+        }
+        return t;
+    }
+
     Event* t = head;
     head = s;
     return t;
@@ -460,7 +734,8 @@ Event::dump() const
 }
 
 EventQueue::EventQueue(const string &n)
-    : objName(n), head(NULL), _curTick(0)
+    : objName(n), head(NULL), _curTick(0), backend(ListBackend),
+      calWidth(calInitialWidth), calBins(0), calOps(0)
 {
 }
 
@@ -45,6 +45,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "base/flags.hh"
 #include "base/misc.hh"
@@ -443,11 +444,60 @@ operator!=(const Event &l, const Event &r)
  */
 class EventQueue : public Serializable
 {
+  public:
+    /**
+     * Implementations of the ordered set of bins. ListBackend keeps
+     * the bins on a single sorted list through nextBin, which makes
+     * insertion linear in the number of pending bins. CalendarBackend
+     * spreads them over the buckets of a calendar queue (R. Brown,
+     * CACM 1988) for constant expected time insertion and removal.
+     * Both service events in exactly the same order.
+     */
+    enum Backend {
+        ListBackend,
+        CalendarBackend
+    };
+
   private:
     std::string objName;
     Event *head;
     Tick _curTick;
 
+    Backend backend;
+
+    /**
+     * Calendar buckets, each a sorted list of bins through nextBin.
+     * A bin goes to bucket (when / calWidth) mod calBuckets.size();
+     * head still points to the earliest bin, which is always the
+     * first one of its bucket.
+     */
+    std::vector<Event *> calBuckets;
+    //! Width in ticks of a calendar bucket ("day").
+    Tick calWidth;
+    //! Number of bins on the calendar.
+    size_t calBins;
+    //! Inserts and removals since the calendar was last rebuilt.
+    size_t calOps;
+
+    size_t calBucket(Tick when) const
+    { return (when / calWidth) & (calBuckets.size() - 1); }
+
+    //! Calendar counterparts of insert() and remove().
+    void calInsert(Event *event);
+    void calRemove(Event *event);
+    //! Drop the head bin after its last event was removed.
+    void calPopHeadBin();
+    //! Find the earliest bin, all bins being at or after 'from'.
+    Event *calFindMin(Tick from) const;
+    //! Redistribute the bins over 'buckets' buckets and re-estimate
+    //! the bucket width.
+    void calRebuild(size_t buckets);
+
+    //! Collect the top event of all bins in service order.
+    void collectBins(std::vector<Event *> &bins) const;
+    //! Relink the given bins, in service order, for the current backend.
+    void relinkBins(const std::vector<Event *> &bins, size_t buckets);
+
     //! Mutex to protect async queue.
     std::mutex async_queue_mutex;
 
@@ -574,6 +624,10 @@ class EventQueue : public Serializable
 
     Event *serviceOne();
 
+    //! Switch the bin implementation, keeping all scheduled events.
+    void setBackend(Backend b);
+    Backend getBackend() const { return backend; }
+
     // process all events up to the given timestamp.  we inline a
     // quick test to see if there are any events to process; if so,
     // call the internal out-of-line version to process them all.
@@ -656,6 +710,10 @@ class EventQueue : public Serializable
 
 void dumpMainQueue();
 
+//! Select the backend ("list" or "calendar") of all main event
+//! queues, including the ones that are allocated later on.
+void setEventQueueBackend(const std::string &name);
+
 #ifndef SWIG
 class EventManager
 {
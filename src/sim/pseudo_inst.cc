@@ -54,6 +54,7 @@
 #include "arch/vtophys.hh"
 #include "arch/pseudo_inst.hh"
 #include "base/debug.hh"
+#include "base/intmath.hh"
 #include "base/output.hh"
 #include "config/the_isa.hh"
 #include "cpu/base.hh"
@@ -192,10 +193,18 @@ pseudoInst(ThreadContext *tc, uint8_t func, uint8_t subfunc)
         workend(tc, args[0], args[1]);
         break;
 
+      case 0x56: // epoch_func
+        m5epoch(tc);
+        break;
+
+      case 0x57: // lastepoch_func
+        return lastepoch(tc);
+
+      case 0x58: // persisthint_func
+        persisthint(tc, args[0], args[1], args[2]);
+        break;
+
       case 0x55: // annotate_func
-      case 0x56: // reserved2_func
-      case 0x57: // reserved3_func
-      case 0x58: // reserved4_func
       case 0x59: // reserved5_func
         warn("Unimplemented m5 op (0x%x)\n", func);
         break;
@@ -717,4 +726,49 @@ workend(ThreadContext *tc, uint64_t workid, uint64_t threadid)
     }
 }
 
+//
+// The epoch ops let software direct a memory controller that keeps
+// memory crash consistent by epochs, such as the hybrid one of ThyNVM,
+// through the system it registers with.
+//
+void
+m5epoch(ThreadContext *tc)
+{
+    DPRINTF(PseudoInst, "PseudoInst::m5epoch()\n");
+    tc->getSystemPtr()->forceEpoch();
+}
+
+uint64_t
+lastepoch(ThreadContext *tc)
+{
+    DPRINTF(PseudoInst, "PseudoInst::lastepoch()\n");
+    return tc->getSystemPtr()->lastCommittedEpoch();
+}
+
+void
+persisthint(ThreadContext *tc, Addr vaddr, uint64_t len, uint64_t hint)
+{
+    DPRINTF(PseudoInst, "PseudoInst::persisthint(%#x, %i, %i)\n",
+            vaddr, len, hint);
+    if (hint > System::PersistCritical) {
+        warn("Ignoring unknown persistence hint %d\n", hint);
+        return;
+    }
+
+    System *sys = tc->getSystemPtr();
+    Addr page_bytes = sys->getPageBytes();
+    Addr start, end;
+    sys->persistHintPages(vaddr, len, (System::PersistHint)hint, start, end);
+    for (Addr page = start; page < end; page += page_bytes) {
+        Addr paddr;
+        if (FullSystem) {
+            paddr = vtophys(tc, page);
+        } else if (!tc->getProcessPtr()->pTable->translate(page, paddr)) {
+            DPRINTF(PseudoInst, "Unmapped page %#x gets no hint\n", page);
+            continue;
+        }
+        sys->setPersistHint(paddr, (System::PersistHint)hint);
+    }
+}
+
 } // namespace PseudoInst
@@ -88,6 +88,9 @@ void debugbreak(ThreadContext *tc);
 void switchcpu(ThreadContext *tc);
 void workbegin(ThreadContext *tc, uint64_t workid, uint64_t threadid);
 void workend(ThreadContext *tc, uint64_t workid, uint64_t threadid);
+void m5epoch(ThreadContext *tc);
+uint64_t lastepoch(ThreadContext *tc);
+void persisthint(ThreadContext *tc, Addr vaddr, uint64_t len, uint64_t hint);
 
 } // namespace PseudoInst
 
@@ -52,8 +52,10 @@
 
 #include "base/callback.hh"
 #include "base/hostinfo.hh"
+#include "base/pool_alloc.hh"
 #include "base/statistics.hh"
 #include "base/time.hh"
+#include "config/use_pool_alloc.hh"
 #include "cpu/base.hh"
 #include "sim/global_event.hh"
 #include "sim/stat_control.hh"
@@ -112,6 +114,10 @@ struct Global
     Stats::Formula hostTickRate;
     Stats::Value hostMemory;
     Stats::Value hostSeconds;
+#if USE_POOL_ALLOC
+    Stats::Value hostPoolHits;
+    Stats::Value hostPoolMisses;
+#endif
 
     Stats::Value simInsts;
     Stats::Value simOps;
@@ -195,6 +201,22 @@ Global::Global()
         .precision(0)
         ;
 
+#if USE_POOL_ALLOC
+    hostPoolHits
+        .functor(PoolAllocator::totalHits)
+        .name("host_pool_hits")
+        .desc("Number of pooled allocations that recycled an object")
+        .precision(0)
+        ;
+
+    hostPoolMisses
+        .functor(PoolAllocator::totalMisses)
+        .name("host_pool_misses")
+        .desc("Number of pooled allocations that took a new object")
+        .precision(0)
+        ;
+#endif
+
     simSeconds = simTicks / simFreq;
     hostInstRate = simInsts / hostSeconds;
     hostOpRate = simOps / hostSeconds;
@@ -47,6 +47,7 @@
 
 #include "arch/remote_gdb.hh"
 #include "arch/utility.hh"
+#include "base/intmath.hh"
 #include "base/loader/object_file.hh"
 #include "base/loader/symtab.hh"
 #include "base/str.hh"
@@ -88,12 +89,15 @@ System::System(Params *p)
       loadAddrMask(p->load_addr_mask),
       loadAddrOffset(p->load_offset),
       nextPID(0),
-      physmem(name() + ".physmem", p->memories, p->mmap_using_noreserve),
+      physmem(name() + ".physmem", p->memories, p->mmap_using_noreserve,
+              p->checkpoint_threads, p->checkpoint_memory_raw,
+              p->memory_image_dir, p->huge_pages),
       memoryMode(p->mem_mode),
       _cacheLineSize(p->cache_line_size),
       workItemsBegin(0),
       workItemsEnd(0),
       numWorkIds(p->num_work_ids),
+      persistController(NULL),
       _params(p),
       totalNumInsts(0),
       instEventQueue("system instruction-based event queue")
@@ -378,6 +382,16 @@ System::serialize(ostream &os)
     SERIALIZE_SCALAR(nextPID);
     serializeSymtab(os);
 
+    vector<Addr> persist_pages;
+    vector<int> persist_hints;
+    for (map<Addr, PersistHint>::const_iterator i = persistHints.begin();
+         i != persistHints.end(); ++i) {
+        persist_pages.push_back(i->first);
+        persist_hints.push_back(i->second);
+    }
+    arrayParamOut(os, "persist_pages", persist_pages);
+    arrayParamOut(os, "persist_hints", persist_hints);
+
     // also serialize the memories in the system
     nameOut(os, csprintf("%s.physmem", name()));
     physmem.serialize(os);
@@ -393,6 +407,20 @@ System::unserialize(Checkpoint *cp, const string &section)
     UNSERIALIZE_SCALAR(nextPID);
     unserializeSymtab(cp, section);
 
+    // checkpoints from before the persistence hints have none
+    string str;
+    if (cp->find(section, "persist_pages", str)) {
+        vector<Addr> persist_pages;
+        vector<int> persist_hints;
+        arrayParamIn(cp, section, "persist_pages", persist_pages);
+        arrayParamIn(cp, section, "persist_hints", persist_hints);
+        if (persist_pages.size() != persist_hints.size())
+            fatal("Mismatched persistence hints in %s\n", section);
+        for (int i = 0; i < persist_pages.size(); ++i) {
+            setPersistHint(persist_pages[i], (PersistHint)persist_hints[i]);
+        }
+    }
+
     // also unserialize the memories in the system
     physmem.unserialize(cp, csprintf("%s.physmem", name()));
 }
@@ -409,6 +437,13 @@ System::regStats()
                          .desc("Run time stat for" + namestr.str())
                          .prereq(*workItemStats[j]);
     }
+
+    hugePageBytes
+        .method(&physmem, &PhysicalMemory::hugePageBytes)
+        .name(name() + ".huge_page_bytes")
+        .desc("Bytes of memory backed by host huge pages")
+        .prereq(hugePageBytes)
+        ;
 }
 
 void
@@ -428,6 +463,71 @@ System::workItemEnd(uint32_t tid, uint32_t workid)
     lastWorkItemStarted.erase(p);
 }
 
+void
+System::registerPersistController(PersistController *ctrl)
+{
+    if (persistController)
+        fatal("%s already has a persistent memory controller\n", name());
+    persistController = ctrl;
+
+    for (map<Addr, PersistHint>::const_iterator i = persistHints.begin();
+         i != persistHints.end(); ++i) {
+        persistController->persistHint(i->first, i->second);
+    }
+}
+
+void
+System::forceEpoch()
+{
+    if (!persistController) {
+        warn_once("%s has no persistent memory controller to end an "
+                  "epoch\n", name());
+        return;
+    }
+    persistController->forceEpoch();
+}
+
+uint64_t
+System::lastCommittedEpoch() const
+{
+    return persistController ? persistController->lastCommittedEpoch() : 0;
+}
+
+void
+System::setPersistHint(Addr paddr, PersistHint hint)
+{
+    Addr page_addr = roundDown(paddr, getPageBytes());
+    if (hint == PersistDefault)
+        persistHints.erase(page_addr);
+    else
+        persistHints[page_addr] = hint;
+
+    if (persistController)
+        persistController->persistHint(page_addr, hint);
+}
+
+System::PersistHint
+System::getPersistHint(Addr paddr) const
+{
+    map<Addr, PersistHint>::const_iterator i =
+        persistHints.find(roundDown(paddr, getPageBytes()));
+    return i == persistHints.end() ? PersistDefault : i->second;
+}
+
+void
+System::persistHintPages(Addr addr, uint64_t len, PersistHint hint,
+                         Addr &start, Addr &end) const
+{
+    Addr page_bytes = getPageBytes();
+    if (hint == PersistVolatile) {
+        start = roundUp(addr, page_bytes);
+        end = max(start, roundDown(addr + len, page_bytes));
+    } else {
+        start = roundDown(addr, page_bytes);
+        end = roundUp(addr + len, page_bytes);
+    }
+}
+
 void
 System::printSystems()
 {
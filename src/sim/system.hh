@@ -47,6 +47,7 @@
 #ifndef __SYSTEM_HH__
 #define __SYSTEM_HH__
 
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -381,6 +382,78 @@ class System : public MemObject
 
     void workItemEnd(uint32_t tid, uint32_t workid);
 
+    /**
+     * Persistence that software asks for a page of physical memory,
+     * through the m5 persist_hint op.
+     */
+    enum PersistHint {
+        /** Checkpointed as the memory controller sees fit */
+        PersistDefault,
+        /** Never checkpointed, e.g., a scratch buffer */
+        PersistVolatile,
+        /** Always checkpointed by writing back the whole page */
+        PersistCritical
+    };
+
+    /**
+     * Interface of a memory controller that keeps memory crash
+     * consistent by epochs, e.g., the hybrid DRAM/NVM controller of
+     * ThyNVM. Software-directed epochs and persistence hints reach
+     * the controller through the system it registers with.
+     */
+    class PersistController
+    {
+      public:
+        virtual ~PersistController() { }
+
+        /** End the running epoch at the earliest opportunity */
+        virtual void forceEpoch() = 0;
+
+        /** Get the last epoch whose checkpoint has completed */
+        virtual uint64_t lastCommittedEpoch() const = 0;
+
+        /** Take a hint on the persistence of a page */
+        virtual void persistHint(Addr page_addr, PersistHint hint) = 0;
+    };
+
+    /**
+     * Register the controller that the epoch ops and persistence
+     * hints go to. Hints given before it registers are passed on.
+     */
+    void registerPersistController(PersistController *ctrl);
+
+    /** Called by pseudo_inst to end the running epoch */
+    void forceEpoch();
+
+    /**
+     * Called by pseudo_inst to get the last committed epoch, which is
+     * 0 when there is no controller or no epoch has committed yet.
+     */
+    uint64_t lastCommittedEpoch() const;
+
+    /** Set the persistence hint of the page of a physical address */
+    void setPersistHint(Addr paddr, PersistHint hint);
+
+    /** Get the persistence hint of the page of a physical address */
+    PersistHint getPersistHint(Addr paddr) const;
+
+    /**
+     * Get the pages [start, end) that a hint on the range [addr, addr +
+     * len) applies to. Only the pages wholly in the range become
+     * volatile, so that no data outside it loses its persistence,
+     * while the other hints apply to every page the range touches.
+     */
+    void persistHintPages(Addr addr, uint64_t len, PersistHint hint,
+                          Addr &start, Addr &end) const;
+
+  protected:
+    PersistController *persistController;
+
+    /** Pages with other than the default hint, by page address */
+    std::map<Addr, PersistHint> persistHints;
+
+  public:
+
     /**
      * Fix up an address used to match PCs for hooking simulator
      * events on to target function executions.  See comment in
@@ -528,6 +601,7 @@ class System : public MemObject
     EventQueue instEventQueue;
     std::map<std::pair<uint32_t,uint32_t>, Tick>  lastWorkItemStarted;
     std::map<uint32_t, Stats::Histogram*> workItemStats;
+    Stats::Value hugePageBytes;
 
     ////////////////////////////////////////////
     //
@@ -64,7 +64,7 @@ AddrTransTable::insert(Tag phy_tag, Addr hw_addr, ATTEntry::State state,
     entries[i].hw_addr = hw_addr;
 
     tagIndex[phy_tag] = i;
-    profiler.addTableOp();
+    profiler.addTableUpdate();
     return i;
 }
 
@@ -80,7 +80,7 @@ AddrTransTable::shiftState(int index, ATTEntry::State new_state,
     queues[entry.state].remove(index);
     queues[new_state].pushBack(index);
     entries[index].state = new_state;
-    profiler.addTableOp();
+    profiler.addTableUpdate();
 }
 
 void
@@ -99,5 +99,5 @@ AddrTransTable::clearStats(Profiler& profiler)
         it->epoch_reads = 0;
         it->epoch_writes = 0;
     }
-    profiler.addTableOp(); // assumed in parallel
+    profiler.addTableUpdate(); // assumed in parallel
 }
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "energy_model.hh"
+
+using namespace std;
+using namespace thynvm;
+
+EnergyModel::Energy
+EnergyModel::energy(const Profiler& profiler) const
+{
+    Energy e;
+    e.component[DRAM_READ] =
+        profiler.arrayReadBytes(Profiler::DRAM) * 8 * params.dram_read;
+    e.component[DRAM_WRITE] =
+        profiler.arrayWriteBytes(Profiler::DRAM) * 8 * params.dram_write;
+    e.component[NVM_READ] =
+        profiler.arrayReadBytes(Profiler::NVM) * 8 * params.nvm_read;
+    e.component[NVM_WRITE] =
+        profiler.arrayWriteBytes(Profiler::NVM) * 8 * params.nvm_write;
+    e.component[TABLE_LOOKUP] = (profiler.tableOps() -
+        profiler.tableUpdates()) * params.table_lookup;
+    e.component[TABLE_UPDATE] = profiler.tableUpdates() * params.table_update;
+    e.component[BUFFER] = profiler.bufferOps() * params.buffer_op;
+    return e;
+}
+
+void
+EnergyModel::add(uint32_t epoch, Phase phase, const Profiler& profiler)
+{
+    assert(phase < NUM_PHASES);
+    Energy e = energy(profiler);
+    EpochEnergy& epoch_energy = pending[epoch];
+    epoch_energy.epoch = epoch;
+    epoch_energy.phase[phase] += e;
+    totals[phase] += e;
+}
+
+EnergyModel::EpochEnergy
+EnergyModel::commit(uint32_t epoch)
+{
+    map<uint32_t, EpochEnergy>::iterator it = pending.find(epoch);
+    if (it == pending.end()) {
+        EpochEnergy idle;
+        idle.epoch = epoch;
+        committed.push_back(idle);
+    } else {
+        committed.push_back(it->second);
+        pending.erase(it);
+    }
+    committed_energy += committed.back().total();
+    return committed.back();
+}
+
+void
+EnergyModel::dump(ostream& os) const
+{
+    os << "epoch,total_pj";
+    for (int p = 0; p < NUM_PHASES; ++p) {
+        os << ',' << name(Phase(p)) << "_pj";
+        for (int c = 0; c < NUM_COMPONENTS; ++c) {
+            os << ',' << name(Phase(p)) << '_' << name(Component(c)) << "_pj";
+        }
+    }
+    os << '\n';
+
+    // the energy of long runs is too large for the default six digits
+    streamsize precision = os.precision(15);
+    for (vector<EpochEnergy>::const_iterator it = committed.begin();
+            it != committed.end(); ++it) {
+        os << it->epoch << ',' << it->total();
+        for (int p = 0; p < NUM_PHASES; ++p) {
+            os << ',' << it->phase[p].total();
+            for (int c = 0; c < NUM_COMPONENTS; ++c) {
+                os << ',' << it->phase[p].component[c];
+            }
+        }
+        os << '\n';
+    }
+    os.precision(precision);
+}
+
+const char*
+EnergyModel::name(Phase phase)
+{
+    static const char* names[NUM_PHASES] = { "demand", "checkpoint" };
+    assert(phase < NUM_PHASES);
+    return names[phase];
+}
+
+const char*
+EnergyModel::name(Component component)
+{
+    static const char* names[NUM_COMPONENTS] = { "dram_read", "dram_write",
+        "nvm_read", "nvm_write", "table_lookup", "table_update", "buffer" };
+    assert(component < NUM_COMPONENTS);
+    return names[component];
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __THYNVM_ENERGY_MODEL_HH__
+#define __THYNVM_ENERGY_MODEL_HH__
+
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+#include "profiler.hh"
+
+namespace thynvm {
+
+/**
+ * Energy of the controller, computed from the operations that the
+ * Profiler counts: bytes read from and written to the DRAM and NVM
+ * arrays, lookups and updates of the address translation tables, and
+ * operations of the VersionBuffer. The DRAM command energy of
+ * DRAMPower does not apply to the NVM, which only borrows the DDR3
+ * currents, nor does it cover the tables, hence a model per
+ * operation.
+ *
+ * The energy is accounted per epoch, and within an epoch split between
+ * serving demand requests and checkpointing. Since the checkpoint of
+ * an epoch overlaps the execution of the next one, the controller
+ * names the epoch of each profiler it adds, and the epoch is closed
+ * once its checkpoint commits.
+ */
+class EnergyModel
+{
+  public:
+    enum Phase
+    {
+        DEMAND = 0,
+        CHECKPOINT,
+        NUM_PHASES,
+    };
+
+    enum Component
+    {
+        DRAM_READ = 0,
+        DRAM_WRITE,
+        NVM_READ,
+        NVM_WRITE,
+        TABLE_LOOKUP,
+        TABLE_UPDATE,
+        BUFFER,
+        NUM_COMPONENTS,
+    };
+
+    /**
+     * Energy per operation in pJ. The array energy is per bit, and
+     * defaults to the DRAM and PCM figures of Lee et al., "Architecting
+     * phase change memory as a scalable DRAM alternative", ISCA 2009.
+     * The table and buffer energy is per access, and defaults to rough
+     * figures for a 32KB SRAM at 32nm that are to be set from CACTI for
+     * the actual geometry.
+     */
+    struct Params
+    {
+        double dram_read;
+        double dram_write;
+        double nvm_read;
+        double nvm_write;
+        double table_lookup;
+        double table_update;
+        double buffer_op;
+
+        Params() : dram_read(1.17), dram_write(0.39), nvm_read(2.47),
+                nvm_write(16.82), table_lookup(10), table_update(12),
+                buffer_op(5) { }
+    };
+
+    /**
+     * Energy in pJ per component.
+     */
+    struct Energy
+    {
+        double component[NUM_COMPONENTS];
+
+        Energy();
+        double total() const;
+        Energy& operator+=(const Energy& e);
+    };
+
+    struct EpochEnergy
+    {
+        uint32_t epoch;
+        Energy phase[NUM_PHASES];
+
+        double total() const;
+    };
+
+    EnergyModel(const Params& params = Params())
+            : params(params), committed_energy(0) { }
+
+    /**
+     * Returns the energy of the operations counted by a profiler.
+     */
+    Energy energy(const Profiler& profiler) const;
+
+    /**
+     * Adds the operations of a profiler to an epoch, once the
+     * operation that it profiles is done.
+     */
+    void add(uint32_t epoch, Phase phase, const Profiler& profiler);
+
+    /**
+     * Closes an epoch whose checkpoint has committed.
+     * @return The energy of the epoch
+     */
+    EpochEnergy commit(uint32_t epoch);
+
+    /**
+     * Returns the energy of a phase over all epochs, be they committed
+     * or not.
+     */
+    const Energy& total(Phase phase) const;
+
+    const std::vector<EpochEnergy>& committedEpochs() const
+    { return committed; }
+
+    /**
+     * Returns the energy per committed epoch in pJ, i.e., the energy
+     * of a durable transaction of the whole system.
+     */
+    double energyPerCommit() const;
+
+    /**
+     * Writes the committed epochs as CSV, one line per epoch.
+     */
+    void dump(std::ostream& os) const;
+
+    static const char* name(Phase phase);
+    static const char* name(Component component);
+
+  private:
+    const Params params;
+    std::map<uint32_t, EpochEnergy> pending;
+    std::vector<EpochEnergy> committed;
+    double committed_energy;
+    Energy totals[NUM_PHASES];
+};
+
+inline
+EnergyModel::Energy::Energy()
+{
+    for (int i = 0; i < NUM_COMPONENTS; ++i) {
+        component[i] = 0;
+    }
+}
+
+inline double
+EnergyModel::Energy::total() const
+{
+    double sum = 0;
+    for (int i = 0; i < NUM_COMPONENTS; ++i) {
+        sum += component[i];
+    }
+    return sum;
+}
+
+inline EnergyModel::Energy&
+EnergyModel::Energy::operator+=(const Energy& e)
+{
+    for (int i = 0; i < NUM_COMPONENTS; ++i) {
+        component[i] += e.component[i];
+    }
+    return *this;
+}
+
+inline double
+EnergyModel::EpochEnergy::total() const
+{
+    return phase[DEMAND].total() + phase[CHECKPOINT].total();
+}
+
+inline const EnergyModel::Energy&
+EnergyModel::total(Phase phase) const
+{
+    assert(phase < NUM_PHASES);
+    return totals[phase];
+}
+
+inline double
+EnergyModel::energyPerCommit() const
+{
+    return committed.empty() ? 0 : committed_energy / committed.size();
+}
+
+}  // namespace thynvm
+
+#endif  // __THYNVM_ENERGY_MODEL_HH__
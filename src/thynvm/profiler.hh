@@ -37,6 +37,13 @@ namespace thynvm {
 class Profiler
 {
   public:
+    enum Device
+    {
+        DRAM = 0,
+        NVM,
+        NUM_DEVICES,
+    };
+
     Profiler();
     Profiler(const Profiler& p);
 
@@ -46,19 +53,45 @@ class Profiler
 
     void addLatency(uint64_t lat);
     void addTableOp(int num = 1);
+    void addTableUpdate(int num = 1);
     void addBufferOp(int num = 1);
 
+    /**
+     * Counts the bytes read from or written to a memory array, be it
+     * by a demand request or by moving data around for checkpointing.
+     */
+    void addArrayRead(Device device, uint64_t bytes);
+    void addArrayWrite(Device device, uint64_t bytes);
+
     void addBlockIntraChannel(int num = 1);
     void addBlockInterChannel(int num = 1);
     void addPageIntraChannel(int num = 1);
     void addPageInterChannel(int num = 1);
 
+    /**
+     * Counts blocks or pages copied for checkpointing, as the traffic
+     * within or between the channels of the devices, and as the bytes
+     * read from the source array and written to the destination one.
+     */
+    void addBlockCopy(Device src, Device dest, int num = 1);
+    void addPageCopy(Device src, Device dest, int num = 1);
+
     uint64_t sumLatency();
     uint64_t sumTraffic(bool excluding_intra = false);
 
     void setIgnoreLatency();
     void clearIgnoreLatency();
 
+    /**
+     * Operations counted for their energy, which unlike their latency
+     * is never ignored. Table updates are also table operations.
+     */
+    uint64_t tableOps() const { return energy_table_ops; }
+    uint64_t tableUpdates() const { return energy_table_updates; }
+    uint64_t bufferOps() const { return energy_buffer_ops; }
+    uint64_t arrayReadBytes(Device device) const;
+    uint64_t arrayWriteBytes(Device device) const;
+
     static Profiler Null;
     static Profiler Overlap;
 
@@ -74,6 +107,12 @@ class Profiler
     uint64_t bytes_intra_channel;
     uint64_t bytes_inter_channel;
 
+    uint64_t energy_table_ops;
+    uint64_t energy_table_updates;
+    uint64_t energy_buffer_ops;
+    uint64_t array_read_bytes[NUM_DEVICES];
+    uint64_t array_write_bytes[NUM_DEVICES];
+
     bool _ignore_latency;
 };
 
@@ -81,8 +120,13 @@ inline
 Profiler::Profiler()
         : _op_latency(0), _block_bytes(0), _page_bytes(0),
           num_table_ops(0), num_buffer_ops(0),
-          latency(0), bytes_intra_channel(0), bytes_inter_channel(0)
+          latency(0), bytes_intra_channel(0), bytes_inter_channel(0),
+          energy_table_ops(0), energy_table_updates(0), energy_buffer_ops(0)
 {
+    for (int i = 0; i < NUM_DEVICES; ++i) {
+        array_read_bytes[i] = 0;
+        array_write_bytes[i] = 0;
+    }
     _ignore_latency = false;
 }
 
@@ -134,6 +178,14 @@ Profiler::addTableOp(int num)
     if (!_ignore_latency) {
         num_table_ops += num;
     }
+    energy_table_ops += num;
+}
+
+inline void
+Profiler::addTableUpdate(int num)
+{
+    addTableOp(num);
+    energy_table_updates += num;
 }
 
 inline void
@@ -142,6 +194,21 @@ Profiler::addBufferOp(int num)
     if (!_ignore_latency) {
         num_buffer_ops += num;
     }
+    energy_buffer_ops += num;
+}
+
+inline void
+Profiler::addArrayRead(Device device, uint64_t bytes)
+{
+    assert(device < NUM_DEVICES);
+    array_read_bytes[device] += bytes;
+}
+
+inline void
+Profiler::addArrayWrite(Device device, uint64_t bytes)
+{
+    assert(device < NUM_DEVICES);
+    array_write_bytes[device] += bytes;
 }
 
 inline void
@@ -176,6 +243,30 @@ Profiler::addPageInterChannel(int num)
     bytes_inter_channel += num * _page_bytes;
 }
 
+inline void
+Profiler::addBlockCopy(Device src, Device dest, int num)
+{
+    if (src == dest) {
+        addBlockIntraChannel(num);
+    } else {
+        addBlockInterChannel(num);
+    }
+    addArrayRead(src, num * _block_bytes);
+    addArrayWrite(dest, num * _block_bytes);
+}
+
+inline void
+Profiler::addPageCopy(Device src, Device dest, int num)
+{
+    if (src == dest) {
+        addPageIntraChannel(num);
+    } else {
+        addPageInterChannel(num);
+    }
+    addArrayRead(src, num * _page_bytes);
+    addArrayWrite(dest, num * _page_bytes);
+}
+
 inline uint64_t
 Profiler::sumLatency()
 {
@@ -190,6 +281,20 @@ Profiler::sumTraffic(bool excluding_intra)
     return (excluding_intra ? 0 : bytes_intra_channel) + bytes_inter_channel;
 }
 
+inline uint64_t
+Profiler::arrayReadBytes(Device device) const
+{
+    assert(device < NUM_DEVICES);
+    return array_read_bytes[device];
+}
+
+inline uint64_t
+Profiler::arrayWriteBytes(Device device) const
+{
+    assert(device < NUM_DEVICES);
+    return array_write_bytes[device];
+}
+
 }  // namespace thynvm
 
 #endif  // __THYNVM_PROFILER_HH__
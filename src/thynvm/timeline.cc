@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "timeline.hh"
+
+#include <cerrno>
+#include "base/misc.hh"
+
+using namespace std;
+using namespace thynvm;
+
+const char Timeline::magic[8] = { 't', 'h', 'y', 't', 'l', '0', '0', '1' };
+
+Timeline::Timeline(const string& filename, uint64_t tick_freq,
+        uint64_t interval, size_t buffer_bytes)
+        : _tick_freq(tick_freq), _interval(interval), next_sample(0),
+          started(false), buffer(buffer_bytes), used(0)
+{
+    file = fopen(filename.c_str(), "wb");
+    if (!file) {
+        fatal("Failed to open timeline %s: %s\n", filename, strerror(errno));
+    }
+}
+
+Timeline::~Timeline()
+{
+    if (!started) {
+        writeHeader();
+    }
+    flush();
+    fclose(file);
+}
+
+void
+Timeline::addCounter(const string& name, function<uint32_t()> probe)
+{
+    assert(!started);
+    names.push_back(name);
+    probes.push_back(probe);
+}
+
+void
+Timeline::addTableCounters(const string& prefix, const AddrTransTable& table)
+{
+    const char* states[] = { "free", "clean", "dirty", "hidden",
+            "pre_hidden", "pre_dirty" };
+    for (int s = ATTEntry::FREE; s < ATTEntry::LOAN; ++s) {
+        ATTEntry::State state = ATTEntry::State(s);
+        addCounter(prefix + "." + states[s],
+                [&table, state] { return table.getLength(state); });
+    }
+}
+
+void
+Timeline::addBufferCounters(const string& prefix, const VersionBuffer& buffer)
+{
+    const char* states[] = { "short", "long", "in_use" };
+    for (int s = VersionBuffer::SHORT; s < VersionBuffer::FREE; ++s) {
+        VersionBuffer::State state = VersionBuffer::State(s);
+        addCounter(prefix + "." + states[s],
+                [&buffer, state] { return buffer.count(state); });
+    }
+}
+
+void
+Timeline::writeHeader()
+{
+    assert(!started && used == 0);
+    started = true;
+    append(magic);
+    append(_tick_freq);
+    append(uint32_t(names.size()));
+    for (vector<string>::iterator it = names.begin(); it != names.end();
+            ++it) {
+        append(uint32_t(it->size()));
+        for (string::iterator c = it->begin(); c != it->end(); ++c) {
+            append(*c);
+        }
+    }
+}
+
+void
+Timeline::record(uint64_t now, Event event, uint32_t arg)
+{
+    if (!started) {
+        writeHeader();
+    }
+    Record r = { now, uint32_t(event), arg };
+    append(r);
+}
+
+void
+Timeline::sample(uint64_t now)
+{
+    record(now, SAMPLE, probes.size());
+    for (vector<function<uint32_t()>>::iterator it = probes.begin();
+            it != probes.end(); ++it) {
+        append((*it)());
+    }
+    next_sample = now + _interval;
+}
+
+void
+Timeline::transition(uint64_t now, Event event, uint32_t arg)
+{
+    record(now, event, arg);
+    sample(now);
+}
+
+void
+Timeline::epochBegin(uint64_t now, uint32_t epoch)
+{
+    transition(now, EPOCH_BEGIN, epoch);
+}
+
+void
+Timeline::checkpointBegin(uint64_t now, uint32_t epoch)
+{
+    transition(now, CHECKPOINT_BEGIN, epoch);
+}
+
+void
+Timeline::checkpointEnd(uint64_t now, uint32_t epoch)
+{
+    transition(now, CHECKPOINT_END, epoch);
+}
+
+void
+Timeline::stallBegin(uint64_t now)
+{
+    transition(now, STALL_BEGIN, 0);
+}
+
+void
+Timeline::stallEnd(uint64_t now)
+{
+    transition(now, STALL_END, 0);
+}
+
+void
+Timeline::flush()
+{
+    if (used && fwrite(buffer.data(), 1, used, file) != used) {
+        fatal("Failed to write the timeline: %s\n", strerror(errno));
+    }
+    used = 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __THYNVM_TIMELINE_HH__
+#define __THYNVM_TIMELINE_HH__
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "addr_trans_table.hh"
+#include "version_buffer.hh"
+
+namespace thynvm {
+
+/**
+ * A timeline of the activity of the controller over a run: when the
+ * epochs start, when their checkpoints start and end, when demand
+ * requests stall, and counters such as the ATT queue lengths per
+ * state, the VersionBuffer occupancy and the NVM write queue depth.
+ * The counters are sampled at a fixed interval and at each of the
+ * transitions, so that the timeline shows both the trends and what
+ * happens around a transition.
+ *
+ * Records go to a buffer in memory which is written out whenever it
+ * fills up, so that recording costs little more than a copy. The
+ * binary format is a header with the tick frequency and the counter
+ * names, followed by records of a tick, a type and an argument, each
+ * sample record being followed by the value of every counter.
+ * util/thynvm_timeline.py turns it into the Chrome trace-event JSON of
+ * trace viewers.
+ */
+class Timeline
+{
+  public:
+    enum Event
+    {
+        SAMPLE = 0,
+        EPOCH_BEGIN,
+        CHECKPOINT_BEGIN,
+        CHECKPOINT_END,
+        STALL_BEGIN,
+        STALL_END,
+    };
+
+    /**
+     * Fields of a record, after which a sample has one uint32_t per
+     * counter.
+     */
+    struct Record
+    {
+        uint64_t tick;
+        uint32_t event;
+        uint32_t arg;
+    };
+
+    static const char magic[8];
+
+    /**
+     * @param filename Path of the timeline file
+     * @param tick_freq Ticks per second
+     * @param interval Ticks between samples, 0 to sample only at the
+     *                 transitions
+     * @param buffer_bytes Bytes buffered before writing out
+     */
+    Timeline(const std::string& filename, uint64_t tick_freq,
+            uint64_t interval, size_t buffer_bytes = 1 << 20);
+    ~Timeline();
+
+    /**
+     * Adds a counter to the samples, before anything is recorded.
+     * Names are grouped by what comes before their first dot.
+     */
+    void addCounter(const std::string& name, std::function<uint32_t()> probe);
+    void addTableCounters(const std::string& prefix,
+            const AddrTransTable& table);
+    void addBufferCounters(const std::string& prefix,
+            const VersionBuffer& buffer);
+
+    /**
+     * Samples the counters if the interval has passed since the last
+     * sample. Meant to be called at every request.
+     */
+    void tick(uint64_t now);
+    void sample(uint64_t now);
+
+    void epochBegin(uint64_t now, uint32_t epoch);
+    void checkpointBegin(uint64_t now, uint32_t epoch);
+    void checkpointEnd(uint64_t now, uint32_t epoch);
+    void stallBegin(uint64_t now);
+    void stallEnd(uint64_t now);
+
+    /**
+     * Writes out the buffered records.
+     */
+    void flush();
+
+  private:
+    void record(uint64_t now, Event event, uint32_t arg);
+    void transition(uint64_t now, Event event, uint32_t arg);
+    void writeHeader();
+
+    template <class T>
+    void append(const T& value);
+
+    FILE* file;
+    const uint64_t _tick_freq;
+    const uint64_t _interval;
+    uint64_t next_sample;
+    bool started;
+
+    std::vector<std::string> names;
+    std::vector<std::function<uint32_t()>> probes;
+
+    std::vector<char> buffer;
+    size_t used;
+};
+
+template <class T>
+inline void
+Timeline::append(const T& value)
+{
+    if (used + sizeof(T) > buffer.size()) {
+        flush();
+    }
+    memcpy(&buffer[used], &value, sizeof(T));
+    used += sizeof(T);
+}
+
+inline void
+Timeline::tick(uint64_t now)
+{
+    if (_interval && now >= next_sample) {
+        sample(now);
+    }
+}
+
+}  // namespace thynvm
+
+#endif  // __THYNVM_TIMELINE_HH__
@@ -72,6 +72,11 @@ class VersionBuffer
 
     bool contains(uint64_t addr) const;
 
+    /**
+     * Returns the number of block slots in a state
+     */
+    int count(State state) const { return index_sets[state].size(); }
+
   private:
     uint64_t at(int index);
     int index(uint64_t hw_addr);
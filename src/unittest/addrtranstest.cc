@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <iostream>
+#include <set>
+
+#include "base/compiler.hh"
+#include "base/index_queue.hh"
+#include "thynvm/addr_trans_table.hh"
+
+using namespace std;
+using namespace thynvm;
+
+/** Collects the indexes of a queue. */
+class Collector : public QueueVisitor
+{
+  public:
+    set<int> indexes;
+    void Visit(int i) { indexes.insert(i); }
+};
+
+static set<int>
+queued(AddrTransTable& att, ATTEntry::State state)
+{
+    Collector c;
+    int n = att.visitQueue(state, &c);
+    assert(n == (int)c.indexes.size());
+    assert(n == att.getLength(state));
+    return c.indexes;
+}
+
+int
+main()
+{
+    Profiler profiler;
+    const int length = 8;
+    AddrTransTable att(length, 6);
+    assert(queued(att, ATTEntry::FREE).size() == length);
+
+    // Each insert takes the front of the FREE queue, which is then
+    // only in the queue of its new state
+    set<int> used;
+    for (int i = 0; i < length; ++i) {
+        int front = att.getFront(ATTEntry::FREE);
+        int index = att.insert(i, att.toAddr(i), ATTEntry::DIRTY, profiler);
+        assert(index == front);
+        bool fresh M5_VAR_USED = used.insert(index).second;
+        assert(fresh);
+        assert(queued(att, ATTEntry::FREE).count(index) == 0);
+        assert(queued(att, ATTEntry::DIRTY).count(index) == 1);
+        assert(att.getLength(ATTEntry::FREE) == length - i - 1);
+        assert(att.lookup(i, profiler) == index);
+    }
+    assert(att.isEmpty(ATTEntry::FREE));
+
+    // Entries freed again go back to the FREE queue and are reused
+    int victim = att.getFront(ATTEntry::DIRTY);
+    att.shiftState(victim, ATTEntry::FREE, profiler);
+    assert(queued(att, ATTEntry::FREE) == set<int>{ victim });
+    assert(att.lookup(0, profiler) < 0);
+    int reused M5_VAR_USED = att.insert(100, 0, ATTEntry::CLEAN, profiler);
+    assert(reused == victim);
+    assert(att.isEmpty(ATTEntry::FREE));
+    assert(queued(att, ATTEntry::CLEAN) == set<int>{ victim });
+
+    cout << "address translation table passed" << endl;
+    return 0;
+}
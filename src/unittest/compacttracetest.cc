@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "base/random.hh"
+#include "proto/compact_trace.hh"
+
+using namespace std;
+
+bool
+operator==(const CompactTraceRecord& a, const CompactTraceRecord& b)
+{
+    return a.tick == b.tick && a.addr == b.addr && a.cmd == b.cmd &&
+        a.size == b.size && a.flags == b.flags;
+}
+
+int
+main()
+{
+    char filename[] = "/tmp/compacttraceXXXXXX";
+    int fd = mkstemp(filename);
+    assert(fd >= 0);
+    close(fd);
+
+    // Mostly sequential packets, with jumps anywhere in the address
+    // space, and the odd change of size and flags
+    Random rng(1);
+    vector<CompactTraceRecord> records;
+    CompactTraceRecord r = { 1000, 0x100000, 1, 64, 0 };
+    for (int i = 0; i < 10000; ++i) {
+        r.tick += rng.random<int>(0, 3) ? 500 : rng.random<Tick>(0, 100000);
+        r.addr = rng.random<int>(0, 3) ? r.addr + r.size :
+            rng.random<Addr>() & ~Addr(7);
+        r.cmd = rng.random<int>(0, 1) ? 1 : 4;
+        r.size = rng.random<int>(0, 50) ? 64 : 8;
+        r.flags = rng.random<int>(0, 100) ? 0 : 0x20;
+        records.push_back(r);
+    }
+
+    {
+        CompactTraceWriter writer(filename, 1000000000000ULL, 1000);
+        for (const auto& record : records)
+            writer.write(record);
+    }
+
+    assert(CompactTraceReader::isCompact(filename));
+    CompactTraceReader reader(filename);
+    assert(reader.tickFrequency() == 1000000000000ULL);
+    assert(reader.numRecords() == records.size());
+    assert(reader.numBlocks() == 10);
+
+    // Blocks decode independently, in any order
+    vector<CompactTraceRecord> block;
+    for (int b = 9; b >= 0; --b) {
+        bool read M5_VAR_USED = reader.readBlock(b, block);
+        assert(read);
+        assert(block.size() == 1000);
+        for (int i = 0; i < 1000; ++i)
+            assert(block[i] == records[b * 1000 + i]);
+    }
+
+    // Seeking finds the block a tick falls in
+    assert(reader.findBlock(0) == 0);
+    assert(reader.findBlock(records[5500].tick) == 5);
+    assert(reader.findBlock(records.back().tick + 1) == 9);
+
+    // A garbled block is reported, and the others still decode
+    {
+        FILE* file = fopen(filename, "r+");
+        assert(file);
+        CompactTrace::Header header;
+        size_t n M5_VAR_USED = fread(&header, sizeof(header), 1, file);
+        assert(n == 1);
+        CompactTrace::IndexEntry index[2];
+        int err M5_VAR_USED = fseek(file, header.indexOffset +
+            3 * sizeof(CompactTrace::IndexEntry), SEEK_SET);
+        assert(err == 0);
+        n = fread(index, sizeof(index), 1, file);
+        assert(n == 1);
+        vector<char> garbage(index[1].offset - index[0].offset, '\xff');
+        err = fseek(file, index[0].offset, SEEK_SET);
+        assert(err == 0);
+        n = fwrite(garbage.data(), garbage.size(), 1, file);
+        assert(n == 1);
+        err = fclose(file);
+        assert(err == 0);
+    }
+    CompactTraceReader garbled(filename);
+    bool read M5_VAR_USED = garbled.readBlock(3, block);
+    assert(!read);
+    read = garbled.readBlock(4, block);
+    assert(read);
+    assert(block[0] == records[4000]);
+
+    unlink(filename);
+
+    cout << "compact trace passed" << endl;
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "thynvm/energy_model.hh"
+
+using namespace std;
+using namespace thynvm;
+
+static bool
+near(double a, double b)
+{
+    return fabs(a - b) <= 1e-9 * max(fabs(a), fabs(b));
+}
+
+/** A profiler of a controller with 64B blocks and 4KB pages. */
+static Profiler
+profiler()
+{
+    Profiler p;
+    p.setBlockTraffic(64);
+    p.setPageTraffic(4096);
+    return p;
+}
+
+static vector<string>
+split(const string& line)
+{
+    vector<string> fields;
+    stringstream ss(line);
+    string field;
+    while (getline(ss, field, ','))
+        fields.push_back(field);
+    return fields;
+}
+
+int
+main()
+{
+    EnergyModel::Params params;
+    EnergyModel model(params);
+
+    // A demand read from DRAM and write to NVM, which look up the
+    // tables twice, update them once, and use the buffer three times.
+    // Operations whose latency is ignored still take energy.
+    Profiler demand1 = profiler();
+    demand1.addArrayRead(Profiler::DRAM, 64);
+    demand1.addArrayWrite(Profiler::NVM, 64);
+    demand1.addTableOp();
+    demand1.setIgnoreLatency();
+    demand1.addTableOp();
+    demand1.addBufferOp(2);
+    demand1.clearIgnoreLatency();
+    demand1.addTableUpdate();
+    demand1.addBufferOp();
+
+    EnergyModel::Energy e = model.energy(demand1);
+    assert(near(e.component[EnergyModel::DRAM_READ],
+                64 * 8 * params.dram_read));
+    assert(e.component[EnergyModel::DRAM_WRITE] == 0);
+    assert(e.component[EnergyModel::NVM_READ] == 0);
+    assert(near(e.component[EnergyModel::NVM_WRITE],
+                64 * 8 * params.nvm_write));
+    assert(near(e.component[EnergyModel::TABLE_LOOKUP],
+                2 * params.table_lookup));
+    assert(near(e.component[EnergyModel::TABLE_UPDATE],
+                params.table_update));
+    assert(near(e.component[EnergyModel::BUFFER], 3 * params.buffer_op));
+    double demand1_pj = 64 * 8 * (params.dram_read + params.nvm_write) +
+        2 * params.table_lookup + params.table_update + 3 * params.buffer_op;
+    assert(near(e.total(), demand1_pj));
+
+    // The checkpoint of epoch 1 copies two blocks from DRAM to NVM and
+    // a page within the NVM, while epoch 2 already runs
+    Profiler checkpoint1 = profiler();
+    checkpoint1.addBlockCopy(Profiler::DRAM, Profiler::NVM, 2);
+    checkpoint1.addPageCopy(Profiler::NVM, Profiler::NVM);
+    assert(checkpoint1.sumTraffic() == 2 * 64 + 4096);
+    assert(checkpoint1.sumTraffic(true) == 2 * 64);
+    assert(checkpoint1.arrayReadBytes(Profiler::DRAM) == 2 * 64);
+    assert(checkpoint1.arrayWriteBytes(Profiler::DRAM) == 0);
+    assert(checkpoint1.arrayReadBytes(Profiler::NVM) == 4096);
+    assert(checkpoint1.arrayWriteBytes(Profiler::NVM) == 2 * 64 + 4096);
+    double checkpoint1_pj = 2 * 64 * 8 * params.dram_read +
+        4096 * 8 * params.nvm_read + (2 * 64 + 4096) * 8 * params.nvm_write;
+
+    Profiler demand2 = profiler();
+    demand2.addArrayWrite(Profiler::DRAM, 64);
+    double demand2_pj = 64 * 8 * params.dram_write;
+
+    model.add(1, EnergyModel::DEMAND, demand1);
+    model.add(2, EnergyModel::DEMAND, demand2);
+    model.add(1, EnergyModel::CHECKPOINT, checkpoint1);
+    assert(model.committedEpochs().empty());
+    assert(model.energyPerCommit() == 0);
+
+    // Epoch 1 only has its own demand and checkpoint energy
+    EnergyModel::EpochEnergy epoch1 = model.commit(1);
+    assert(epoch1.epoch == 1);
+    assert(near(epoch1.phase[EnergyModel::DEMAND].total(), demand1_pj));
+    assert(near(epoch1.phase[EnergyModel::CHECKPOINT].total(),
+                checkpoint1_pj));
+    assert(near(epoch1.total(), demand1_pj + checkpoint1_pj));
+    assert(near(model.energyPerCommit(), demand1_pj + checkpoint1_pj));
+
+    // Epoch 2 has no checkpoint energy yet, and epoch 3 none at all
+    EnergyModel::EpochEnergy epoch2 = model.commit(2);
+    assert(near(epoch2.phase[EnergyModel::DEMAND].total(), demand2_pj));
+    assert(epoch2.phase[EnergyModel::CHECKPOINT].total() == 0);
+    EnergyModel::EpochEnergy epoch3 = model.commit(3);
+    assert(epoch3.epoch == 3 && epoch3.total() == 0);
+
+    assert(model.committedEpochs().size() == 3);
+    double all_pj = demand1_pj + checkpoint1_pj + demand2_pj;
+    assert(near(model.energyPerCommit(), all_pj / 3));
+    assert(near(model.total(EnergyModel::DEMAND).total(),
+                demand1_pj + demand2_pj));
+    assert(near(model.total(EnergyModel::CHECKPOINT).total(),
+                checkpoint1_pj));
+
+    // The totals keep what is added to epochs not committed yet
+    model.add(4, EnergyModel::DEMAND, demand2);
+    assert(near(model.total(EnergyModel::DEMAND).total(),
+                demand1_pj + 2 * demand2_pj));
+    assert(model.committedEpochs().size() == 3);
+
+    // A header and a line per committed epoch, with the total, and the
+    // total and components of each phase
+    stringstream csv;
+    model.dump(csv);
+    string line;
+    vector<vector<string>> lines;
+    while (getline(csv, line))
+        lines.push_back(split(line));
+    assert(lines.size() == 4);
+    const size_t columns = 2 + EnergyModel::NUM_PHASES *
+        (1 + EnergyModel::NUM_COMPONENTS);
+    for (const auto& fields : lines)
+        assert(fields.size() == columns);
+    assert(lines[0][0] == "epoch" && lines[0][1] == "total_pj");
+    assert(lines[0][2] == "demand_pj");
+    assert(lines[0][3] == "demand_dram_read_pj");
+    assert(lines[0][columns - 1] == "checkpoint_buffer_pj");
+    assert(lines[1][0] == "1" && lines[2][0] == "2" && lines[3][0] == "3");
+    assert(near(stod(lines[1][1]), demand1_pj + checkpoint1_pj));
+    assert(near(stod(lines[1][2]), demand1_pj));
+    assert(near(stod(lines[2][1]), demand2_pj));
+    assert(stod(lines[3][1]) == 0);
+
+    cout << "energymodeltest passed" << endl;
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Event queue microbenchmark. It replays a sequence of insert, remove
+ * and service operations on every EventQueue backend, checks that all
+ * of them service the events in the same order, and reports the
+ * throughput of each.
+ *
+ * The sequence is either recorded from a real run with
+ * --debug-flags=EventQTrace, or generated: a number of periodic
+ * sources (clocks, refresh, DRAM bank timers) with some of them
+ * rescheduled at random.
+ *
+ * usage: eventqtime [trace [queue]]
+ *        eventqtime -s sources pops
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/cprintf.hh"
+#include "base/misc.hh"
+#include "base/random.hh"
+#include "sim/eventq_impl.hh"
+
+using namespace std;
+
+struct Op
+{
+    char kind;  // 'i'nsert, 'r'emove, or 'p'op the head
+    uint64_t id;
+    Tick when;
+    int prio;
+};
+
+class ReplayEvent : public Event
+{
+  public:
+    static ReplayEvent *lastProcessed;
+
+    const uint64_t id;
+
+    ReplayEvent(uint64_t _id, Priority p) : Event(p), id(_id) {}
+    void process() { lastProcessed = this; }
+    const char *description() const { return "replay"; }
+};
+
+ReplayEvent *ReplayEvent::lastProcessed = NULL;
+
+/** Self-rescheduling source for the generated sequence. */
+class SourceEvent : public Event
+{
+  public:
+    EventQueue &eq;
+    vector<Op> &ops;
+    vector<SourceEvent *> &sources;
+    Random &rng;
+    const uint64_t id;
+    const Tick period;
+
+    SourceEvent(EventQueue &_eq, vector<Op> &_ops,
+                vector<SourceEvent *> &_sources, Random &_rng, uint64_t _id,
+                Tick _period, Priority p)
+        : Event(p), eq(_eq), ops(_ops), sources(_sources), rng(_rng),
+          id(_id), period(_period)
+    {}
+
+    void
+    sched(Tick when)
+    {
+        ops.push_back({ 'i', id, when, priority() });
+        eq.schedule(this, when);
+    }
+
+    void
+    process()
+    {
+        ops.push_back({ 'p', id, 0, 0 });
+        sched(curTick() + period);
+
+        // Move another source around, like a bank or a timer that is
+        // pushed back when new work arrives
+        if (rng.random<unsigned>(0, 7) == 0) {
+            SourceEvent *other = sources[rng.random<size_t>(0,
+                                                 sources.size() - 1)];
+            if (other != this && other->scheduled()) {
+                ops.push_back({ 'r', other->id, 0, 0 });
+                eq.deschedule(other);
+                other->sched(curTick() + rng.random<Tick>(1, 4 * period));
+            }
+        }
+    }
+
+    const char *description() const { return "source"; }
+};
+
+static void
+synthesize(unsigned num_sources, uint64_t pops, vector<Op> &ops)
+{
+    // Periods of a few common clock domains and controller timers
+    static const Tick periods[] = { 250, 333, 500, 1000, 1250, 7800000 };
+    static const size_t num_periods = sizeof(periods) / sizeof(periods[0]);
+
+    EventQueue eq("generator");
+    curEventQueue(&eq);
+    Random rng(1);
+
+    vector<SourceEvent *> sources;
+    for (unsigned i = 0; i < num_sources; ++i) {
+        Tick period = periods[i % num_periods];
+        Event::Priority prio = rng.random<int>(-1, 1) * 50;
+        sources.push_back(new SourceEvent(eq, ops, sources, rng, i, period,
+                                          prio));
+    }
+    for (auto s : sources)
+        s->sched(rng.random<Tick>(0, s->period));
+
+    for (uint64_t i = 0; i < pops; ++i)
+        eq.serviceOne();
+
+    for (auto s : sources) {
+        if (s->scheduled())
+            eq.deschedule(s);
+        delete s;
+    }
+    curEventQueue(NULL);
+}
+
+static bool
+load(const char *path, const string &queue, vector<Op> &ops)
+{
+    ifstream in(path);
+    if (!in)
+        return false;
+
+    string line;
+    while (getline(in, line)) {
+        istringstream ss(line);
+        string name;
+        Op op = { 0, 0, 0, 0 };
+        if (!(ss >> name >> op.kind >> hex >> op.id >> dec) || name != queue)
+            continue;
+        if (op.kind == 'i' && !(ss >> op.when >> op.prio))
+            continue;
+        if (op.kind == 'i' || op.kind == 'r' || op.kind == 'p')
+            ops.push_back(op);
+    }
+    return true;
+}
+
+/**
+ * Replay a sequence on one backend.
+ * @return Number of serviced events that differ from the sequence.
+ */
+static uint64_t
+replay(const vector<Op> &ops, EventQueue::Backend backend, double &seconds)
+{
+    EventQueue eq("replay");
+    eq.setBackend(backend);
+    curEventQueue(&eq);
+
+    unordered_map<uint64_t, ReplayEvent *> events;
+    uint64_t mismatches = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (auto &op : ops) {
+        ReplayEvent *&ev = events[op.id];
+        switch (op.kind) {
+          case 'i':
+            // Addresses get reused by events of another priority
+            if (ev && ev->priority() != op.prio) {
+                assert(!ev->scheduled());
+                delete ev;
+                ev = NULL;
+            }
+            if (!ev)
+                ev = new ReplayEvent(op.id, op.prio);
+            eq.schedule(ev, op.when);
+            break;
+          case 'r':
+            eq.deschedule(ev);
+            break;
+          case 'p':
+            eq.serviceOne();
+            if (ReplayEvent::lastProcessed != ev)
+                ++mismatches;
+            break;
+        }
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() -
+                                       start).count();
+
+    for (auto &e : events) {
+        if (e.second && e.second->scheduled())
+            eq.deschedule(e.second);
+        delete e.second;
+    }
+    curEventQueue(NULL);
+
+    return mismatches;
+}
+
+int
+main(int argc, char *argv[])
+{
+    vector<Op> ops;
+
+    if (argc == 4 && string(argv[1]) == "-s") {
+        synthesize(atoi(argv[2]), strtoull(argv[3], NULL, 0), ops);
+    } else if (argc == 2 || argc == 3) {
+        if (!load(argv[1], argc == 3 ? argv[2] : "MainEventQueue-0", ops))
+            fatal("Cannot open trace %s\n", argv[1]);
+    } else if (argc == 1) {
+        synthesize(4096, 2000000, ops);
+    } else {
+        cprintf("usage: %s [trace [queue]]\n"
+                "       %s -s sources pops\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    static const struct {
+        EventQueue::Backend backend;
+        const char *name;
+    } backends[] = {
+        { EventQueue::ListBackend, "list" },
+        { EventQueue::CalendarBackend, "calendar" },
+    };
+
+    int ret = 0;
+    for (auto &b : backends) {
+        double seconds;
+        uint64_t mismatches = replay(ops, b.backend, seconds);
+        cprintf("%-8s %d ops in %.3fs, %.2f Mops/s\n", b.name, ops.size(),
+                seconds, ops.size() / seconds / 1e6);
+        if (mismatches) {
+            cprintf("%-8s %d events serviced out of order\n", b.name,
+                    mismatches);
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
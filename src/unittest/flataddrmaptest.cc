@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+
+#include "base/compiler.hh"
+#include "base/flat_addr_map.hh"
+
+using namespace std;
+
+int
+main()
+{
+    const size_t max_entries = 1000;
+    FlatAddrMap<int> m(max_entries);
+    map<Addr, int> ref;
+
+    assert(m.empty() && m.find(0x40) == NULL);
+    bool erased M5_VAR_USED = m.erase(0x40);
+    assert(!erased);
+
+    // Block-aligned keys from a small range, so that probe runs get long
+    // and wrap around the table
+    srand(1);
+    for (int i = 0; i < 200000; ++i) {
+        Addr key = (Addr)(rand() % (2 * max_entries)) << 6;
+        if (rand() % 2 && ref.size() < max_entries) {
+            m.insert(key, i);
+            ref[key] = i;
+        } else {
+            erased = m.erase(key);
+            size_t ref_erased M5_VAR_USED = ref.erase(key);
+            assert(erased == (ref_erased == 1));
+        }
+        assert(m.size() == ref.size());
+    }
+
+    for (Addr key = 0; key < (2 * max_entries) << 6; key += 1 << 6) {
+        map<Addr, int>::const_iterator it = ref.find(key);
+        const int *v = m.find(key);
+        assert((v != NULL) == (it != ref.end()));
+        assert(v == NULL || *v == it->second);
+    }
+
+    m.clear();
+    assert(m.empty() && m.find(ref.begin()->first) == NULL);
+
+    cout << "flat address map passed" << endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "base/hdr_histogram.hh"
+#include "base/random.hh"
+
+using namespace std;
+
+int
+main()
+{
+    // Small values each have a bucket of their own
+    HdrHistogram small(7, 1000000);
+    for (uint64_t v = 0; v < 128; ++v) {
+        assert(small.lowestValue(small.index(v)) == v);
+        assert(small.highestValue(small.index(v)) == v);
+        small.record(v);
+    }
+    assert(small.samples() == 128);
+    assert(small.min() == 0 && small.max() == 127);
+    assert(small.percentile(0) == 0);
+    assert(small.percentile(50) == 63);
+    assert(small.percentile(100) == 127);
+
+    // Buckets are contiguous and keep the precision
+    for (size_t i = 1; i < small.numBuckets(); ++i) {
+        assert(small.lowestValue(i) == small.highestValue(i - 1) + 1);
+        assert(small.index(small.lowestValue(i)) == i);
+        assert(small.index(small.highestValue(i)) == i);
+        uint64_t width = small.highestValue(i) - small.lowestValue(i) + 1;
+        assert(width * 64 <= small.lowestValue(i) || width == 1);
+    }
+
+    // Latencies from tens of ns to some us, with a long tail, match
+    // the exact percentiles to the precision
+    Random rng(1);
+    HdrHistogram hist(7, 1000000000000ULL);
+    vector<uint64_t> values;
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t v = 20000 + rng.random<uint64_t>(0, 30000);
+        if (rng.random<int>(0, 99) == 0)
+            v *= rng.random<int>(10, 200);
+        values.push_back(v);
+        hist.record(v);
+    }
+    sort(values.begin(), values.end());
+    const double ps[] = { 0, 1, 50, 90, 99, 99.9, 99.99, 100 };
+    for (double p : ps) {
+        uint64_t rank = max<uint64_t>(ceil(p / 100 * values.size()), 1);
+        uint64_t exact = values[rank - 1];
+        uint64_t got = hist.percentile(p);
+        assert(got >= exact && got <= exact + exact / 64);
+    }
+    assert(hist.min() == values.front() && hist.max() == values.back());
+    assert(hist.numBuckets() < 4096);
+
+    // Adding and resetting
+    HdrHistogram other(7, 1000000000000ULL);
+    other.record(5);
+    other.record(2000000000000ULL);
+    hist.add(other);
+    assert(hist.samples() == values.size() + 2);
+    assert(hist.min() == 5);
+    assert(hist.max() == 1000000000000ULL);
+    assert(hist.percentile(100) == 1000000000000ULL);
+    hist.reset();
+    assert(hist.samples() == 0 && hist.percentile(99) == 0);
+    hist.record(42);
+    assert(hist.percentile(50) == 42 && hist.mean() == 42);
+
+    cout << "hdr histogram passed" << endl;
+    return 0;
+}
@@ -0,0 +1,416 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @file
+ * Microbenchmark of the data structures that every simulated access
+ * goes through: event scheduling, packet allocation, address range
+ * lookups, cache tags, and the ThyNVM address translation table and
+ * version buffer. The inputs are synthetic and seeded, so that two
+ * builds run the same operations and can be compared one against the
+ * other, and the checksum of each benchmark makes sure that they do.
+ *
+ * The results are printed as CSV, one line per benchmark, with the
+ * best time of a number of runs.
+ *
+ * usage: hotpathtime [-n scale] [-r runs] [benchmark ...]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "base/addr_range_map.hh"
+#include "base/cprintf.hh"
+#include "base/misc.hh"
+#include "base/random.hh"
+#include "mem/cache/tags/lru.hh"
+#include "mem/packet.hh"
+#include "mem/request.hh"
+#include "params/LRU.hh"
+#include "params/SrcClockDomain.hh"
+#include "params/VoltageDomain.hh"
+#include "sim/clock_domain.hh"
+#include "sim/eventq_impl.hh"
+#include "sim/voltage_domain.hh"
+#include "thynvm/addr_trans_table.hh"
+#include "thynvm/version_buffer.hh"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double
+since(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+/** Periodic event that reschedules itself, like a clock or a timer. */
+class PeriodicEvent : public Event
+{
+  public:
+    EventQueue &eq;
+    const Tick period;
+    uint64_t &count;
+
+    PeriodicEvent(EventQueue &_eq, Tick _period, uint64_t &_count,
+                  Priority p)
+        : Event(p), eq(_eq), period(_period), count(_count)
+    {}
+
+    void
+    process()
+    {
+        ++count;
+        eq.schedule(this, curTick() + period);
+    }
+
+    const char *description() const { return "periodic"; }
+};
+
+static uint64_t
+benchEventQueue(uint64_t ops, double &seconds)
+{
+    static const Tick periods[] = { 250, 333, 500, 1000, 1250, 7800000 };
+    static const size_t num_periods = sizeof(periods) / sizeof(periods[0]);
+
+    EventQueue *saved = curEventQueue();
+    EventQueue eq("bench");
+    curEventQueue(&eq);
+    Random rng(1);
+
+    uint64_t count = 0;
+    vector<PeriodicEvent *> events;
+    for (unsigned i = 0; i < 64; ++i) {
+        Event::Priority prio = rng.random<int>(-1, 1) * 50;
+        events.push_back(new PeriodicEvent(eq, periods[i % num_periods],
+                                           count, prio));
+        eq.schedule(events.back(), rng.random<Tick>(0, periods[i %
+                                                               num_periods]));
+    }
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i)
+        eq.serviceOne();
+    seconds = since(start);
+
+    uint64_t checksum = count ^ eq.getCurTick();
+    for (auto e : events) {
+        eq.deschedule(e);
+        delete e;
+    }
+    curEventQueue(saved);
+    return checksum;
+}
+
+static uint64_t
+benchPacket(uint64_t ops, double &seconds)
+{
+    // Packets in flight, as held by the queues of a memory system
+    static const unsigned in_flight = 64;
+
+    Random rng(1);
+    vector<Addr> addrs(4096);
+    for (auto &a : addrs)
+        a = rng.random<Addr>(0, (1ULL << 32) - 1) & ~Addr(63);
+
+    vector<PacketPtr> ring(in_flight, NULL);
+    uint64_t checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        PacketPtr &slot = ring[i % in_flight];
+        if (slot) {
+            checksum += slot->getAddr() + *slot->getConstPtr<uint8_t>();
+            delete slot->req;
+            delete slot;
+        }
+        Request *req = new Request(addrs[i % addrs.size()], 64, 0, 0);
+        slot = new Packet(req, i % 4 ? MemCmd::ReadReq : MemCmd::WriteReq);
+        slot->allocate();
+        *slot->getPtr<uint8_t>() = i;
+    }
+    seconds = since(start);
+
+    for (auto pkt : ring) {
+        if (pkt) {
+            delete pkt->req;
+            delete pkt;
+        }
+    }
+    return checksum;
+}
+
+static uint64_t
+benchAddrRangeMap(uint64_t ops, double &seconds)
+{
+    // Ranges of the ports of a crossbar, with holes in between
+    static const unsigned num_ranges = 256;
+    static const Addr range_size = 1ULL << 24;
+
+    AddrRangeMap<int> ranges;
+    for (unsigned i = 0; i < num_ranges; ++i)
+        ranges.insert(RangeSize(2 * i * range_size, range_size), i);
+
+    Random rng(1);
+    vector<Addr> addrs(4096);
+    for (auto &a : addrs)
+        a = rng.random<Addr>(0, 2 * num_ranges * range_size - 1);
+
+    uint64_t checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        AddrRangeMap<int>::const_iterator it =
+            ranges.find(addrs[i % addrs.size()]);
+        if (it != ranges.end())
+            checksum += it->second + 1;
+    }
+    seconds = since(start);
+
+    return checksum;
+}
+
+/**
+ * LRU tags that fill themselves on a miss, so that the tags can be
+ * exercised without a cache around them.
+ */
+class BenchTags : public LRU
+{
+  public:
+    BenchTags(const Params *p) : LRU(p) {}
+
+    void
+    fill(Addr addr)
+    {
+        CacheBlk *blk = findVictim(addr);
+        if (blk->isValid())
+            blk->invalidate();
+        sets[blk->set].setTag(blk, extractTag(addr));
+        blk->status = BlkValid | BlkReadable;
+        sets[blk->set].moveToHead(blk);
+    }
+};
+
+static uint64_t
+benchTags(uint64_t ops, double &seconds)
+{
+    // 1MB 8-way, like a last-level cache slice
+    static const uint64_t size = 1 << 20;
+
+    // Stats cannot be unregistered, so like any other SimObject the
+    // tags and their domains are never deleted
+    VoltageDomainParams *vp = new VoltageDomainParams;
+    vp->name = "bench.voltage_domain";
+    vp->eventq_index = 0;
+    vp->voltage.push_back(1.0);
+
+    SrcClockDomainParams *cp = new SrcClockDomainParams;
+    cp->name = "bench.clk_domain";
+    cp->eventq_index = 0;
+    cp->clock.push_back(500);
+    cp->domain_id = -1;
+    cp->init_perf_level = 0;
+    cp->voltage_domain = new VoltageDomain(vp);
+
+    LRUParams *tp = new LRUParams;
+    tp->name = "bench.tags";
+    tp->eventq_index = 0;
+    tp->clk_domain = new SrcClockDomain(cp);
+    tp->block_size = 64;
+    tp->hit_latency = Cycles(2);
+    tp->size = size;
+    tp->assoc = 8;
+    tp->sequential_access = false;
+    BenchTags &tags = *new BenchTags(tp);
+
+    // A working set of twice the cache, so that about half of the
+    // accesses miss and refill
+    Random rng(1);
+    vector<Addr> addrs(1 << 16);
+    for (auto &a : addrs)
+        a = rng.random<Addr>(0, 2 * size - 1) & ~Addr(63);
+
+    uint64_t checksum = 0;
+    Cycles lat;
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        Addr addr = addrs[i % addrs.size()];
+        CacheBlk *blk = tags.accessBlock(addr, false, lat, 0);
+        if (blk)
+            checksum += blk->tag;
+        else
+            tags.fill(addr);
+    }
+    seconds = since(start);
+
+    return checksum;
+}
+
+static uint64_t
+benchAddrTransTable(uint64_t ops, double &seconds)
+{
+    static const int length = 4096;
+    static const int unit_bits = 6;
+
+    thynvm::AddrTransTable att(length, unit_bits);
+    thynvm::Profiler profiler;
+
+    // Twice as many blocks as entries, so that about half of the
+    // lookups miss and evict the least recently used dirty entry
+    Random rng(1);
+    vector<thynvm::Tag> tags(1 << 16);
+    for (auto &t : tags)
+        t = rng.random<thynvm::Tag>(0, 2 * length - 1);
+
+    uint64_t checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        thynvm::Tag tag = tags[i % tags.size()];
+        int index = att.lookup(tag, profiler);
+        if (index >= 0) {
+            checksum += att.at(index).hw_addr;
+            continue;
+        }
+        if (att.isEmpty(thynvm::ATTEntry::FREE)) {
+            att.shiftState(att.getFront(thynvm::ATTEntry::DIRTY),
+                           thynvm::ATTEntry::FREE, profiler);
+        }
+        att.insert(tag, att.toAddr(tag), thynvm::ATTEntry::DIRTY, profiler);
+    }
+    seconds = since(start);
+
+    return checksum;
+}
+
+static uint64_t
+benchVersionBuffer(uint64_t ops, double &seconds)
+{
+    static const int length = 4096;
+    static const int block_bits = 6;
+
+    thynvm::VersionBuffer buffer(length, block_bits);
+    buffer.setAddrBase(1ULL << 32);
+    thynvm::Profiler profiler;
+
+    // Keep half of the buffer in use, freeing the oldest slot for each
+    // new one
+    vector<uint64_t> ring(length / 2, 0);
+    uint64_t checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (uint64_t i = 0; i < ops; ++i) {
+        uint64_t &slot = ring[i % ring.size()];
+        if (slot)
+            buffer.freeSlot(slot, thynvm::VersionBuffer::IN_USE, profiler);
+        slot = buffer.allocSlot(profiler);
+        checksum += slot;
+    }
+    seconds = since(start);
+
+    return checksum;
+}
+
+static const struct {
+    const char *name;
+    uint64_t (*run)(uint64_t ops, double &seconds);
+    uint64_t ops;
+} benchmarks[] = {
+    { "eventq", benchEventQueue, 4000000 },
+    { "packet", benchPacket, 2000000 },
+    { "addrrangemap", benchAddrRangeMap, 4000000 },
+    { "tags", benchTags, 4000000 },
+    { "addrtranstable", benchAddrTransTable, 2000000 },
+    { "versionbuffer", benchVersionBuffer, 2000000 },
+};
+
+int
+main(int argc, char *argv[])
+{
+    double scale = 1;
+    int runs = 3;
+    vector<string> names;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            scale = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            cprintf("usage: %s [-n scale] [-r runs] [benchmark ...]\n",
+                    argv[0]);
+            return 1;
+        } else {
+            names.push_back(argv[i]);
+        }
+    }
+    if (scale <= 0 || runs <= 0)
+        fatal("The scale and the number of runs must be positive\n");
+
+    for (auto &n : names) {
+        bool found = false;
+        for (auto &b : benchmarks)
+            found = found || n == b.name;
+        if (!found)
+            fatal("Unknown benchmark %s\n", n);
+    }
+
+    // Requests and packets take their time from the current queue
+    curEventQueue(getEventQueue(0));
+
+    cprintf("name,ops,seconds,ops_per_second,checksum\n");
+    for (auto &b : benchmarks) {
+        bool selected = names.empty();
+        for (auto &n : names)
+            selected = selected || n == b.name;
+        if (!selected)
+            continue;
+
+        uint64_t ops = max<uint64_t>(b.ops * scale, 1);
+        double best = 0;
+        uint64_t checksum = 0;
+        for (int r = 0; r < runs; ++r) {
+            double seconds;
+            uint64_t sum = b.run(ops, seconds);
+            if (r > 0 && sum != checksum)
+                panic("Benchmark %s is not deterministic\n", b.name);
+            checksum = sum;
+            if (r == 0 || seconds < best)
+                best = seconds;
+        }
+        cprintf("%s,%d,%.6f,%.0f,%#x\n", b.name, ops, best, ops / best,
+                checksum);
+    }
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "params/SrcClockDomain.hh"
+#include "params/System.hh"
+#include "params/VoltageDomain.hh"
+#include "sim/clock_domain.hh"
+#include "sim/eventq.hh"
+#include "sim/serialize.hh"
+#include "sim/system.hh"
+#include "sim/voltage_domain.hh"
+
+using namespace std;
+
+class NoResolver : public SimObjectResolver
+{
+  public:
+    SimObject* resolveSimObject(const string& name) { return NULL; }
+};
+
+/** Records the hints that the system passes on. */
+class HintRecorder : public System::PersistController
+{
+  public:
+    map<Addr, System::PersistHint> hints;
+
+    void forceEpoch() { }
+    uint64_t lastCommittedEpoch() const { return 0; }
+    void persistHint(Addr page_addr, System::PersistHint hint)
+    {
+        hints[page_addr] = hint;
+    }
+};
+
+static SrcClockDomain* clkDomain;
+
+static System*
+makeSystem()
+{
+    // Stats cannot be unregistered, so like any other SimObject the
+    // systems are never deleted
+    SystemParams* p = new SystemParams;
+    p->name = "system";
+    p->eventq_index = 0;
+    p->clk_domain = clkDomain;
+    p->cache_line_size = 64;
+    p->mem_mode = Enums::timing;
+    p->checkpoint_threads = 1;
+    p->num_work_ids = 16;
+    return new System(p);
+}
+
+/** Check the pages that a hint on a range applies to. */
+static void
+checkPages(System* sys, Addr addr, uint64_t len, System::PersistHint hint,
+           Addr expected_start, Addr expected_end)
+{
+    Addr start, end;
+    sys->persistHintPages(addr, len, hint, start, end);
+    assert(start == expected_start);
+    assert(end == expected_end);
+}
+
+int
+main()
+{
+    curEventQueue(getEventQueue(0));
+
+    VoltageDomainParams* vp = new VoltageDomainParams;
+    vp->name = "system.voltage_domain";
+    vp->eventq_index = 0;
+    vp->voltage.push_back(1.0);
+
+    SrcClockDomainParams* cp = new SrcClockDomainParams;
+    cp->name = "system.clk_domain";
+    cp->eventq_index = 0;
+    cp->clock.push_back(500);
+    cp->domain_id = -1;
+    cp->init_perf_level = 0;
+    cp->voltage_domain = new VoltageDomain(vp);
+    clkDomain = new SrcClockDomain(cp);
+
+    System* sys = makeSystem();
+    const Addr page = sys->getPageBytes();
+
+    // A volatile range shrinks to the pages wholly in it, possibly
+    // none, while the other hints grow to every page it touches
+    Addr addr = 3 * page + page / 2;
+    checkPages(sys, addr, 2 * page, System::PersistVolatile,
+               4 * page, 5 * page);
+    checkPages(sys, addr, 2 * page, System::PersistCritical,
+               3 * page, 6 * page);
+    checkPages(sys, addr, 2 * page, System::PersistDefault,
+               3 * page, 6 * page);
+    checkPages(sys, addr, page / 4, System::PersistVolatile,
+               4 * page, 4 * page);
+    checkPages(sys, addr, page / 4, System::PersistCritical,
+               3 * page, 4 * page);
+    checkPages(sys, 4 * page, 2 * page, System::PersistVolatile,
+               4 * page, 6 * page);
+    checkPages(sys, 4 * page, 2 * page, System::PersistCritical,
+               4 * page, 6 * page);
+
+    // Hints are kept per page, and the default one drops a page
+    sys->setPersistHint(4 * page + 8, System::PersistVolatile);
+    sys->setPersistHint(7 * page, System::PersistCritical);
+    sys->setPersistHint(9 * page, System::PersistCritical);
+    sys->setPersistHint(9 * page + 1, System::PersistDefault);
+    assert(sys->getPersistHint(4 * page) == System::PersistVolatile);
+    assert(sys->getPersistHint(5 * page - 1) == System::PersistVolatile);
+    assert(sys->getPersistHint(7 * page + 100) == System::PersistCritical);
+    assert(sys->getPersistHint(9 * page) == System::PersistDefault);
+    assert(sys->getPersistHint(5 * page) == System::PersistDefault);
+
+    // A controller registering late gets the hints given before
+    HintRecorder recorder;
+    sys->registerPersistController(&recorder);
+    assert(recorder.hints.size() == 2);
+    assert(recorder.hints[4 * page] == System::PersistVolatile);
+    assert(recorder.hints[7 * page] == System::PersistCritical);
+
+    // The hints survive a checkpoint
+    char dir_template[] = "/tmp/persisthinttest.XXXXXX";
+    char* made M5_VAR_USED = mkdtemp(dir_template);
+    assert(made);
+    string dir = dir_template;
+    {
+        Checkpoint::setDir(dir);
+        ofstream cpt((dir + "/" + Checkpoint::baseFilename).c_str());
+        cpt << "\n[system]\n";
+        sys->serialize(cpt);
+    }
+    System* restored = makeSystem();
+    {
+        NoResolver resolver;
+        Checkpoint cpt(dir, resolver);
+        restored->unserialize(&cpt, "system");
+    }
+    assert(restored->getPersistHint(4 * page) == System::PersistVolatile);
+    assert(restored->getPersistHint(7 * page) == System::PersistCritical);
+    assert(restored->getPersistHint(5 * page) == System::PersistDefault);
+    assert(restored->getPersistHint(9 * page) == System::PersistDefault);
+
+    // Checkpoints from before the hints have none
+    {
+        ofstream cpt((dir + "/" + Checkpoint::baseFilename).c_str());
+        cpt << "\n[system]\npagePtr=0\nnextPID=0\n"
+            << "\n[system.physmem]\nlal_addr=\nlal_cid=\nnbr_of_stores=0\n";
+    }
+    System* old = makeSystem();
+    {
+        NoResolver resolver;
+        Checkpoint cpt(dir, resolver);
+        old->unserialize(&cpt, "system");
+    }
+    assert(old->getPersistHint(4 * page) == System::PersistDefault);
+
+    string rm = "rm -rf " + dir;
+    if (system(rm.c_str()) != 0)
+        cerr << "Can't remove " << dir << endl;
+
+    cout << "persisthinttest passed" << endl;
+    return 0;
+}
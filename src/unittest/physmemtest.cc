@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <cassert>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "base/random.hh"
+#include "mem/abstract_mem.hh"
+#include "mem/physical.hh"
+#include "params/AbstractMemory.hh"
+#include "params/SrcClockDomain.hh"
+#include "params/VoltageDomain.hh"
+#include "sim/clock_domain.hh"
+#include "sim/eventq.hh"
+#include "sim/serialize.hh"
+#include "sim/voltage_domain.hh"
+
+using namespace std;
+
+/** Blocks of the chunked format and pages, its unit of zero skipping. */
+const uint64_t blockBytes = 64 * 1024;
+const uint64_t pageBytes = 4096;
+
+/** Three blocks and three pages of a fourth. */
+const uint64_t storeBytes = 3 * blockBytes + 3 * pageBytes;
+
+class NoResolver : public SimObjectResolver
+{
+  public:
+    SimObject* resolveSimObject(const string& name) { return NULL; }
+};
+
+static NoResolver resolver;
+static SrcClockDomain* clkDomain;
+static string dir;
+
+/** A physical memory with a single store of storeBytes. */
+static PhysicalMemory*
+makePhysMem(bool raw, const string& image_dir = "")
+{
+    // the checkpoint sections are named after the physical memory, so
+    // it is the same in all of them
+    static int count = 0;
+    AbstractMemoryParams* p = new AbstractMemoryParams;
+    p->name = "system.mem" + to_string(count++);
+    p->eventq_index = 0;
+    p->clk_domain = clkDomain;
+    p->range = AddrRange(0, storeBytes - 1);
+    p->null = false;
+    p->in_addr_map = true;
+    p->conf_table_reported = false;
+    vector<AbstractMemory*> memories(1, new AbstractMemory(p));
+
+    return new PhysicalMemory("system.physmem", memories, false, 2, raw,
+                              image_dir);
+}
+
+static uint8_t*
+store(PhysicalMemory* pm)
+{
+    assert(pm->getBackingStore().size() == 1);
+    return pm->getBackingStore()[0].second;
+}
+
+/**
+ * Fill a store with an all-zero first block, a second block with
+ * only some pages non-zero, and data everywhere else.
+ */
+static void
+fill(uint8_t* pmem)
+{
+    memset(pmem, 0, storeBytes);
+    pmem[blockBytes + 5 * pageBytes + 17] = 0x5a;
+    memset(pmem + blockBytes + 9 * pageBytes, 0xa5, pageBytes);
+    for (uint64_t i = 2 * blockBytes; i < storeBytes; i += 8)
+        *(uint64_t*)(pmem + i) = random_mt.random<uint64_t>() & 0xffff;
+}
+
+/** Write the checkpoint of a physical memory to dir. */
+static void
+checkpoint(PhysicalMemory* pm)
+{
+    Checkpoint::setDir(dir);
+    ofstream cpt((dir + "/" + Checkpoint::baseFilename).c_str());
+    cpt << "\n[system.physmem]\n";
+    pm->serialize(cpt);
+}
+
+static void
+restore(PhysicalMemory* pm)
+{
+    Checkpoint cp(dir, resolver);
+    pm->unserialize(&cp, "system.physmem");
+}
+
+/** Replace the store section of the checkpoint in dir. */
+static void
+writeStoreSection(const string& filename, const string& format)
+{
+    ofstream cpt((dir + "/" + Checkpoint::baseFilename).c_str());
+    cpt << "\n[system.physmem]\nlal_addr=\nlal_cid=\nnbr_of_stores=1\n"
+        << "\n[system.physmem.store0]\nstore_id=0\nfilename=" << filename
+        << "\nrange_size=" << storeBytes << "\n";
+    if (!format.empty())
+        cpt << "format=" << format << "\n";
+}
+
+/** Check that a restore from the checkpoint in dir fails. */
+static void
+expectFatal()
+{
+    cout.flush();
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        // keep the expected message and the core out of the test
+        struct rlimit no_core = { 0, 0 };
+        setrlimit(RLIMIT_CORE, &no_core);
+        if (!freopen("/dev/null", "w", stderr))
+            _exit(0);
+        restore(makePhysMem(false));
+        _exit(0);
+    }
+
+    // fatal() aborts
+    int status;
+    pid_t waited M5_VAR_USED = waitpid(pid, &status, 0);
+    assert(waited == pid);
+    assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+}
+
+static void
+roundTrip(bool raw)
+{
+    PhysicalMemory* src = makePhysMem(raw);
+    fill(store(src));
+    checkpoint(src);
+
+    PhysicalMemory* dst = makePhysMem(false);
+    restore(dst);
+    assert(memcmp(store(src), store(dst), storeBytes) == 0);
+
+    // a raw restore maps the file privately, so writes do not reach it
+    store(dst)[blockBytes + 5 * pageBytes + 17] = 0;
+    delete dst;
+    dst = makePhysMem(false);
+    restore(dst);
+    assert(memcmp(store(src), store(dst), storeBytes) == 0);
+
+    delete src;
+    delete dst;
+}
+
+static void
+image()
+{
+    string image_dir = dir + "/images";
+    int err M5_VAR_USED = mkdir(image_dir.c_str(), 0775);
+    assert(err == 0);
+
+    PhysicalMemory* src = makePhysMem(false);
+    fill(store(src));
+    checkpoint(src);
+
+    // the first restore creates the image, the second maps it
+    for (int i = 0; i < 2; ++i) {
+        PhysicalMemory* dst = makePhysMem(false, image_dir);
+        restore(dst);
+        assert(memcmp(store(src), store(dst), storeBytes) == 0);
+        delete dst;
+    }
+
+    // only a single image, and its lock
+    int images = 0;
+    DIR* entries = opendir(image_dir.c_str());
+    assert(entries);
+    while (struct dirent* entry = readdir(entries)) {
+        string name = entry->d_name;
+        if (name.size() > 5 && name.substr(name.size() - 5) == ".pmem")
+            ++images;
+    }
+    closedir(entries);
+    assert(images == 1);
+
+    delete src;
+}
+
+static void
+gzip()
+{
+    // checkpoints from before the chunked format are a single gzip
+    // stream, and have no format in their section
+    vector<uint8_t> data(storeBytes);
+    fill(data.data());
+    gzFile compressed = gzopen((dir + "/old.pmem").c_str(), "wb");
+    assert(compressed);
+    int written M5_VAR_USED = gzwrite(compressed, data.data(), storeBytes);
+    assert(written == storeBytes);
+    int err M5_VAR_USED = gzclose(compressed);
+    assert(err == Z_OK);
+    writeStoreSection("old.pmem", "");
+
+    PhysicalMemory* dst = makePhysMem(false);
+    restore(dst);
+    assert(memcmp(data.data(), store(dst), storeBytes) == 0);
+    delete dst;
+}
+
+/** Copy the first bytes of a file, and patch some of them. */
+static void
+corrupt(const string& from, const string& to, uint64_t bytes,
+        uint64_t patch_offset = 0, const string& patch = "")
+{
+    ifstream in((dir + "/" + from).c_str(), ios::binary);
+    string contents((istreambuf_iterator<char>(in)),
+                    istreambuf_iterator<char>());
+    assert(contents.size() >= bytes);
+    contents.resize(bytes);
+    contents.replace(patch_offset, patch.size(), patch);
+    ofstream((dir + "/" + to).c_str(), ios::binary) << contents;
+}
+
+static uint64_t
+fileSize(const string& filename)
+{
+    struct stat file_stat;
+    int err M5_VAR_USED = stat((dir + "/" + filename).c_str(), &file_stat);
+    assert(err == 0);
+    return file_stat.st_size;
+}
+
+static void
+corruption()
+{
+    PhysicalMemory* src = makePhysMem(false);
+    fill(store(src));
+    checkpoint(src);
+    string chunked = src->name() + ".store0.pmem";
+    uint64_t chunked_bytes = fileSize(chunked);
+    delete src;
+
+    // header, magic and sizes, 40 bytes, then the blocks and the
+    // index at the end
+    corrupt(chunked, "bad.pmem", chunked_bytes, 0, "g5pmemXX");
+    writeStoreSection("bad.pmem", "chunked");
+    expectFatal();
+
+    corrupt(chunked, "bad.pmem", 20);
+    expectFatal();
+
+    // cut off the index
+    corrupt(chunked, "bad.pmem", chunked_bytes - 8);
+    expectFatal();
+
+    // garble the compressed data of the first stored block
+    corrupt(chunked, "bad.pmem", chunked_bytes, 40, string(16, '\xff'));
+    expectFatal();
+
+    src = makePhysMem(true);
+    fill(store(src));
+    checkpoint(src);
+    string raw = src->name() + ".store0.pmem";
+    delete src;
+
+    corrupt(raw, "bad.pmem", storeBytes - pageBytes);
+    writeStoreSection("bad.pmem", "raw");
+    expectFatal();
+
+    writeStoreSection("missing.pmem", "raw");
+    expectFatal();
+
+    writeStoreSection(raw, "unknown");
+    expectFatal();
+}
+
+int
+main()
+{
+    curEventQueue(getEventQueue(0));
+
+    // Stats cannot be unregistered, so like any other SimObject the
+    // memories and their domains are never deleted
+    VoltageDomainParams* vp = new VoltageDomainParams;
+    vp->name = "system.voltage_domain";
+    vp->eventq_index = 0;
+    vp->voltage.push_back(1.0);
+
+    SrcClockDomainParams* cp = new SrcClockDomainParams;
+    cp->name = "system.clk_domain";
+    cp->eventq_index = 0;
+    cp->clock.push_back(500);
+    cp->domain_id = -1;
+    cp->init_perf_level = 0;
+    cp->voltage_domain = new VoltageDomain(vp);
+    clkDomain = new SrcClockDomain(cp);
+
+    char dir_template[] = "/tmp/physmemtest.XXXXXX";
+    char* made M5_VAR_USED = mkdtemp(dir_template);
+    assert(made);
+    dir = dir_template;
+
+    roundTrip(false);
+    roundTrip(true);
+    image();
+    gzip();
+    corruption();
+
+    string rm = "rm -rf " + dir;
+    if (system(rm.c_str()) != 0)
+        cerr << "Can't remove " << dir << endl;
+
+    cout << "physmemtest passed" << endl;
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "base/pool_alloc.hh"
+
+using namespace std;
+
+int
+main()
+{
+    PoolAllocator pool("test", 24);
+    assert(pool.objectSize() >= 24 && pool.objectSize() % 16 == 0);
+
+    // Fresh objects are distinct, and freed ones come back
+    vector<void *> objs;
+    for (int i = 0; i < 10000; ++i) {
+        objs.push_back(pool.allocate());
+        memset(objs.back(), i, 24);
+    }
+    assert(set<void *>(objs.begin(), objs.end()).size() == objs.size());
+    assert(pool.hits() == 0 && pool.misses() == 10000);
+
+    set<void *> freed(objs.begin(), objs.end());
+    for (auto p : objs)
+        pool.deallocate(p);
+    for (int i = 0; i < 10000; ++i) {
+        void *p M5_VAR_USED = pool.allocate();
+        assert(freed.count(p));
+    }
+    assert(pool.hits() == 10000 && pool.misses() == 10000);
+
+    // Objects freed by another thread, e.g., a packet crossing event
+    // queues, go through the depot and are recycled by this thread
+    thread freer([&objs, &pool]() {
+        for (auto p : objs)
+            pool.deallocate(p);
+    });
+    freer.join();
+    for (int i = 0; i < 1000; ++i) {
+        void *p M5_VAR_USED = pool.allocate();
+        assert(freed.count(p));
+    }
+    assert(pool.hits() == 11000 && pool.misses() == 10000);
+    assert(PoolAllocator::totalHits() == pool.hits());
+
+    cout << "pool allocator passed" << endl;
+    return 0;
+}
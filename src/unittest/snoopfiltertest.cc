@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "mem/packet.hh"
+#include "mem/port.hh"
+#include "mem/snoop_filter.hh"
+#include "params/SnoopFilter.hh"
+#include "params/SrcClockDomain.hh"
+#include "params/System.hh"
+#include "params/VoltageDomain.hh"
+#include "sim/clock_domain.hh"
+#include "sim/eventq.hh"
+#include "sim/system.hh"
+#include "sim/voltage_domain.hh"
+
+using namespace std;
+
+const Addr lineSize = 64;
+
+/**
+ * Stands in for the CPU-side port of a cache. On a back-invalidation
+ * it either drops the line, or, like a cache with a writeback or an
+ * MSHR for the line in flight, refuses by flagging the block cached.
+ */
+class CachePort : public MasterPort
+{
+  public:
+    bool refuse;
+    vector<Addr> invalidated;
+    vector<Addr> refused;
+
+    CachePort(const string& name, MemObject* owner)
+        : MasterPort(name, owner), refuse(false)
+    { }
+
+    bool isSnooping() const { return true; }
+
+    void recvTimingSnoopReq(PacketPtr pkt)
+    {
+        assert(pkt->cmd == MemCmd::InvalidationReq);
+        assert(!pkt->needsResponse());
+        if (refuse) {
+            pkt->setBlockCached();
+            refused.push_back(pkt->getAddr());
+        } else {
+            invalidated.push_back(pkt->getAddr());
+        }
+    }
+
+    bool recvTimingResp(PacketPtr pkt) { return true; }
+    void recvReqRetry() { }
+};
+
+/** Stands in for a slave port of the crossbar. */
+class XBarPort : public SlavePort
+{
+  public:
+    XBarPort(const string& name, MemObject* owner, PortID id)
+        : SlavePort(name, owner, id)
+    { }
+
+    AddrRangeList getAddrRanges() const { return AddrRangeList(); }
+    Tick recvAtomic(PacketPtr pkt) { return 0; }
+    void recvFunctional(PacketPtr pkt) { }
+    bool recvTimingReq(PacketPtr pkt) { return true; }
+    void recvRespRetry() { }
+};
+
+static SnoopFilter* filter;
+static vector<SlavePort*> xbarPorts;
+
+/**
+ * Issue a read of a line from a port and complete it, shared if
+ * another holder keeps its copy.
+ * @return The number of ports the request snoops.
+ */
+static size_t
+read(Addr line_addr, int port, bool shared = false)
+{
+    Request req(line_addr, lineSize, 0, 0);
+    Packet pkt(&req, MemCmd::ReadReq);
+    size_t snoops =
+        filter->lookupRequest(&pkt, *xbarPorts[port]).first.size();
+    filter->updateRequest(&pkt, *xbarPorts[port], false);
+    if (shared)
+        pkt.assertShared();
+    pkt.makeResponse();
+    filter->updateResponse(&pkt, *xbarPorts[port]);
+    return snoops;
+}
+
+/**
+ * Write a line back from a port, which keeps the block if it only
+ * cleans it eagerly.
+ */
+static void
+writeback(Addr line_addr, int port, bool resident = false)
+{
+    // the packet deletes requests that need no response
+    Packet pkt(new Request(line_addr, lineSize, 0, 0), MemCmd::Writeback);
+    if (resident)
+        pkt.setBlockCached();
+    filter->lookupRequest(&pkt, *xbarPorts[port]);
+    filter->updateRequest(&pkt, *xbarPorts[port], false);
+}
+
+/** The number of ports a snoop from below goes to. */
+static size_t
+snooped(Addr line_addr)
+{
+    Request req(line_addr, lineSize, 0, 0);
+    Packet pkt(&req, MemCmd::ReadReq);
+    return filter->lookupSnoop(&pkt).first.size();
+}
+
+/** A filter of the given capacity, or an unbounded one for 0. */
+static SnoopFilter*
+makeFilter(System* system, const string& name, uint64_t capacity)
+{
+    SnoopFilterParams* params = new SnoopFilterParams;
+    params->name = name;
+    params->eventq_index = 0;
+    params->system = system;
+    params->lookup_latency = Cycles(1);
+    params->max_capacity = capacity;
+    params->assoc = 2;
+    SnoopFilter* sf = new SnoopFilter(params);
+    sf->regStats();
+    sf->setSlavePorts(xbarPorts);
+    return sf;
+}
+
+int
+main()
+{
+    curEventQueue(getEventQueue(0));
+
+    // Stats cannot be unregistered, so like any other SimObject the
+    // system and the filter are never deleted
+    VoltageDomainParams* vp = new VoltageDomainParams;
+    vp->name = "system.voltage_domain";
+    vp->eventq_index = 0;
+    vp->voltage.push_back(1.0);
+
+    SrcClockDomainParams* cp = new SrcClockDomainParams;
+    cp->name = "system.clk_domain";
+    cp->eventq_index = 0;
+    cp->clock.push_back(500);
+    cp->domain_id = -1;
+    cp->init_perf_level = 0;
+    cp->voltage_domain = new VoltageDomain(vp);
+
+    SystemParams* sys_params = new SystemParams;
+    sys_params->name = "system";
+    sys_params->eventq_index = 0;
+    sys_params->clk_domain = new SrcClockDomain(cp);
+    sys_params->cache_line_size = lineSize;
+    sys_params->mem_mode = Enums::timing;
+    sys_params->checkpoint_threads = 1;
+    sys_params->num_work_ids = 16;
+    System* system = new System(sys_params);
+
+    vector<CachePort*> caches;
+    for (int i = 0; i < 2; ++i) {
+        string name = "system.cache" + to_string(i);
+        caches.push_back(new CachePort(name + ".mem_side", system));
+        xbarPorts.push_back(new XBarPort(name + ".xbar", system, i));
+        caches[i]->bind(*xbarPorts[i]);
+    }
+
+    // Two lines in a single set
+    filter = makeFilter(system, "system.snoop_filter", 2 * lineSize);
+
+    // A clean victim is invalidated and no longer tracked
+    read(0x0, 0);
+    read(0x40, 0);
+    read(0x80, 1);
+    assert(caches[0]->invalidated.size() == 1);
+    assert(caches[0]->invalidated[0] == 0x0);
+    assert(snooped(0x0) == 0);
+    assert(snooped(0x40) == 1);
+    assert(snooped(0x80) == 1);
+
+    // A dirty victim has its writeback in flight, so it stays tracked
+    // until the writeback passes the filter, which tries the
+    // invalidation again on its way
+    caches[0]->refuse = true;
+    read(0x100, 1);
+    assert(caches[0]->refused.size() == 1);
+    assert(caches[0]->refused[0] == 0x40);
+    assert(snooped(0x40) == 1);
+    writeback(0x40, 0);
+    assert(caches[0]->refused.size() == 2);
+    assert(snooped(0x40) == 0);
+    // The line is gone, so it is not invalidated again
+    caches[0]->refuse = false;
+    read(0x180, 1);
+    assert(caches[0]->invalidated.size() == 1);
+    assert(caches[0]->refused.size() == 2);
+
+    // A victim with an MSHR in flight is retried until its holder
+    // takes the invalidation
+    read(0x200, 0);
+    caches[0]->refuse = true;
+    read(0x280, 1);
+    read(0x300, 1);
+    read(0x380, 1);
+    assert(caches[0]->refused.size() == 4);
+    assert(caches[0]->refused[2] == 0x200);
+    assert(caches[0]->refused[3] == 0x200);
+    assert(snooped(0x200) == 1);
+    caches[0]->refuse = false;
+    read(0x400, 1);
+    assert(caches[0]->invalidated.size() == 2);
+    assert(caches[0]->invalidated[1] == 0x200);
+    assert(snooped(0x200) == 0);
+
+    // A cache above may respond for a line the filter dropped, which
+    // makes the requester a holder again
+    {
+        Request req(0x200, lineSize, 0, 0);
+        Packet pkt(&req, MemCmd::ReadReq);
+        pkt.assertMemInhibit();
+        filter->lookupRequest(&pkt, *xbarPorts[0]);
+        filter->updateRequest(&pkt, *xbarPorts[0], false);
+    }
+    assert(snooped(0x200) == 1);
+
+    // An eagerly cleaned block stays in its cache, so it is still
+    // snooped, and its eviction after being written again finds it a
+    // holder. An unbounded filter panics on writebacks of lines that
+    // it does not see held.
+    filter = makeFilter(system, "system.unbounded_filter", 0);
+    read(0x0, 0);
+    writeback(0x0, 0, true);
+    assert(snooped(0x0) == 1);
+    size_t snoops M5_VAR_USED = read(0x0, 1, true);
+    assert(snoops == 1);
+    assert(snooped(0x0) == 2);
+    writeback(0x0, 0);
+    assert(snooped(0x0) == 1);
+    writeback(0x0, 1);
+    assert(snooped(0x0) == 0);
+
+    cout << "snoopfiltertest passed" << endl;
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "base/stats/binary.hh"
+#include "base/stats/info.hh"
+#include "sim/eventq.hh"
+
+using namespace std;
+using namespace Stats;
+
+/** A scalar stat whose value is set by the test. */
+class TestScalar : public ScalarInfo
+{
+  public:
+    Stats::Counter v;
+
+    TestScalar(const string &_name) : v(0)
+    {
+        name = _name;
+        flags.set(display);
+    }
+
+    Stats::Counter value() const { return v; }
+    Result result() const { return v; }
+    Result total() const { return v; }
+    bool check() const { return true; }
+    void prepare() { }
+    void reset() { v = 0; }
+    bool zero() const { return v == 0; }
+    void visit(Output &visitor) { visitor.visit(*this); }
+};
+
+/** A vector of distributions whose data is set by the test. */
+class TestVectorDist : public VectorDistInfo
+{
+  public:
+    TestVectorDist(const string &_name, size_type size)
+    {
+        name = _name;
+        flags.set(display);
+        data.resize(size);
+    }
+
+    size_type size() const { return data.size(); }
+    bool check() const { return true; }
+    void prepare() { }
+    void reset() { }
+    bool zero() const { return false; }
+    void visit(Output &visitor) { visitor.visit(*this); }
+};
+
+static DistData
+distData(Stats::Counter min, Stats::Counter bucket_size, const VCounter &cvec)
+{
+    DistData data = DistData();
+    data.type = Hist;
+    data.min = min;
+    data.bucket_size = bucket_size;
+    data.max = min + bucket_size * cvec.size() - 1;
+    data.cvec = cvec;
+    for (auto c : cvec)
+        data.samples += c;
+    return data;
+}
+
+/** Dump the stats at a tick, and return the size of the file then. */
+static uint64_t
+dump(Binary &binary, ofstream &file, Tick tick, const vector<Info *> &stats)
+{
+    curEventQueue()->setCurTick(tick);
+    binary.begin();
+    for (auto info : stats)
+        info->visit(binary);
+    binary.end();
+    return file.tellp();
+}
+
+/** Rows of the CSV that the reader prints, by tick, as name -> value. */
+typedef map<Tick, map<string, double> > Rows;
+
+/** Read a stats file with binary_reader.py. */
+static Rows
+readBack(const string &reader, const string &filename,
+         vector<string> &names)
+{
+    string command = "python " + reader + " " + filename;
+    FILE *pipe = popen(command.c_str(), "r");
+    assert(pipe);
+    string csv;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0)
+        csv.append(chunk, n);
+    int status M5_VAR_USED = pclose(pipe);
+    assert(status == 0);
+
+    istringstream lines(csv);
+    string line;
+    getline(lines, line);
+    istringstream header(line);
+    string name;
+    names.clear();
+    while (getline(header, name, ','))
+        names.push_back(name);
+    assert(!names.empty() && names[0] == "tick");
+
+    Rows rows;
+    while (getline(lines, line)) {
+        istringstream fields(line);
+        string field;
+        getline(fields, field, ',');
+        map<string, double> &row = rows[strtoull(field.c_str(), NULL, 10)];
+        for (size_t i = 1; getline(fields, field, ','); ++i)
+            row[names.at(i)] = atof(field.c_str());
+        assert(row.size() == names.size() - 1);
+    }
+    return rows;
+}
+
+/** Copy the first bytes of a file. */
+static void
+truncate(const string &from, const string &to, uint64_t bytes)
+{
+    ifstream in(from.c_str(), ios::binary);
+    string contents((istreambuf_iterator<char>(in)),
+                    istreambuf_iterator<char>());
+    assert(contents.size() >= bytes);
+    contents.resize(bytes);
+    ofstream(to.c_str(), ios::binary) << contents;
+}
+
+static bool
+hasColumn(const vector<string> &names, const string &name)
+{
+    return find(names.begin(), names.end(), name) != names.end();
+}
+
+/**
+ * Usage: statsbinarytest [src/python/m5/stats/binary_reader.py]
+ *
+ * Run from the top of the tree unless given the reader.
+ */
+int
+main(int argc, char *argv[])
+{
+    string reader = argc > 1 ? argv[1] :
+        "src/python/m5/stats/binary_reader.py";
+    curEventQueue(getEventQueue(0));
+
+    char filename[] = "/tmp/statsbinaryXXXXXX";
+    int fd = mkstemp(filename);
+    assert(fd >= 0);
+    close(fd);
+
+    TestScalar scalar("test.scalar");
+    TestVectorDist vdist("test.vdist", 2);
+    TestScalar late("test.late");
+    vector<Info *> stats = { &scalar, &vdist };
+
+    uint64_t sizes[3];
+    {
+        ofstream file(filename, ios::binary);
+        Binary binary(file);
+
+        scalar.v = 1;
+        vdist.data[0] = distData(0, 1, { 1, 1 });
+        vdist.data[1] = distData(0, 1, { 1, 3 });
+        sizes[0] = dump(binary, file, 1000, stats);
+
+        // The second histogram doubles its buckets but keeps their
+        // number, which renames its columns
+        scalar.v = 2;
+        vdist.data[1] = distData(0, 2, { 2, 2 });
+        sizes[1] = dump(binary, file, 2000, stats);
+
+        // A stat that only shows up in the last dump
+        late.v = 7;
+        stats.push_back(&late);
+        sizes[2] = dump(binary, file, 3000, stats);
+    }
+
+    vector<string> names;
+    Rows rows = readBack(reader, filename, names);
+    assert(rows.size() == 3);
+    assert(rows[1000]["test.scalar"] == 1);
+    assert(rows[2000]["test.scalar"] == 2);
+    assert(rows[1000]["test.vdist::0::samples"] == 2);
+    assert(rows[1000]["test.vdist::1::0"] == 1);
+    assert(rows[1000]["test.vdist::1::1"] == 3);
+    // The bucket that is gone reads zero, the new one has its count
+    assert(rows[2000]["test.vdist::1::0"] == 2);
+    assert(rows[2000]["test.vdist::1::1"] == 0);
+    assert(rows[2000]["test.vdist::1::2"] == 2);
+    assert(rows[2000]["test.vdist::0::1"] == 1);
+    assert(rows[3000]["test.late"] == 7);
+    assert(rows[3000]["test.vdist::1::2"] == 2);
+
+    // A dump cut short in its column definitions or in its row is
+    // left out, along with the columns it defines
+    string cut = string(filename) + ".cut";
+    uint64_t offsets[] = { sizes[1] + 3, sizes[2] - 3 };
+    for (auto offset : offsets) {
+        truncate(filename, cut, offset);
+        rows = readBack(reader, cut, names);
+        assert(rows.size() == 2);
+        assert(rows.count(1000) && rows.count(2000));
+        assert(!hasColumn(names, "test.late"));
+        assert(rows[2000]["test.vdist::1::2"] == 2);
+    }
+
+    unlink(cut.c_str());
+    unlink(filename);
+    cout << "statsbinarytest passed" << endl;
+    return 0;
+}
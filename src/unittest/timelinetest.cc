@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met: redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer;
+ * redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution;
+ * neither the name of the copyright holders nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/compiler.hh"
+#include "thynvm/timeline.hh"
+
+using namespace std;
+using namespace thynvm;
+
+struct Decoded
+{
+    Timeline::Record record;
+    vector<uint32_t> values;
+};
+
+template <class T>
+static T
+read(FILE* file)
+{
+    T value;
+    size_t n M5_VAR_USED = fread(&value, sizeof(T), 1, file);
+    assert(n == 1);
+    return value;
+}
+
+/** Decodes a timeline file as util/thynvm_timeline.py does. */
+static vector<Decoded>
+decode(const char* filename, uint64_t& tick_freq, vector<string>& names)
+{
+    FILE* file = fopen(filename, "rb");
+    assert(file);
+    char magic[8];
+    size_t n M5_VAR_USED = fread(magic, 1, 8, file);
+    assert(n == 8);
+    assert(memcmp(magic, Timeline::magic, 8) == 0);
+    tick_freq = read<uint64_t>(file);
+    uint32_t num_counters = read<uint32_t>(file);
+    for (uint32_t i = 0; i < num_counters; ++i) {
+        string name(read<uint32_t>(file), '\0');
+        n = fread(&name[0], 1, name.size(), file);
+        assert(n == name.size());
+        names.push_back(name);
+    }
+
+    vector<Decoded> records;
+    Decoded d;
+    while (fread(&d.record, sizeof(d.record), 1, file) == 1) {
+        d.values.clear();
+        if (d.record.event == Timeline::SAMPLE) {
+            assert(d.record.arg == num_counters);
+            for (uint32_t i = 0; i < d.record.arg; ++i)
+                d.values.push_back(read<uint32_t>(file));
+        }
+        records.push_back(d);
+    }
+    assert(feof(file));
+    fclose(file);
+    return records;
+}
+
+static void
+expect(const Decoded& d, uint64_t tick, Timeline::Event event, uint32_t arg)
+{
+    assert(d.record.tick == tick);
+    assert(d.record.event == event);
+    assert(d.record.arg == arg);
+}
+
+static void
+expectSample(const Decoded& d, uint64_t tick, const vector<uint32_t>& values)
+{
+    expect(d, tick, Timeline::SAMPLE, values.size());
+    assert(d.values == values);
+}
+
+/**
+ * Runs util/thynvm_timeline.py on the timeline, and checks that the
+ * slices and counter charts come out of it.
+ */
+static void
+convert(const char* script, const char* filename)
+{
+    string command = string("python ") + script + " " + filename;
+    FILE* pipe = popen(command.c_str(), "r");
+    assert(pipe);
+    string json;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0)
+        json.append(chunk, n);
+    int status M5_VAR_USED = pclose(pipe);
+    assert(status == 0);
+
+    const char* expected[] = {
+        "\"name\": \"epoch 1\"", "\"name\": \"epoch 2\"",
+        "\"name\": \"checkpoint 1\"", "\"name\": \"stall\"",
+        "\"name\": \"att\"", "\"name\": \"buffer\"", "\"name\": \"nvm\"",
+        "\"write_queue\": 3", "\"pre_dirty\": 0", "\"in_use\": 1",
+    };
+    for (const char* e : expected) {
+        if (json.find(e) == string::npos) {
+            cerr << "Missing " << e << " in the JSON" << endl;
+            assert(false);
+        }
+    }
+}
+
+/**
+ * Usage: timelinetest [util/thynvm_timeline.py]
+ *
+ * Also checks the conversion to JSON if given the script.
+ */
+int
+main(int argc, char* argv[])
+{
+    char filename[] = "/tmp/timelineXXXXXX";
+    int fd = mkstemp(filename);
+    assert(fd >= 0);
+    close(fd);
+
+    Profiler profiler;
+    AddrTransTable att(8, 6);
+    VersionBuffer buffer(4, 6);
+    buffer.setAddrBase(0x10000);
+    uint32_t write_queue = 0;
+
+    {
+        // A small buffer, so that records are written out on the way
+        Timeline timeline(filename, 1000000000000ULL, 1000, 64);
+        timeline.addTableCounters("att", att);
+        timeline.addBufferCounters("buffer", buffer);
+        timeline.addCounter("nvm.write_queue", [&] { return write_queue; });
+
+        timeline.epochBegin(0, 1);
+        att.insert(1, att.toAddr(1), ATTEntry::DIRTY, profiler);
+        write_queue = 3;
+        timeline.tick(500);
+        timeline.tick(1000);
+        buffer.allocSlot(profiler);
+        timeline.stallBegin(1200);
+        timeline.stallEnd(1300);
+        timeline.checkpointBegin(1500, 1);
+        timeline.epochBegin(1500, 2);
+        // The interval counts from the sample of the last transition
+        timeline.tick(2400);
+        timeline.tick(2500);
+        write_queue = 0;
+        timeline.checkpointEnd(3000, 1);
+    }
+
+    uint64_t tick_freq;
+    vector<string> names;
+    vector<Decoded> records = decode(filename, tick_freq, names);
+    assert(tick_freq == 1000000000000ULL);
+    vector<string> expected_names = {
+        "att.free", "att.clean", "att.dirty", "att.hidden",
+        "att.pre_hidden", "att.pre_dirty",
+        "buffer.short", "buffer.long", "buffer.in_use",
+        "nvm.write_queue",
+    };
+    assert(names == expected_names);
+
+    // Counters in the order of the names
+    vector<uint32_t> initial = { 8, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    vector<uint32_t> inserted = { 7, 0, 1, 0, 0, 0, 0, 0, 0, 3 };
+    vector<uint32_t> allocated = { 7, 0, 1, 0, 0, 0, 0, 0, 1, 3 };
+    vector<uint32_t> drained = { 7, 0, 1, 0, 0, 0, 0, 0, 1, 0 };
+
+    // Every transition is followed by a sample
+    assert(records.size() == 14);
+    expect(records[0], 0, Timeline::EPOCH_BEGIN, 1);
+    expectSample(records[1], 0, initial);
+    expectSample(records[2], 1000, inserted);
+    expect(records[3], 1200, Timeline::STALL_BEGIN, 0);
+    expectSample(records[4], 1200, allocated);
+    expect(records[5], 1300, Timeline::STALL_END, 0);
+    expectSample(records[6], 1300, allocated);
+    expect(records[7], 1500, Timeline::CHECKPOINT_BEGIN, 1);
+    expectSample(records[8], 1500, allocated);
+    expect(records[9], 1500, Timeline::EPOCH_BEGIN, 2);
+    expectSample(records[10], 1500, allocated);
+    expectSample(records[11], 2500, allocated);
+    expect(records[12], 3000, Timeline::CHECKPOINT_END, 1);
+    expectSample(records[13], 3000, drained);
+
+    // A timeline without anything recorded still has its header
+    {
+        Timeline timeline(filename, 1000000000000ULL, 0);
+        timeline.addCounter("nvm.write_queue", [&] { return write_queue; });
+        timeline.tick(5000);
+    }
+    names.clear();
+    records = decode(filename, tick_freq, names);
+    assert(records.empty());
+    assert(names.size() == 1 && names[0] == "nvm.write_queue");
+
+    if (argc > 1) {
+        {
+            Timeline timeline(filename, 1000000000000ULL, 1000);
+            timeline.addTableCounters("att", att);
+            timeline.addBufferCounters("buffer", buffer);
+            timeline.addCounter("nvm.write_queue",
+                    [&] { return write_queue; });
+            write_queue = 3;
+            timeline.epochBegin(0, 1);
+            timeline.stallBegin(200);
+            timeline.stallEnd(300);
+            timeline.checkpointBegin(1000, 1);
+            timeline.epochBegin(1000, 2);
+            timeline.checkpointEnd(1800, 1);
+            timeline.tick(2000);
+        }
+        convert(argv[1], filename);
+    }
+
+    unlink(filename);
+    cout << "timelinetest passed" << endl;
+    return 0;
+}
@@ -31,6 +31,8 @@
 
 from ConfigParser import ConfigParser
 import gzip
+import struct
+import zlib
 
 import sys, re, os
 
@@ -41,6 +43,62 @@ class myCP(ConfigParser):
     def optionxform(self, optionstr):
         return optionstr
 
+class ChunkedPmem(object):
+    """Sequential reader of a physical memory store in the chunked
+    format, i.e., independently compressed blocks of non-zero pages
+    followed by an index (see PhysicalMemory::serializeChunked)."""
+
+    header = struct.Struct("=8sIIQQQ")
+    entry = struct.Struct("=QIHH")
+
+    def __init__(self, f):
+        self.f = f
+        (magic, self.page_bytes, self.block_pages, self.range_size,
+         num_blocks, index_offset) = self.header.unpack(
+             f.read(self.header.size))
+        assert magic == "g5pmem01"
+        f.seek(index_offset)
+        self.index = [self.entry.unpack(f.read(self.entry.size))
+                      for i in xrange(num_blocks)]
+        self.block = 0
+        self.buf = ""
+
+    def _next_block(self):
+        offset, length, mask, _ = self.index[self.block]
+        block_bytes = min(self.page_bytes * self.block_pages,
+                          self.range_size -
+                          self.block * self.page_bytes * self.block_pages)
+        self.block += 1
+        data = ""
+        if mask:
+            self.f.seek(offset)
+            data = zlib.decompress(self.f.read(length))
+        pages = []
+        pos = 0
+        for p in xrange((block_bytes + self.page_bytes - 1) / self.page_bytes):
+            n = min(self.page_bytes, block_bytes - p * self.page_bytes)
+            if mask & (1 << p):
+                pages.append(data[pos:pos + n])
+                pos += n
+            else:
+                pages.append("\0" * n)
+        return "".join(pages)
+
+    def read(self, n):
+        while len(self.buf) < n and self.block < len(self.index):
+            self.buf += self._next_block()
+        data, self.buf = self.buf[:n], self.buf[n:]
+        return data
+
+    def close(self):
+        pass
+
+def open_pmem(f, config):
+    if config.has_option("system.physmem.store0", "format") and \
+            config.get("system.physmem.store0", "format") == "chunked":
+        return ChunkedPmem(f)
+    return gzip.GzipFile(fileobj=f, mode="rb")
+
 def aggregate(output_dir, cpts, no_compress, memory_size):
     merged_config = None
     page_ptr = 0
@@ -100,7 +158,7 @@ def aggregate(output_dir, cpts, no_compress, memory_size):
         print "pages to be read: ", pages
 
         f = open(cpts[i] + "/system.physmem.store0.pmem", "rb")
-        gf = gzip.GzipFile(fileobj=f, mode="rb")
+        gf = open_pmem(f, config)
 
         x = 0
         while x < pages:
@@ -132,6 +190,8 @@ def aggregate(output_dir, cpts, no_compress, memory_size):
     print "Make sure the simulation using this checkpoint has at least ",
     print page_ptr, "x 4K of memory"
     merged_config.set("system.physmem.store0", "range_size", page_ptr * 4 * 1024)
+    # the merged memory is written as a single gzip stream
+    merged_config.remove_option("system.physmem.store0", "format")
 
     merged_config.add_section("Globals")
     merged_config.set("Globals", "curTick", max_curtick)
@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This script converts protobuf packet traces to the compact trace
+# format of src/proto/compact_trace.hh, which TraceGen replays from a
+# memory mapping. It assumes that protoc has been executed and already
+# generated the Python package for the packet messages. This can be
+# done manually using:
+# protoc --python_out=. --proto_path=src/proto src/proto/packet.proto
+#
+# The compact format stores the tick and address of each packet as
+# varint deltas from the previous packet, in blocks of packets that
+# start from scratch, and ends with an index of the blocks for
+# seeking.
+
+import protolib
+import struct
+import sys
+
+# Import the packet proto definitions. If they are not found, attempt
+# to generate them automatically. This assumes that the script is
+# executed from the gem5 root.
+try:
+    import packet_pb2
+except:
+    print "Did not find packet proto definitions, attempting to generate"
+    from subprocess import call
+    error = call(['protoc', '--python_out=util', '--proto_path=src/proto',
+                  'src/proto/packet.proto'])
+    if not error:
+        print "Generated packet proto definitions"
+
+        try:
+            import google.protobuf
+        except:
+            print "Please install Python protobuf module"
+            exit(-1)
+
+        import packet_pb2
+    else:
+        print "Failed to import packet proto definitions"
+        exit(-1)
+
+# Layout of the header and index entries, see CompactTrace::Header
+# and CompactTrace::IndexEntry
+header_format = '<8sQQQQII'
+index_format = '<QQ'
+magic = 'g5ctrc01'
+block_records = 4096
+
+mask64 = (1 << 64) - 1
+
+def varint(value):
+    out = []
+    while value >= 0x80:
+        out.append(chr((value & 0x7f) | 0x80))
+        value >>= 7
+    out.append(chr(value))
+    return ''.join(out)
+
+def zigzag(delta):
+    """Zigzag encoding of a 64-bit difference"""
+    delta &= mask64
+    sign = mask64 if delta >> 63 else 0
+    return ((delta << 1) & mask64) ^ sign
+
+def main():
+    if len(sys.argv) != 3:
+        print "Usage: ", sys.argv[0], " <protobuf input> <compact output>"
+        exit(-1)
+
+    # Open the file in read mode
+    proto_in = protolib.openFileRd(sys.argv[1])
+
+    try:
+        compact_out = open(sys.argv[2], 'wb')
+    except IOError:
+        print "Failed to open ", sys.argv[2], " for writing"
+        exit(-1)
+
+    # Read the magic number in 4-byte Little Endian
+    magic_number = proto_in.read(4)
+
+    if magic_number != "gem5":
+        print "Unrecognized file", sys.argv[1]
+        exit(-1)
+
+    header = packet_pb2.PacketHeader()
+    protolib.decodeMessage(proto_in, header)
+
+    print "Object id:", header.obj_id
+    print "Tick frequency:", header.tick_freq
+
+    # Leave room for the header, which is written once the number of
+    # packets and the index are known
+    compact_out.write('\0' * struct.calcsize(header_format))
+    offset = struct.calcsize(header_format)
+
+    index = []
+    block = []
+    num_packets = 0
+    packet = packet_pb2.Packet()
+
+    # Decode the packet messages until we hit the end of the file
+    while protolib.decodeMessage(proto_in, packet):
+        if num_packets % block_records == 0:
+            if block:
+                data = ''.join(block)
+                compact_out.write(data)
+                offset += len(data)
+                block = []
+            index.append((offset, packet.tick))
+            prev_tick = prev_addr = prev_size = prev_flags = 0
+
+        flags = packet.flags if packet.HasField('flags') else 0
+        key = packet.cmd << 2
+        if packet.size != prev_size:
+            key |= 0x2
+        if flags != prev_flags:
+            key |= 0x1
+
+        block.append(varint(key))
+        block.append(varint(zigzag(packet.tick - prev_tick)))
+        block.append(varint(zigzag(packet.addr - (prev_addr + prev_size))))
+        if key & 0x2:
+            block.append(varint(packet.size))
+        if key & 0x1:
+            block.append(varint(flags))
+
+        prev_tick = packet.tick
+        prev_addr = packet.addr
+        prev_size = packet.size
+        prev_flags = flags
+        num_packets += 1
+
+    data = ''.join(block)
+    compact_out.write(data)
+    offset += len(data)
+
+    for entry in index:
+        compact_out.write(struct.pack(index_format, *entry))
+
+    compact_out.seek(0)
+    compact_out.write(struct.pack(header_format, magic, header.tick_freq,
+                                  num_packets, len(index), offset,
+                                  block_records, 0))
+
+    print "Converted packets:", num_packets
+    print "Blocks:", len(index)
+
+    # We're done
+    compact_out.close()
+    proto_in.close()
+
+if __name__ == "__main__":
+    main()
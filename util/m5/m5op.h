@@ -62,6 +62,15 @@ void m5_panic(void);
 void m5_work_begin(uint64_t workid, uint64_t threadid);
 void m5_work_end(uint64_t workid, uint64_t threadid);
 
+// These operations are for memory that persists by epochs
+void m5_epoch(void);
+uint64_t m5_last_epoch(void);
+void m5_persist_hint(void *addr, uint64_t len, uint64_t hint);
+
+#define M5_PERSIST_DEFAULT   0x0
+#define M5_PERSIST_VOLATILE  0x1
+#define M5_PERSIST_CRITICAL  0x2
+
 // These operations are for critical path annotation
 void m5a_bsm(char *sm, const void *id, int flags);
 void m5a_esm(char *sm);
@@ -54,9 +54,9 @@
 #define addsymbol_func          0x53
 #define panic_func              0x54
 
-#define reserved2_func          0x56 // Reserved for user
-#define reserved3_func          0x57 // Reserved for user
-#define reserved4_func          0x58 // Reserved for user
+#define epoch_func              0x56
+#define lastepoch_func          0x57
+#define persisthint_func        0x58
 #define reserved5_func          0x59 // Reserved for user
 
 #define work_begin_func         0x5a
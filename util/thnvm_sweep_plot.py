@@ -0,0 +1,201 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This script turns the output of configs/thnvm/sweep.py into
+# loaded-latency curves: for each read mix, the p50, p99 and p99.9
+# read latency against the achieved bandwidth. The states of the
+# sweep come from the sweep.cfg it leaves in the output directory, and
+# each of them has a stats dump of its own. The percentiles are those
+# of the log-linear histograms of the monitor when it reports them,
+# and otherwise estimated from the buckets of its read latency
+# histogram, interpolating within a bucket.
+
+import optparse
+import re
+import sys
+
+columns = ['read_pct', 'itt_ns', 'offered_gbps', 'read_gbps',
+           'write_gbps', 'total_gbps', 'reads', 'mean_ns', 'p50_ns',
+           'p99_ns', 'p999_ns']
+
+percentiles = [('p50_ns', 0.5), ('p99_ns', 0.99), ('p999_ns', 0.999)]
+
+def read_states(path):
+    """Read (read percent, itt ticks, block size) of the sweep states"""
+    states = []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if fields and fields[0] == 'STATE':
+                states.append((int(fields[4]), int(fields[9]),
+                               int(fields[7])))
+    return states
+
+def read_dumps(path, monitor):
+    """Read the monitor stats and read latency buckets of each dump"""
+    dumps = []
+    dump = None
+    hist = monitor + '.readLatencyHist::'
+    bucket = re.compile(r'(\d+)(?:-(\d+))?$')
+    with open(path) as f:
+        for line in f:
+            if line.startswith('---------- Begin'):
+                dump = {'buckets': []}
+            elif line.startswith('---------- End'):
+                dumps.append(dump)
+                dump = None
+            elif dump is not None:
+                fields = line.split()
+                if len(fields) < 2:
+                    continue
+                name = fields[0]
+                if name.startswith(hist):
+                    m = bucket.match(name[len(hist):])
+                    if m:
+                        low = int(m.group(1))
+                        high = int(m.group(2)) if m.group(2) else low
+                        dump['buckets'].append((low, high,
+                                                float(fields[1])))
+                        continue
+                try:
+                    dump[name] = float(fields[1])
+                except ValueError:
+                    pass
+    return dumps
+
+def percentile(dump, monitor, p):
+    """Get or estimate a percentile of the read latency in ticks"""
+    reported = '%s.readLatencyPercentiles::p%g' % (monitor, p * 100)
+    if reported in dump:
+        return dump[reported]
+
+    hist = monitor + '.readLatencyHist::'
+    samples = dump.get(hist + 'samples', 0)
+    if samples == 0:
+        return float('nan')
+    target = p * samples
+    seen = dump.get(hist + 'underflows', 0)
+    if seen >= target:
+        return dump.get(hist + 'min_value', 0)
+    for (low, high, count) in dump['buckets']:
+        if count and seen + count >= target:
+            return low + (high + 1 - low) * (target - seen) / count
+        seen += count
+    # the percentile is in the overflows
+    return dump.get(hist + 'max_value', float('nan'))
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] <sweep outdir>")
+    parser.add_option("--monitor", default="system.monitor",
+                      help="name of the monitor in the stats")
+    parser.add_option("--csv", help="write the results to a file rather "
+                      "than to stdout")
+    parser.add_option("--plot", help="save the plot to a file, e.g. a "
+                      "PDF, rather than showing it")
+    parser.add_option("--no-plot", action="store_true",
+                      help="only tabulate the results")
+    (options, args) = parser.parse_args()
+    if len(args) != 1:
+        parser.error("expected the output directory of the sweep")
+
+    try:
+        states = read_states(args[0] + '/sweep.cfg')
+        dumps = read_dumps(args[0] + '/stats.txt', options.monitor)
+    except IOError as e:
+        print "Failed to read the sweep output:", e
+        sys.exit(-1)
+
+    # there may be a dump at exit after those of the states
+    if len(dumps) < len(states):
+        print "Expected %d stats dumps but found %d" % (len(states),
+                                                        len(dumps))
+        sys.exit(-1)
+
+    rows = []
+    for ((read_pct, itt, block_size), dump) in zip(states, dumps):
+        to_ns = 1e9 / dump['sim_freq']
+        read_bw = dump.get(options.monitor + '.averageReadBandwidth', 0)
+        write_bw = dump.get(options.monitor + '.averageWriteBandwidth', 0)
+        hist = options.monitor + '.readLatencyHist::'
+        row = {'read_pct': read_pct,
+               'itt_ns': itt * to_ns,
+               'offered_gbps': block_size / (itt * to_ns),
+               'read_gbps': read_bw / 1e9,
+               'write_gbps': write_bw / 1e9,
+               'total_gbps': (read_bw + write_bw) / 1e9,
+               'reads': int(dump.get(hist + 'samples', 0)),
+               'mean_ns': dump.get(hist + 'mean', float('nan')) * to_ns}
+        for (column, p) in percentiles:
+            row[column] = percentile(dump, options.monitor, p) * to_ns
+        rows.append(row)
+
+    out = open(options.csv, 'w') if options.csv else sys.stdout
+    print >> out, ','.join(columns)
+    for row in rows:
+        print >> out, ','.join('%.3f' % row[c] if isinstance(row[c], float)
+                               else str(row[c]) for c in columns)
+    if options.csv:
+        out.close()
+
+    if options.no_plot:
+        return
+
+    try:
+        import matplotlib
+        if options.plot:
+            matplotlib.use('Agg')
+        import matplotlib.pyplot as plt
+    except ImportError:
+        print "Failed to import matplotlib"
+        sys.exit(-1)
+
+    fig, axes = plt.subplots(1, len(percentiles), sharey=True,
+                             figsize=(5 * len(percentiles), 4))
+    read_pcts = sorted(set(row['read_pct'] for row in rows), reverse=True)
+    for (ax, (column, p)) in zip(axes, percentiles):
+        for read_pct in read_pcts:
+            curve = [row for row in rows if row['read_pct'] == read_pct and
+                     row['reads'] > 0]
+            ax.plot([row['total_gbps'] for row in curve],
+                    [row[column] for row in curve], marker='o',
+                    label='%d%% reads' % read_pct)
+        ax.set_title('p%g read latency' % (p * 100))
+        ax.set_xlabel('Achieved bandwidth (GB/s)')
+        ax.set_yscale('log')
+        ax.grid(True)
+    axes[0].set_ylabel('Latency (ns)')
+    axes[0].legend(loc='upper left')
+    fig.tight_layout()
+
+    if options.plot:
+        fig.savefig(options.plot)
+    else:
+        plt.show()
+
+if __name__ == "__main__":
+    main()
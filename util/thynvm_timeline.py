@@ -0,0 +1,161 @@
+#!/usr/bin/env python
+
+# Copyright (c) 2015 Jinglei Ren <jinglei.ren@persper.com>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met: redistributions of source code must retain the above copyright
+# notice, this list of conditions and the following disclaimer;
+# redistributions in binary form must reproduce the above copyright
+# notice, this list of conditions and the following disclaimer in the
+# documentation and/or other materials provided with the distribution;
+# neither the name of the copyright holders nor the names of its
+# contributors may be used to endorse or promote products derived from
+# this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This script turns a timeline of the ThyNVM controller (see
+# src/thynvm/timeline.hh) into the trace-event JSON format of the
+# Chrome trace viewer (chrome://tracing) and of Perfetto. Epochs,
+# checkpoints and demand stalls become slices on rows of their own,
+# and the counters become charts, one per group of counters that share
+# the part of their names before the first dot, e.g.:
+#
+# util/thynvm_timeline.py m5out/timeline.bin -o timeline.json
+
+import json
+import optparse
+import struct
+import sys
+
+MAGIC = 'thytl001'
+
+(SAMPLE, EPOCH_BEGIN, CHECKPOINT_BEGIN, CHECKPOINT_END, STALL_BEGIN,
+ STALL_END) = range(6)
+
+# rows of the slices
+EPOCHS, CHECKPOINTS, STALLS = 1, 2, 3
+row_names = { EPOCHS: 'Epochs', CHECKPOINTS: 'Checkpoints',
+              STALLS: 'Demand stalls' }
+
+def read_timeline(f):
+    """Read the header, and yield (tick, event, arg, values) records"""
+    if f.read(8) != MAGIC:
+        raise ValueError("not a ThyNVM timeline")
+    (tick_freq, num_counters) = struct.unpack('=QI', f.read(12))
+    names = []
+    for i in xrange(num_counters):
+        (length,) = struct.unpack('=I', f.read(4))
+        names.append(f.read(length))
+
+    def records():
+        while True:
+            data = f.read(16)
+            if len(data) < 16:
+                return
+            (tick, event, arg) = struct.unpack('=QII', data)
+            values = None
+            if event == SAMPLE:
+                values = struct.unpack('=%dI' % arg, f.read(4 * arg))
+            yield (tick, event, arg, values)
+
+    return (tick_freq, names, records())
+
+def main():
+    parser = optparse.OptionParser(usage="%prog [options] <timeline>")
+    parser.add_option("-o", "--output", help="write the JSON to a file "
+                      "rather than to stdout")
+    parser.add_option("-t", "--tick-range", default="0:-1",
+                      help="only export the ticks in START:END, with -1 "
+                      "for the end of the timeline [default: %default]")
+    (options, args) = parser.parse_args()
+    if len(args) != 1:
+        parser.error("expected a timeline file")
+
+    (start, end) = [int(t) for t in options.tick_range.split(':')]
+
+    with open(args[0], 'rb') as f:
+        (tick_freq, names, records) = read_timeline(f)
+
+        # group the counters by the part of their names before a dot
+        groups = []
+        for name in names:
+            (group, _, key) = name.partition('.')
+            groups.append((group, key or 'value'))
+
+        def ts(tick):
+            return tick * 1e6 / tick_freq
+
+        events = []
+        for (row, name) in row_names.items():
+            events.append({ 'name': 'thread_name', 'ph': 'M', 'pid': 0,
+                            'tid': row, 'args': { 'name': name } })
+
+        def slice(name, row, begin, finish, args = None):
+            if finish < start or (end >= 0 and begin > end):
+                return
+            event = { 'name': name, 'ph': 'X', 'pid': 0, 'tid': row,
+                      'ts': ts(begin), 'dur': ts(finish) - ts(begin) }
+            if args:
+                event['args'] = args
+            events.append(event)
+
+        epoch = None
+        checkpoints = {}
+        stall = None
+        last = 0
+        for (tick, event, arg, values) in records:
+            last = tick
+            if event == SAMPLE:
+                if tick < start or (end >= 0 and tick > end):
+                    continue
+                charts = {}
+                for ((group, key), value) in zip(groups, values):
+                    charts.setdefault(group, {})[key] = value
+                for (group, chart) in sorted(charts.items()):
+                    events.append({ 'name': group, 'ph': 'C', 'pid': 0,
+                                    'ts': ts(tick), 'args': chart })
+            elif event == EPOCH_BEGIN:
+                if epoch:
+                    slice('epoch %d' % epoch[0], EPOCHS, epoch[1], tick)
+                epoch = (arg, tick)
+            elif event == CHECKPOINT_BEGIN:
+                checkpoints[arg] = tick
+            elif event == CHECKPOINT_END:
+                if arg in checkpoints:
+                    slice('checkpoint %d' % arg, CHECKPOINTS,
+                          checkpoints.pop(arg), tick, { 'epoch': arg })
+            elif event == STALL_BEGIN:
+                stall = tick
+            elif event == STALL_END:
+                if stall is not None:
+                    slice('stall', STALLS, stall, tick)
+                    stall = None
+
+        # close what is still open at the end of the timeline
+        if epoch:
+            slice('epoch %d' % epoch[0], EPOCHS, epoch[1], last)
+        for (arg, tick) in checkpoints.items():
+            slice('checkpoint %d' % arg, CHECKPOINTS, tick, last,
+                  { 'epoch': arg })
+        if stall is not None:
+            slice('stall', STALLS, stall, last)
+
+    out = open(options.output, 'w') if options.output else sys.stdout
+    json.dump({ 'traceEvents': events, 'displayTimeUnit': 'ns' }, out)
+    out.write('\n')
+
+if __name__ == "__main__":
+    main()